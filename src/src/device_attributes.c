@@ -0,0 +1,241 @@
+#include "device_attributes.h"
+#include "device_data.h"
+
+#include <linux/kernel.h>
+#include <linux/sysfs.h>
+#include <linux/string.h>
+
+// -----------------------------------------------------------------------------
+// RX coalescing, i.e. when the readers are woken up after receiving the data.
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Prints the time (in microseconds), during which the readers aren't woken up
+ * after the first unread byte has been received, 0 means that they are woken up at once.
+ */
+static ssize_t rx_coalesce_usecs_show(struct device * device, struct device_attribute * attribute,
+    char * buffer
+) {
+    struct device_data * device_data = dev_get_drvdata(device);
+    return sysfs_emit(buffer, "%u\n", READ_ONCE(device_data->m_rx_coalesce_usecs));
+}
+
+static ssize_t rx_coalesce_usecs_store(struct device * device, struct device_attribute * attribute,
+    const char * buffer, size_t num_bytes
+) {
+    struct device_data * device_data = dev_get_drvdata(device);
+    unsigned int value = 0;
+    const int status = kstrtouint(buffer, 0, &value);
+
+    if(status) {
+        return status;
+    }
+
+    if(value > RX_COALESCE_USECS_MAX) {
+        return -EINVAL;
+    }
+
+    WRITE_ONCE(device_data->m_rx_coalesce_usecs, value);
+    return num_bytes;
+}
+
+/**
+ * @brief Prints the number of unread bytes, which wakes up the readers before the
+ * coalescing time has passed, 1 means that they are woken up at once.
+ */
+static ssize_t rx_coalesce_bytes_show(struct device * device, struct device_attribute * attribute,
+    char * buffer
+) {
+    struct device_data * device_data = dev_get_drvdata(device);
+    return sysfs_emit(buffer, "%u\n", READ_ONCE(device_data->m_rx_coalesce_bytes));
+}
+
+static ssize_t rx_coalesce_bytes_store(struct device * device, struct device_attribute * attribute,
+    const char * buffer, size_t num_bytes
+) {
+    struct device_data * device_data = dev_get_drvdata(device);
+    unsigned int value = 0;
+    const int status = kstrtouint(buffer, 0, &value);
+
+    if(status) {
+        return status;
+    }
+
+    // Readers have to be woken up before the RX ring is full, otherwise the data is dropped.
+    if(value < RX_COALESCE_BYTES_MIN || value > device_data->m_rx_ring.m_size) {
+        return -EINVAL;
+    }
+
+    WRITE_ONCE(device_data->m_rx_coalesce_bytes, value);
+    return num_bytes;
+}
+
+static DEVICE_ATTR_RW(rx_coalesce_usecs);
+static DEVICE_ATTR_RW(rx_coalesce_bytes);
+
+// ------------------------------------------------------------------------------
+// TX coalescing, i.e. how long small writes are held back to be sent together.
+// ------------------------------------------------------------------------------
+
+/**
+ * @brief Prints the time (in microseconds), during which small writes are held back
+ * after the first of them, 0 means that the data is sent at once.
+ */
+static ssize_t tx_coalesce_usecs_show(struct device * device, struct device_attribute * attribute,
+    char * buffer
+) {
+    struct device_data * device_data = dev_get_drvdata(device);
+    return sysfs_emit(buffer, "%u\n", READ_ONCE(device_data->m_tx_coalesce_usecs));
+}
+
+static ssize_t tx_coalesce_usecs_store(struct device * device, struct device_attribute * attribute,
+    const char * buffer, size_t num_bytes
+) {
+    struct device_data * device_data = dev_get_drvdata(device);
+    unsigned int value = 0;
+    const int status = kstrtouint(buffer, 0, &value);
+
+    if(status) {
+        return status;
+    }
+
+    if(value > TX_COALESCE_USECS_MAX) {
+        return -EINVAL;
+    }
+
+    WRITE_ONCE(device_data->m_tx_coalesce_usecs, value);
+    return num_bytes;
+}
+
+/**
+ * @brief Prints the number of written bytes, which are sent before the coalescing time
+ * has passed, the max packet size of the bulk OUT endpoint by default.
+ */
+static ssize_t tx_coalesce_bytes_show(struct device * device, struct device_attribute * attribute,
+    char * buffer
+) {
+    struct device_data * device_data = dev_get_drvdata(device);
+    return sysfs_emit(buffer, "%u\n", READ_ONCE(device_data->m_tx_coalesce_bytes));
+}
+
+static ssize_t tx_coalesce_bytes_store(struct device * device, struct device_attribute * attribute,
+    const char * buffer, size_t num_bytes
+) {
+    struct device_data * device_data = dev_get_drvdata(device);
+    unsigned int value = 0;
+    const int status = kstrtouint(buffer, 0, &value);
+
+    if(status) {
+        return status;
+    }
+
+    // Data has to be sent before the TX ring is full, otherwise the writers would wait
+    // for the coalescing time on every write.
+    if(value < TX_COALESCE_BYTES_MIN || value > device_data->m_tx_ring.m_size) {
+        return -EINVAL;
+    }
+
+    WRITE_ONCE(device_data->m_tx_coalesce_bytes, value);
+    return num_bytes;
+}
+
+static DEVICE_ATTR_RW(tx_coalesce_usecs);
+static DEVICE_ATTR_RW(tx_coalesce_bytes);
+
+// -----------------------------------------------------------------------
+// Framing, i.e. whether the device carries raw bytes or framed messages.
+// -----------------------------------------------------------------------
+
+/**
+ * @brief Prints the framing of the messages, i.e. `none`, `cobs` or `slip`.
+ */
+static ssize_t framing_show(struct device * device, struct device_attribute * attribute,
+    char * buffer
+) {
+    struct device_data * device_data = dev_get_drvdata(device);
+    return sysfs_emit(buffer, "%s\n", g_framing_type_names[READ_ONCE(device_data->m_framing)]);
+}
+
+static ssize_t framing_store(struct device * device, struct device_attribute * attribute,
+    const char * buffer, size_t num_bytes
+) {
+    struct device_data * device_data = dev_get_drvdata(device);
+    const int framing = sysfs_match_string(g_framing_type_names, buffer);
+    ssize_t status = num_bytes;
+
+    if(framing < 0) {
+        return framing;
+    }
+
+    // Rings hold either raw bytes or messages, thus the framing is changed only while
+    // they are empty, i.e. while the device isn't opened.
+    mutex_lock(&(device_data->m_open_mutex));
+
+    if(device_data->m_open_count) {
+        status = -EBUSY;
+    } else {
+        WRITE_ONCE(device_data->m_framing, framing);
+    }
+
+    mutex_unlock(&(device_data->m_open_mutex));
+
+    return status;
+}
+
+/**
+ * @brief Prints the CRC of the framed messages, i.e. `none`, `crc16` or `crc32c`.
+ */
+static ssize_t framing_crc_show(struct device * device, struct device_attribute * attribute,
+    char * buffer
+) {
+    struct device_data * device_data = dev_get_drvdata(device);
+    return sysfs_emit(buffer, "%s\n", g_framing_crc_names[READ_ONCE(device_data->m_framing_crc)]);
+}
+
+static ssize_t framing_crc_store(struct device * device, struct device_attribute * attribute,
+    const char * buffer, size_t num_bytes
+) {
+    struct device_data * device_data = dev_get_drvdata(device);
+    const int crc = sysfs_match_string(g_framing_crc_names, buffer);
+    ssize_t status = num_bytes;
+
+    if(crc < 0) {
+        return crc;
+    }
+
+    // Decoder verifies the messages as they arrive, thus the CRC is changed along with the framing.
+    mutex_lock(&(device_data->m_open_mutex));
+
+    if(device_data->m_open_count) {
+        status = -EBUSY;
+    } else {
+        WRITE_ONCE(device_data->m_framing_crc, crc);
+    }
+
+    mutex_unlock(&(device_data->m_open_mutex));
+
+    return status;
+}
+
+static DEVICE_ATTR_RW(framing);
+static DEVICE_ATTR_RW(framing_crc);
+
+// ----------------------------------
+// Attribute groups of the device.
+// ----------------------------------
+
+static struct attribute * g_device_attrs[] = {
+    &dev_attr_rx_coalesce_usecs.attr,
+    &dev_attr_rx_coalesce_bytes.attr,
+    &dev_attr_tx_coalesce_usecs.attr,
+    &dev_attr_tx_coalesce_bytes.attr,
+    &dev_attr_framing.attr,
+    &dev_attr_framing_crc.attr,
+    NULL
+};
+
+ATTRIBUTE_GROUPS(g_device);
+
+const struct attribute_group ** get_device_attribute_groups(void) {
+    return g_device_groups;
+}
@@ -0,0 +1,29 @@
+/**
+ * @brief File contains sysfs attributes of each device, which are located in
+ * `/sys/class/<usb_device_class_name>/<usb_device_class_name><minor>/`.
+ */
+
+#ifndef DEVICE_ATTRIBUTES_H
+#define DEVICE_ATTRIBUTES_H
+
+#include <linux/device.h>
+
+/**
+ * Limits of the RX coalescing parameters.
+ */
+#define RX_COALESCE_USECS_MAX 1000000
+#define RX_COALESCE_BYTES_MIN 1
+
+/**
+ * Limits of the TX coalescing parameters.
+ */
+#define TX_COALESCE_USECS_MAX 1000000
+#define TX_COALESCE_BYTES_MIN 1
+
+/**
+ * @brief Returns the attribute groups, which should be passed to the device creation.
+ * Driver data of the device has to be its `device_data` structure.
+ */
+const struct attribute_group ** get_device_attribute_groups(void);
+
+#endif // DEVICE_ATTRIBUTES_H
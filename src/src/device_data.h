@@ -15,6 +15,73 @@
 /** Header that contains completions. */
 #include <linux/completion.h>
 
+/** Header that contains wait queues. */
+#include <linux/wait.h>
+
+/** Header that contains URBs and their anchors. */
+#include <linux/usb.h>
+
+/** Header that contains reference counters. */
+#include <linux/kref.h>
+
+/** Header that contains scatter-gather lists. */
+#include <linux/scatterlist.h>
+
+/** Header that contains atomic counters. */
+#include <linux/atomic.h>
+
+/** Header that contains work items. */
+#include <linux/workqueue.h>
+
+
+#include "ring_buffer.h"
+
+#include "ftdi_protocol.h"
+
+#include "poller.h"
+
+#include "device_stats.h"
+
+#include "framing.h"
+
+/**
+ * Bits of `device_data.m_rx_flags`.
+ */
+#define RX_IS_STOPPED_BIT 0
+
+/**
+ * Bits of `device_data.m_rx_coalesce_flags`.
+ */
+#define RX_COALESCE_PENDING_BIT 0
+
+/**
+ * Bits of `device_data.m_tx_flags`.
+ */
+#define TX_URB_IN_FLIGHT_BIT 0
+#define TX_COALESCE_HELD_BIT 1
+
+/**
+ * Number of the records in the RX timestamp ring, must be a power of 2.
+ */
+#define RX_TIMESTAMP_RING_SIZE 1024
+
+/**
+ * Arrival time of the payload of a bulk IN URB, which has been put into the RX ring.
+ */
+struct rx_timestamp {
+    /** Producer index of the RX ring, where the payload starts. */
+    u32 m_position;
+
+    /**
+     * True if the URB has been completed by a short packet, i.e. the chip has sent what it had,
+     * once its latency timer has expired, rather than because its buffer has filled up.
+     */
+    bool m_is_short;
+
+    /** Time of the completion of the URB (`CLOCK_MONOTONIC`, in nanoseconds). */
+    u64 m_ns;
+};
+
 /**
  * Structure with the data for each device that we will allocate on heap.
  * For now it only has `cdev` structure that is associated with 
@@ -22,6 +89,63 @@
  * but it could be populated with anything else we need.
  */
 struct device_data {
+    /**
+     * Reference counter of this structure. Connected device holds one reference and each
+     * opened file holds another one, thus the structure is freed only after the device has been
+     * disconnected and all its files have been closed.
+     */
+    struct kref m_kref;
+
+    /**
+     * Character device and the device file of this device along with its minor number.
+     */
+    struct cdev * m_cdev;
+    struct device * m_device;
+    int m_minor;
+
+    /**
+     * USB device and its interface, which this structure was allocated for in `probe()`.
+     */
+    struct usb_device * m_usb_device;
+    struct usb_interface * m_interface;
+
+    /**
+     * Type of the chip and the channel of the chip, which this interface represents.
+     * Channel is passed in `wIndex` of the vendor requests (1 for interface A and so on).
+     */
+    enum ftdi_chip_type m_chip_type;
+    u16 m_channel;
+
+    /**
+     * Addresses of the bulk IN/OUT endpoints, discovered from the interface descriptors.
+     */
+    u8 m_bulk_in_endpoint_address;
+    u8 m_bulk_out_endpoint_address;
+
+    /**
+     * Maximum packet size of the bulk OUT endpoint.
+     */
+    int m_bulk_out_max_packet_size;
+
+    /**
+     * Number of opened files of this device. Bulk IN URBs are submitted and the device is
+     * serviced by the poller only while it's opened. Protected by `m_open_mutex`, which
+     * also serializes opening and closing with the disconnect of the device.
+     */
+    int m_open_count;
+    struct mutex m_open_mutex;
+
+    /**
+     * Client of the driver-wide poller, which sends the data of the TX ring
+     * to the bulk OUT endpoint, once `write()` has scheduled it.
+     */
+    struct poller_client m_poller_client;
+
+    /**
+     * Anchor of the submitted bulk OUT URBs, which is used to kill them on disconnect.
+     */
+    struct usb_anchor m_tx_anchor;
+
     /**
      * Mutex, which is locked and unlocked in `read()` and `write()` file 
      * operations to allow only one process to read from/write to this device.
@@ -29,23 +153,199 @@ struct device_data {
 	struct mutex m_mutex;
 
     /**
-     * Buffer, associated with this device, where data is read from or written to.
+     * Ring with the data, written by `write()`, which hasn't been sent to the bulk OUT endpoint yet.
+     * Producer is `write()`, which is serialized by `m_mutex`, consumer is the bulk OUT URB, which
+     * is sent directly from the ring and consumes the data in its completion handler.
+     */
+    struct ring_buffer m_tx_ring;
+
+    /**
+     * Bulk OUT URB, which is reused for every transfer. Only one URB is in flight at a time, which
+     * is indicated by `TX_URB_IN_FLIGHT_BIT` of `m_tx_flags`. If the data wraps around the end of
+     * the TX ring, both its parts are sent by the same URB via the scatter-gather list, as long
+     * as the host controller supports it.
+     */
+    struct urb * m_tx_urb;
+    struct scatterlist m_tx_sg[2];
+    unsigned long m_tx_flags;
+
+    /**
+     * DMA address of the data of the TX ring, which is mapped once, while the device is opened,
+     * so that the URBs are sent without mapping the data each time. `DMA_MAPPING_ERROR` if the
+     * ring isn't mapped, e.g. the host controller doesn't use DMA.
+     */
+    dma_addr_t m_tx_ring_dma;
+
+    /**
+     * Maximum size of the transfer of the bulk OUT URB. It is a multiple of `m_bulk_out_max_packet_size`,
+     * larger writes are split into URBs of this size, which are submitted one after another.
+     */
+    unsigned int m_tx_urb_size;
+
+    /**
+     * Wait queue, where writers wait for the space in the TX ring.
+     */
+    wait_queue_head_t m_tx_wait;
+
+    /**
+     * Number of the mappings of `m_tx_ring` to userspace, i.e. of the producers, which fill
+     * the TX ring bypassing `write()` and its mutex.
+     */
+    atomic_t m_tx_mappings;
+
+    /**
+     * TX coalescing parameters, which are set via sysfs: small writes are held back, until
+     * `m_tx_coalesce_bytes` bytes are waiting in the TX ring or `m_tx_coalesce_usecs` microseconds
+     * have passed since the first held write (0 microseconds disables coalescing). While the data
+     * is held, `TX_COALESCE_HELD_BIT` of `m_tx_flags` is set.
+     */
+    unsigned int m_tx_coalesce_usecs;
+    unsigned int m_tx_coalesce_bytes;
+
+    /**
+     * Maximum packet size of the bulk IN endpoint. Each packet of this size, that the
+     * device sends, starts with the 2-byte FTDI status header.
+     */
+    int m_bulk_in_max_packet_size;
+
+    /**
+     * Size of the transfer buffer of each bulk IN URB. It is a multiple of `m_bulk_in_max_packet_size`,
+     * so that the host controller could put many packets into a single URB before completing it.
+     */
+    int m_rx_urb_size;
+
+    /**
+     * Bulk IN URBs, which are kept in flight all the time while the device is connected.
+     * They are allocated once along with their buffers and resubmitted on completion.
+     */
+    struct urb ** m_rx_urbs;
+
+    /**
+     * Number of URBs in `m_rx_urbs`.
+     */
+    int m_rx_urb_count;
+
+    /**
+     * Anchor of the submitted bulk IN URBs, which is used to kill all of them at once.
+     */
+    struct usb_anchor m_rx_anchor;
+
+    /**
+     * Bulk IN URBs, which have been completed with the stalled endpoint, wait here for
+     * `m_rx_halt_work` to clear the halt of the endpoint and to resubmit them, as the halt
+     * can't be cleared from the completion handler.
+     */
+    struct usb_anchor m_rx_halted_anchor;
+    struct work_struct m_rx_halt_work;
+
+    /**
+     * Once `RX_IS_STOPPED_BIT` is set by `rx_stop()`, halted bulk IN URBs aren't resubmitted.
+     */
+    unsigned long m_rx_flags;
+
+    /**
+     * Payload of the received packets (with the status headers stripped), which waits
+     * to be read by `read()`. URB completion handlers are producers, `read()` is a consumer.
+     */
+    struct ring_buffer m_rx_ring;
+
+    /**
+     * Serializes the producers of `m_rx_ring`, i.e. completions of different bulk IN URBs.
+     */
+    spinlock_t m_rx_producer_lock;
+
+    /**
+     * Wait queue of readers that wait for the data to arrive.
+     */
+    wait_queue_head_t m_rx_wait;
+
+    /**
+     * Number of the mappings of `m_rx_ring` to userspace, i.e. of the consumers, which read
+     * the RX ring bypassing `read()` and its mutex.
+     */
+    atomic_t m_rx_mappings;
+
+    /**
+     * Side ring of the arrival times of the data in the RX ring, one record per bulk IN URB, which
+     * is read along with the data by the files in the timestamp mode. Once it's full, the oldest
+     * record is overwritten. Indices are free-running and protected by `m_rx_producer_lock`.
+     */
+    struct rx_timestamp * m_rx_timestamps;
+    unsigned int m_rx_timestamp_head;
+    unsigned int m_rx_timestamp_tail;
+
+    /**
+     * Buffer of the reader, which waits for a large read, while the RX ring is empty. Payload of
+     * the received packets is put straight into it instead of the RX ring, until it's full, and
+     * `m_rx_direct_filled` is the number of bytes put there. `NULL` if there is no such reader.
+     * No reader could start it, while `m_rx_direct_is_blocked` is set. Protected by `m_rx_producer_lock`.
      */
-    char * m_device_buffer;
-	
-	/**
-     * Number of bytes allocated for the device buffer. Should be equal to the maximum packet 
-     * size of the USB interface bulk in/out endpoints that we will use to read from/write to 
-     * + 1 (for the ending NUL character).
+    struct iov_iter * m_rx_direct_iter;
+    size_t m_rx_direct_filled;
+    bool m_rx_direct_is_blocked;
+
+    /**
+     * RX coalescing parameters, which are set via sysfs: readers are woken up, once
+     * `m_rx_coalesce_bytes` bytes are unread or `m_rx_coalesce_usecs` microseconds have passed
+     * since the first unread byte has been received (0 microseconds means at once).
      */
-	int m_device_buffer_size;
+    unsigned int m_rx_coalesce_usecs;
+    unsigned int m_rx_coalesce_bytes;
 
-	/**
-     * Number of characters written to the buffer (actual data size in the buffer). Should have
-     * a maximum value of `m_device_buffer_size` - 1, as we have to reserve the last byte for the
-     * ending NUL character.
+    /**
+     * Flags of RX coalescing, `RX_COALESCE_PENDING_BIT` is set while the wakeup of the readers
+     * is held back and the poller client is scheduled to do it.
+     */
+    unsigned long m_rx_coalesce_flags;
+    struct poller_client m_rx_coalesce_client;
+
+    /**
+     * Framing of the messages and their CRC, which are set via sysfs, while the device isn't opened.
+     * If the device is framed, the received payload is decoded by the bulk IN URB completion handler
+     * and the RX ring holds the decoded messages (with their CRC verified and stripped), each of them
+     * preceded by its `u16` size.
+     */
+    enum framing_type m_framing;
+    enum framing_crc m_framing_crc;
+    struct framing_decoder m_rx_decoder;
+
+    /**
+     * Buffers of `write()` in the framed mode, where the message is gathered and framed,
+     * before it's put into the TX ring. Protected by `m_mutex`.
+     */
+    u8 * m_tx_message;
+    u8 * m_tx_frame;
+
+    /**
+     * Modem and line status bytes from the status header of the last received packet
+     * and the number of the received status headers, so that a fresh status could be
+     * told apart from a stale one.
+     */
+    u8 m_modem_status;
+    u8 m_line_status;
+    unsigned int m_rx_status_count;
+
+    /**
+     * Number of the callers, that wait for the TX data to be drained, i.e. that have to be
+     * woken up on every received status header and on every completed bulk OUT URB.
+     */
+    atomic_t m_tx_drainers;
+
+    /**
+     * Time (in nanoseconds), when the first opened file has started to resume the suspended device,
+     * it's cleared by the first data received after it, to measure the resume-to-first-byte latency.
+     */
+    u64 m_resume_ns;
+
+    /**
+     * Set once the device has been disconnected, so that the readers don't wait forever.
+     */
+    bool m_is_disconnected;
+
+    /**
+     * Counters of the hot path, i.e. of the file operations and URB handlers.
      */
-	int m_device_buffer_data_len;
+    struct device_stats m_stats;
 };
 
 #endif // DEVICE_DATA_H
@@ -8,16 +8,67 @@
 #include <asm/uaccess.h>
 #include <linux/errno.h>
 #include <linux/usb.h>
+#include <linux/slab.h>
+#include <linux/sched/signal.h>
+#include <linux/sched/mm.h>
+#include <linux/capability.h>
+#include <linux/uio.h>
+#include <linux/poll.h>
+#include <linux/version.h>
+#include <linux/mm.h>
+#include <linux/stddef.h>
+#include <linux/bvec.h>
+#include <asm/ioctls.h>
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 8, 0)
+#   include <linux/io_uring/cmd.h>
+#else
+#   include <linux/io_uring.h>
+#endif
 
-// ---------------------------------------------------------------------
-// Definition of functions that allocate and free device data structure.
-// ---------------------------------------------------------------------
+#include "ftdi_usb_driver.h"
+#include "device_ioctl.h"
 
 /**
- * Device data for storing data from read and write file operations.
+ * Data of each opened file of the device, which is stored in `private_data` of the file.
  */
-static struct device_data * g_device_data = NULL;
+struct device_file {
+    /** Device, which this file has been opened for. */
+    struct device_data * m_device_data;
+
+    /**
+     * Time budget of busy polling in blocking `read()` (in microseconds), 0 disables it.
+     * Set via `DEVICE_IOCTL_SET_BUSY_POLL`.
+     */
+    unsigned int m_busy_poll_usecs;
+
+    /**
+     * Timestamp mode of `read()` (`DEVICE_RX_TIMESTAMP_*` flags), 0 disables it.
+     * Set via `DEVICE_IOCTL_SET_RX_TIMESTAMPS`.
+     */
+    unsigned int m_rx_timestamp_flags;
+
+    /**
+     * Buffer, registered via `DEVICE_IOCTL_REGISTER_BUFFER`, along with its pinned pages and
+     * their bvecs, which `DEVICE_IOCTL_READ_REGISTERED` reads through. Protected by
+     * `m_registered_mutex`, which is held by such a read until it's done. Pages are charged
+     * to `pinned_vm` of `m_registered_mm`, i.e. of the process, which has registered the buffer.
+     */
+    unsigned long m_registered_address;
+    size_t m_registered_length;
+    struct page ** m_registered_pages;
+    struct bio_vec * m_registered_bvecs;
+    unsigned int m_registered_page_count;
+    struct mm_struct * m_registered_mm;
+    struct mutex m_registered_mutex;
+};
+
+/**
+ * Minimum size of the read, which is filled directly by the bulk IN URB completion handler.
+ * Smaller reads are served from the RX ring, as handing their buffer over to the completion
+ * handler costs more than the copy of a few bytes.
+ */
+#define RX_DIRECT_READ_MIN 4096
 
 // -------------------------------------------------------------
 // Declaration of `file_operations` structure and its functions.
@@ -29,34 +80,110 @@ static int device_open(struct inode * inode, struct file * filep);
 static int device_release(struct inode * inode, struct file * filep);
 
 /**
- * @brief Reads `num_bytes` number of bytes from `user_buffer` 
- * starting from offset `file_offset` and increments its value 
- * by value the of `num_bytes`.
+ * @brief Reads the data, received from the bulk IN endpoint, into the buffers of the iterator
+ * (one buffer for `read()`, many for `readv()` or io_uring). Blocks until at least one byte is
+ * available, unless the file was opened with `O_NONBLOCK` or the call mustn't block (`IOCB_NOWAIT`,
+ * which is set by io_uring to try the call inline before punting it to a worker). Large blocking
+ * reads into kernel pages (io_uring fixed buffers, `splice()`) are filled by the bulk IN URB
+ * completion handler directly, bypassing the RX ring. In the timestamp mode (`DEVICE_IOCTL_SET_RX_TIMESTAMPS`) the data is
+ * returned in chunks along with its arrival time. On the framed device each call returns a single
+ * decoded message. Device is a stream, thus the file offset is ignored.
+ *
+ * @return Returns the number of bytes read from the device,
+ * `-EFAULT`, which means bad address, in case if the data couldn't be
+ * copied to the user buffer, `-EAGAIN` if there is no data in non-blocking mode,
+ * `-EINVAL` if the buffer can't fit a chunk in the timestamp mode, `-EMSGSIZE` if the message
+ * of the framed device doesn't fit into the buffer, `-EIO` if the RX ring of the framed device
+ * has been corrupted or `-ENODEV` if the device has been disconnected.
+ */
+ssize_t device_read_iter(struct kiocb * iocb, struct iov_iter * to);
+
+/**
+ * @brief Appends the data of all the buffers of the iterator (one buffer for `write()`, many for
+ * `writev()` or io_uring) to the TX ring and schedules the device to send it. Data of any length
+ * is taken: a blocking call waits for the space in the TX ring, while the device is sending the
+ * data, unless the call mustn't block, in which case it takes only what fits. Small writes could
+ * be held back by TX coalescing, unless `IOCB_DSYNC` is set (`RWF_DSYNC` or `O_DSYNC`). On the framed
+ * device each call is a single message, which is framed as a whole. Device is a stream, thus the file
+ * offset is ignored.
+ *
+ * @return Returns the number of bytes written, which is less than requested only in non-blocking
+ * mode or if the call has been interrupted, `-EFAULT` if the data couldn't be copied from the user
+ * buffer, `-EAGAIN` if the TX ring is full in non-blocking mode, `-EMSGSIZE` if the message of the
+ * framed device is too large, `-EBUSY` if the TX ring is mapped to userspace (only the doorbell,
+ * i.e. the write of 0 bytes, is allowed then) or `-ENODEV` if the device has been disconnected.
+ */
+ssize_t device_write_iter(struct kiocb * iocb, struct iov_iter * from);
+
+/**
+ * @brief Reports, whether the device could be read from (received data is available) or written
+ * to without blocking, used by `poll()`, `select()`, `epoll` and io_uring.
+ */
+__poll_t device_poll(struct file * filep, struct poll_table_struct * poll_table);
+
+/**
+ * @brief Handles `ioctl()` commands, which are declared in `device_ioctl.h`.
  *
- * @return Returns the number of bytes read from the user 
- * or `-EFAULT`, which means bad address, in case if the 
- * data couldn't be copied from device buffer to `user_buffer`.
+ * @return 0 on success, `-ENOTTY` if the command is unknown, `-EFAULT` if the argument
+ * couldn't be copied from/to userspace.
  */
-ssize_t device_read(
-	struct file * filep, char __user * user_buffer,
-	size_t num_bytes, loff_t * file_offset
-);
+long device_ioctl(struct file * filep, unsigned int command, unsigned long argument);
 
-ssize_t device_write(
-	struct file * filep, const char __user * user_buffer,
-	size_t num_bytes, loff_t * file_offset
-);
+/**
+ * @brief Waits, until all the written data has left the host and the adapter has sent it
+ * (see `DEVICE_IOCTL_DRAIN`). Device has no backing storage, thus the range is ignored.
+ */
+int device_fsync(struct file * filep, loff_t start, loff_t end, int datasync);
+
+/**
+ * @brief Maps the ring of the device to userspace, the ring is selected by the offset
+ * of the mapping (`DEVICE_MMAP_*_OFFSET`), so that the data is accessed without a copy.
+ *
+ * @return 0 on success, `-EINVAL` if the offset or the length of the mapping is wrong
+ * or if the mapping isn't shared, `-EBUSY` if a ring of the framed device is mapped.
+ */
+int device_mmap(struct file * filep, struct vm_area_struct * vma);
+
+/**
+ * @brief Handles `IORING_OP_URING_CMD` submissions, i.e. the `DEVICE_IOCTL_*` commands of `ioctl()`,
+ * but without a system call per command (see `struct device_uring_cmd`).
+ *
+ * @return Result of the command, `-EAGAIN` if the command would block and io_uring
+ * doesn't allow it, i.e. it has to retry the command from a worker, `-ENOTTY` if the command
+ * isn't one of `DEVICE_IOCTL_*`.
+ */
+int device_uring_cmd(struct io_uring_cmd * command, unsigned int issue_flags);
 
 struct file_operations g_file_operations = {
 	.owner = THIS_MODULE,
 	.open = device_open,
 	.release = device_release,
-	.read = device_read,
-	.write = device_write
+	.read_iter = device_read_iter,
+	.write_iter = device_write_iter,
+	// `splice()` and `sendfile()` move the data between the device and a pipe or a file
+	// within the kernel. Received data is copied by `read_iter()` into the pages, which are
+	// allocated for the pipe, as the RX ring is reused and its pages can't be given away, while
+	// the pages of the pipe are passed to `write_iter()` as they are.
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 5, 0)
+	.splice_read = copy_splice_read,
+#else
+	.splice_read = generic_file_splice_read,
+#endif
+	.splice_write = iter_file_splice_write,
+	.poll = device_poll,
+	.unlocked_ioctl = device_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
+	.uring_cmd = device_uring_cmd,
+	.fsync = device_fsync,
+	.mmap = device_mmap
 };
 
-struct file_operations * get_file_operations(struct device_data * device_data) {
-    g_device_data = device_data;
+// Indices of the rings are mapped to userspace as they are.
+static_assert(sizeof(struct ring_buffer_indices) == sizeof(struct device_ring_indices));
+static_assert(offsetof(struct ring_buffer_indices, m_head) == offsetof(struct device_ring_indices, m_head));
+static_assert(offsetof(struct ring_buffer_indices, m_tail) == offsetof(struct device_ring_indices, m_tail));
+
+struct file_operations * get_file_operations(void) {
     return &g_file_operations;
 }
 
@@ -64,138 +191,1083 @@ struct file_operations * get_file_operations(struct device_data * device_data) {
 // Definition of functions in `file_operations` structure.
 // -------------------------------------------------------
 
+/**
+ * @brief Locks device mutex in interruptible fashion and accounts the lock as contended
+ * in the hot path statistics, if another process is already holding it. If the caller
+ * mustn't block, the mutex is only tried to be locked.
+ *
+ * @return 0 if the mutex has been locked, `-EAGAIN` if it's locked by someone else and the
+ * caller mustn't block, `-ERESTARTSYS` if waiting has been interrupted.
+ */
+static int device_data_lock(struct device_data * device_data, bool is_nowait) {
+    if(mutex_trylock(&(device_data->m_mutex))) {
+        return 0;
+    }
+
+    device_stats_mutex_contended(&(device_data->m_stats));
+
+    if(is_nowait) {
+        return -EAGAIN;
+    }
+
+    return mutex_lock_interruptible(&(device_data->m_mutex)) ? -ERESTARTSYS : 0;
+}
+
+/**
+ * @brief Returns true if the file operation mustn't block, either because the file was opened
+ * in non-blocking mode or because io_uring tries the operation inline.
+ */
+static bool device_is_nowait(const struct kiocb * iocb) {
+    return (iocb->ki_flags & IOCB_NOWAIT) || (iocb->ki_filp->f_flags & O_NONBLOCK);
+}
+
 int device_open(struct inode * inode, struct file * filep) {
+    // Find the device by the minor number of its file. Device data holds a reference,
+    // which is dropped in `release()`, so that the device data outlives the disconnect
+    // of the device, while the file is still opened.
+    struct device_data * device_data = ftdi_usb_driver_get_device_data(iminor(inode));
+
+    if(!device_data) {
+        return -ENODEV;
+    }
+
+    struct device_file * device_file = kzalloc(sizeof(struct device_file), GFP_KERNEL);
+
+    if(!device_file) {
+        device_data_put(device_data);
+        return -ENOMEM;
+    }
+
+    device_file->m_device_data = device_data;
+    mutex_init(&(device_file->m_registered_mutex));
+
+    // Device is started by the first opened file.
+    const int status = ftdi_usb_driver_open(device_data);
+
+    if(status) {
+        kfree(device_file);
+        device_data_put(device_data);
+        return status;
+    }
+
+    filep->private_data = device_file;
+
+    // Let io_uring try the reads and writes inline with `IOCB_NOWAIT`, as they honor it.
+    filep->f_mode |= FMODE_NOWAIT;
     return 0;
 }
 
-int device_release(struct inode * inode, struct file * filep) {
+/**
+ * @brief Charges the pages, which are about to be pinned, to `pinned_vm` of the process, the same
+ * way as RDMA and io_uring do, i.e. up to `RLIMIT_MEMLOCK`, unless the process has `CAP_IPC_LOCK`.
+ *
+ * @return 0 on success, `-ENOMEM` if the pages would exceed the limit.
+ */
+static int device_buffer_account(struct mm_struct * mm, unsigned int page_count) {
+    const unsigned long limit = rlimit(RLIMIT_MEMLOCK) >> PAGE_SHIFT;
+    const s64 pinned = atomic64_add_return(page_count, &(mm->pinned_vm));
+
+    if((u64) pinned > limit && !capable(CAP_IPC_LOCK)) {
+        atomic64_sub(page_count, &(mm->pinned_vm));
+        return -ENOMEM;
+    }
+
     return 0;
 }
 
-ssize_t device_read(
-	struct file * filep, char __user * user_buffer,
-	size_t num_bytes, loff_t * file_offset
+/**
+ * @brief Unpins the pages of the registered buffer, if any. Should be called with
+ * `m_registered_mutex` locked, unless the file is being released.
+ */
+static void device_buffer_unregister(struct device_file * device_file) {
+    if(!device_file->m_registered_pages) {
+        return;
+    }
+
+    // Pages have been written to by the URB completion handlers.
+    unpin_user_pages_dirty_lock(device_file->m_registered_pages, device_file->m_registered_page_count, true);
+    atomic64_sub(device_file->m_registered_page_count, &(device_file->m_registered_mm->pinned_vm));
+    mmdrop(device_file->m_registered_mm);
+    kvfree(device_file->m_registered_pages);
+    kvfree(device_file->m_registered_bvecs);
+
+    device_file->m_registered_address = 0;
+    device_file->m_registered_length = 0;
+    device_file->m_registered_pages = NULL;
+    device_file->m_registered_bvecs = NULL;
+    device_file->m_registered_page_count = 0;
+    device_file->m_registered_mm = NULL;
+}
+
+/**
+ * @brief Pins the pages of the buffer of the process for the reads of this file and replaces
+ * the buffer, that has been registered before.
+ *
+ * @return 0 on success, `-EINVAL` if the buffer is too large, `-ENOMEM` if there isn't enough
+ * memory or the pages exceed `RLIMIT_MEMLOCK` of the process, `-EFAULT` if the buffer isn't
+ * writable memory of the process, `-ERESTARTSYS` if waiting for the reads of the registered
+ * buffer to finish has been interrupted.
+ */
+static long device_buffer_register(struct device_file * device_file,
+    const struct device_registered_buffer * buffer
 ) {
-    // As we are accessing the device data here, which could be written to by another process,
-    // we have to lock on mutex before proceeding any further.
-    // We lock in interruptible fashion, so that the user could kill the process. As this function,
-    // once called, will be running in the user's process space and it wouldn't be killable by the user if this 
-    // process will be waiting on a mutex, thus this waiting for mutex to be unlocked should be interruptible.
-    // Function `mutex_lock_interruptible()` returns a non-zero code, once interrupted via user, thus we have to check
-    // its return value and in case if it is non-zero, we return `-ERESTARTSYS`, which will make the kernel to
-    // try to restart the call from the beginning or return an error to the user.
-    if(mutex_lock_interruptible(&(g_device_data->m_mutex))) {
-        // Waiting on mutex has been interrupted, thus no mutex was acquired and we don't have to unlock it.
-        return -ERESTARTSYS;
+    const unsigned long address = buffer->m_address;
+    const size_t length = buffer->m_length;
+    struct mm_struct * mm = current->mm;
+    struct page ** pages = NULL;
+    struct bio_vec * bvecs = NULL;
+    unsigned int page_count = 0;
+    int status = 0;
+
+    if(length > DEVICE_REGISTERED_BUFFER_SIZE_MAX || address + length < address) {
+        return -EINVAL;
     }
 
-    // -- CRITICAL SECTION BEGIN --
-    const int device_buffer_size = g_device_data->m_device_buffer_size;
+    if(length) {
+        const size_t page_offset = offset_in_page(address);
+        page_count = DIV_ROUND_UP(page_offset + length, PAGE_SIZE);
 
-    if(*file_offset >= device_buffer_size) {
-        // If the file offset is already at the end of the device buffer
-        // or is even beyond it, then we don't read anything from the device.
-        // Before returning, we have to unlock the mutex.
-        // -- CRITICAL SECTION END --
-        mutex_unlock(&(g_device_data->m_mutex));
-        return 0;
+        // Pinned pages can't be swapped out, thus they count against the locked memory limit.
+        status = device_buffer_account(mm, page_count);
+
+        if(status) {
+            return status;
+        }
+
+        pages = kvmalloc_array(page_count, sizeof(struct page *), GFP_KERNEL);
+        bvecs = kvmalloc_array(page_count, sizeof(struct bio_vec), GFP_KERNEL);
+
+        if(!pages || !bvecs) {
+            status = -ENOMEM;
+            goto unaccount;
+        }
+
+        // Pages stay pinned as long as the buffer is registered, thus they can't be migrated.
+        const int pinned = pin_user_pages_fast(address, page_count, FOLL_WRITE | FOLL_LONGTERM, pages);
+
+        if(pinned != page_count) {
+            if(pinned > 0) {
+                unpin_user_pages(pages, pinned);
+            }
+
+            status = pinned < 0 ? pinned : -EFAULT;
+            goto unaccount;
+        }
+
+        // Pages are uncharged from the same process, even if the file is closed by another one.
+        mmgrab(mm);
+
+        size_t remaining = length;
+
+        for(unsigned int i = 0; i < page_count; ++i) {
+            const size_t offset = i == 0 ? page_offset : 0;
+            const size_t bvec_length = min_t(size_t, remaining, PAGE_SIZE - offset);
+
+            bvec_set_page(&(bvecs[i]), pages[i], bvec_length, offset);
+            remaining -= bvec_length;
+        }
     }
 
-    if(*file_offset + num_bytes >= device_buffer_size) {
-        // Adjust the size of the buffer that we will read from the device,
-        // if the size that we want to read will be going beyond the size
-        // of the device buffer (taking into account the current file offset).
-        num_bytes = device_buffer_size - *file_offset;
+    if(mutex_lock_interruptible(&(device_file->m_registered_mutex))) {
+        if(pages) {
+            unpin_user_pages(pages, page_count);
+            atomic64_sub(page_count, &(mm->pinned_vm));
+            mmdrop(mm);
+        }
+
+        kvfree(pages);
+        kvfree(bvecs);
+        return -ERESTARTSYS;
     }
 
-    if(copy_to_user(user_buffer, ((char *) 
-        g_device_data->m_device_buffer) + *file_offset, num_bytes)
+    device_buffer_unregister(device_file);
+
+    device_file->m_registered_address = address;
+    device_file->m_registered_length = length;
+    device_file->m_registered_pages = pages;
+    device_file->m_registered_bvecs = bvecs;
+    device_file->m_registered_page_count = page_count;
+    device_file->m_registered_mm = pages ? mm : NULL;
+
+    mutex_unlock(&(device_file->m_registered_mutex));
+
+    return 0;
+
+unaccount:
+    kvfree(pages);
+    kvfree(bvecs);
+    atomic64_sub(page_count, &(mm->pinned_vm));
+    return status;
+}
+
+int device_release(struct inode * inode, struct file * filep) {
+    struct device_file * device_file = filep->private_data;
+
+    device_buffer_unregister(device_file);
+
+    // Device is stopped by the last closed file.
+    ftdi_usb_driver_release(device_file->m_device_data);
+    device_data_put(device_file->m_device_data);
+    kfree(device_file);
+    return 0;
+}
+
+/**
+ * @brief Returns true if there is received data for the reader, either in the RX ring or, if it's
+ * the direct reader, in its buffer, which is filled directly by the bulk IN URB completion handler.
+ * Buffer of the direct reader is nothing for the other readers, thus they keep sleeping.
+ */
+static bool device_rx_is_readable(struct device_data * device_data, bool is_direct) {
+    return ring_buffer_used(&(device_data->m_rx_ring)) > 0 ||
+        (is_direct && READ_ONCE(device_data->m_rx_direct_filled) > 0);
+}
+
+/**
+ * @brief Spins on the RX ring until there is some data in it, the time budget has run out,
+ * the device has been disconnected or a signal is pending. Waiting for the data this way
+ * doesn't pay for the sleep and the wakeup of the reader, thus the data is returned to
+ * userspace as soon as the URB completion handler has put it into the ring.
+ *
+ * @return True if the data has arrived within the time budget.
+ */
+static bool device_busy_poll(struct device_data * device_data, unsigned int busy_poll_usecs, bool is_direct) {
+    const u64 deadline_ns = ktime_get_ns() + (u64) busy_poll_usecs * NSEC_PER_USEC;
+
+    do {
+        if(device_rx_is_readable(device_data, is_direct)) {
+            device_stats_busy_poll(&(device_data->m_stats), true);
+            return true;
+        }
+
+        if(READ_ONCE(device_data->m_is_disconnected) || signal_pending(current)) {
+            break;
+        }
+
+        // Let other tasks run on this CPU on non-preemptible kernels.
+        cond_resched();
+        cpu_relax();
+    } while(ktime_get_ns() < deadline_ns);
+
+    device_stats_busy_poll(&(device_data->m_stats), false);
+    return false;
+}
+
+/**
+ * @brief Returns the iterator of the read, if the bulk IN URB completion handler could fill it
+ * directly, i.e. if the read is large and it's backed by kernel pages (io_uring fixed buffers,
+ * `splice()`, the registered buffer).
+ *
+ * @return Iterator to fill directly, `NULL` if the read is small, its buffer isn't pinned or the data
+ * has to go through the RX ring.
+ */
+static struct iov_iter * device_rx_direct_iter(struct device_file * device_file, struct iov_iter * to) {
+    // Data is split into chunks by its arrival time or into messages only in the RX ring.
+    if(READ_ONCE(device_file->m_rx_timestamp_flags) || READ_ONCE(device_file->m_device_data->m_framing) ||
+        iov_iter_count(to) < RX_DIRECT_READ_MIN
     ) {
-        // In case if copying to the user buffer has failed,
-        // return `-EFAULT`, which means "bad address".
-        // Before returning, we have to unlock the mutex.
-        // -- CRITICAL SECTION END --
-        mutex_unlock(&(g_device_data->m_mutex));
+        return NULL;
+    }
+
+    return iov_iter_is_bvec(to) || iov_iter_is_kvec(to) ? to : NULL;
+}
+
+/**
+ * @brief Copies the data of the RX ring into the iterator as `struct device_rx_chunk` chunks, i.e.
+ * the data, which has arrived at the same time, is preceded by the header with its arrival time.
+ * Chunk, which doesn't fit into the iterator, is split. Should be called with `m_mutex` locked.
+ *
+ * @return Number of bytes copied (headers included), `-EFAULT` if the data couldn't be copied.
+ */
+static long device_read_timestamped(struct device_data * device_data, struct iov_iter * to,
+    unsigned int timestamp_flags
+) {
+    const bool is_latency_corrected = timestamp_flags & DEVICE_RX_TIMESTAMP_LATENCY_CORRECTED;
+    long total = 0;
+
+    while(iov_iter_count(to) > sizeof(struct device_rx_chunk) &&
+        ring_buffer_used(&(device_data->m_rx_ring)) > 0
+    ) {
+        struct device_rx_chunk chunk = { 0 };
+        u64 arrival_ns = 0;
+        const unsigned int length = ftdi_usb_driver_rx_timestamp(device_data, is_latency_corrected,
+            &arrival_ns
+        );
+
+        chunk.m_timestamp_ns = arrival_ns;
+        chunk.m_length = min_t(size_t, length, iov_iter_count(to) - sizeof(chunk));
+
+        if(copy_to_iter(&chunk, sizeof(chunk), to) != sizeof(chunk)) {
+            break;
+        }
+
+        // Header, which has been copied, promises the whole chunk.
+        if(ring_buffer_copy_to_iter(&(device_data->m_rx_ring), to, chunk.m_length) != chunk.m_length) {
+            return -EFAULT;
+        }
+
+        total += sizeof(chunk) + chunk.m_length;
+    }
+
+    return total ? total : -EFAULT;
+}
+
+/**
+ * @brief Copies a single message of the framed device from the RX ring into the iterator.
+ * Should be called with `m_mutex` locked, while the RX ring isn't empty.
+ *
+ * @return Size of the message, `-EMSGSIZE` if it doesn't fit into the iterator (the message
+ * is kept then), `-EFAULT` if it couldn't be copied (the message is lost then) or `-EIO` if its
+ * size is corrupted (all the data of the RX ring is dropped then).
+ */
+static long device_read_message(struct device_data * device_data, struct iov_iter * to) {
+    struct ring_buffer * ring = &(device_data->m_rx_ring);
+    char * first_part = NULL;
+    unsigned int second_part_size = 0;
+    u16 size = 0;
+
+    // Size of the message may wrap around the end of the ring as well.
+    const unsigned int first_part_size = ring_buffer_peek(ring, &first_part, &second_part_size);
+    const unsigned int used = first_part_size + second_part_size;
+
+    if(used >= sizeof(size)) {
+        if(first_part_size >= sizeof(size)) {
+            memcpy(&size, first_part, sizeof(size));
+        } else {
+            memcpy(&size, first_part, first_part_size);
+            memcpy((char *) &size + first_part_size, ring->m_data, sizeof(size) - first_part_size);
+        }
+    }
+
+    // Messages are put into the ring as a whole, thus the size, which doesn't fit the ring or
+    // the limit, means that the ring has been corrupted and none of its data could be trusted.
+    if(used < sizeof(size) || size > DEVICE_FRAMING_MESSAGE_SIZE_MAX || size > used - sizeof(size)) {
+        ring_buffer_consume(ring, used);
+        return -EIO;
+    }
+
+    if(size > iov_iter_count(to)) {
+        return -EMSGSIZE;
+    }
+
+    ring_buffer_consume(ring, sizeof(size));
+
+    const long copied = ring_buffer_copy_to_iter(ring, to, size);
+
+    if(copied != size) {
+        // Rest of the message mustn't be taken for the next one.
+        ring_buffer_consume(ring, size - max(copied, 0L));
         return -EFAULT;
     }
 
-    // Debug info.
-    PRINT_DEBUG("device_read(): %zd bytes of data was read from device.\n", num_bytes);
+    return copied;
+}
+
+/**
+ * @brief Reads the data the same way as `device_read_iter()`. If the read is blocking and the RX
+ * ring is empty, the received data is put straight into `direct_iter` (if it isn't `NULL`), which
+ * covers the same buffer as `to`, while the reader is waiting.
+ */
+static ssize_t device_read(struct kiocb * iocb, struct iov_iter * to, struct iov_iter * direct_iter) {
+    struct device_file * device_file = iocb->ki_filp->private_data;
+    struct device_data * device_data = device_file->m_device_data;
+    const u64 stats_start_ns = device_stats_op_start();
+    const bool is_nowait = device_is_nowait(iocb);
+    const enum framing_type framing = READ_ONCE(device_data->m_framing);
+    const unsigned int timestamp_flags = framing ? 0 : READ_ONCE(device_file->m_rx_timestamp_flags);
+
+    if(timestamp_flags && iov_iter_count(to) <= sizeof(struct device_rx_chunk)) {
+        return -EINVAL;
+    }
+
+    // RX ring has a single consumer, thus readers are serialized, a signal interrupts the wait.
+    int lock_status = device_data_lock(device_data, is_nowait);
+
+    if(lock_status) {
+        // Waiting on mutex has been interrupted, thus no mutex was acquired and we don't have to unlock it.
+        return lock_status;
+    }
+
+    // -- CRITICAL SECTION BEGIN --
+    // Device is a stream, thus the file offset is ignored and the data is read from the RX ring,
+    // which is filled by bulk IN URB completion handler.
+    while(ring_buffer_used(&(device_data->m_rx_ring)) == 0) {
+        // Nothing to read, thus we unlock the mutex and wait for the data to arrive,
+        // unless the file was opened in non-blocking mode or the device is gone.
+        // -- CRITICAL SECTION END --
+        mutex_unlock(&(device_data->m_mutex));
+
+        if(READ_ONCE(device_data->m_is_disconnected)) {
+            return -ENODEV;
+        }
+
+        if(is_nowait) {
+            return -EAGAIN;
+        }
+
+        // Large read takes the data straight from the bulk IN URB completion handler, while it's
+        // waiting, thus the status headers are stripped right into its buffer, not into the RX ring.
+        const bool is_direct = direct_iter && ftdi_usb_driver_rx_direct_start(device_data, direct_iter);
+
+        // Busy polling, if it's enabled for this file, tries to get the data without sleeping.
+        const unsigned int busy_poll_usecs = READ_ONCE(device_file->m_busy_poll_usecs);
+        int wait_status = 0;
+
+        if(!busy_poll_usecs || !device_busy_poll(device_data, busy_poll_usecs, is_direct)) {
+            wait_status = wait_event_interruptible(device_data->m_rx_wait,
+                device_rx_is_readable(device_data, is_direct) ||
+                READ_ONCE(device_data->m_is_disconnected)
+            );
+        }
+
+        const size_t direct_filled = is_direct ? ftdi_usb_driver_rx_direct_stop(device_data) : 0;
+
+        if(direct_filled) {
+            // Data, which is already in the buffer, is returned even if waiting has been interrupted.
+            // RX ring got data only if the buffer has become full, thus there is nothing to add.
+            if(direct_iter != to) {
+                iov_iter_advance(to, direct_filled);
+            }
+
+            PRINT_DEBUG("device_read_iter(): %zu bytes of data was read from device directly.\n", direct_filled);
+
+            device_stats_op_end(&(device_data->m_stats), HOT_PATH_OP_READ, stats_start_ns, direct_filled);
+            return direct_filled;
+        }
+
+        if(wait_status) {
+            return -ERESTARTSYS;
+        }
+
+        lock_status = device_data_lock(device_data, is_nowait);
 
-    for(int i = 0; i < num_bytes; ++i) {
-        PRINT_DEBUG("%c", *(((char *) g_device_data->m_device_buffer) + *file_offset + i));
+        if(lock_status) {
+            return lock_status;
+        }
+
+        // -- CRITICAL SECTION BEGIN --
     }
 
-    PRINT_DEBUG("\n");
+    long copied = 0;
+
+    if(framing) {
+        copied = device_read_message(device_data, to);
+    } else if(timestamp_flags) {
+        copied = device_read_timestamped(device_data, to, timestamp_flags);
+    } else {
+        copied = ring_buffer_copy_to_iter(&(device_data->m_rx_ring), to, iov_iter_count(to));
+    }
 
     // -- CRITICAL SECTION END --
-    mutex_unlock(&(g_device_data->m_mutex));
+    mutex_unlock(&(device_data->m_mutex));
 
-    // Update the offset of the device buffer.
-    *file_offset += num_bytes;
+    if(copied < 0) {
+        // In case if copying to the user buffer has failed, return `-EFAULT`, which means
+        // "bad address", `-EMSGSIZE`, if the message doesn't fit into it, or `-EIO`.
+        return copied;
+    }
+
+    // Debug info.
+    PRINT_DEBUG("device_read_iter(): %ld bytes of data was read from device.\n", copied);
+
+    device_stats_op_end(&(device_data->m_stats), HOT_PATH_OP_READ, stats_start_ns, copied);
 
     // Return the number of bytes we read from the device.
-    return num_bytes;
+    return copied;
+}
+
+ssize_t device_read_iter(struct kiocb * iocb, struct iov_iter * to) {
+    struct device_file * device_file = iocb->ki_filp->private_data;
+    return device_read(iocb, to, device_rx_direct_iter(device_file, to));
 }
 
-ssize_t device_write(
-	struct file * filep, const char __user * user_buffer,
-	size_t num_bytes, loff_t * file_offset
+/**
+ * @brief Reads into the part of the registered buffer through its pinned pages, the same way
+ * as `read()` does (see `DEVICE_IOCTL_READ_REGISTERED`). Buffer stays registered, until the read
+ * is done.
+ *
+ * @return The same as `device_read_iter()`, `-EINVAL` if no buffer is registered or the part isn't
+ * within it, `-EPERM` if the buffer has been registered by another process.
+ */
+static long device_read_registered(struct file * filep, const struct device_registered_read * read) {
+    struct device_file * device_file = filep->private_data;
+    struct iov_iter iter;
+    struct kiocb kiocb;
+    long status = 0;
+
+    if(mutex_lock_interruptible(&(device_file->m_registered_mutex))) {
+        return -ERESTARTSYS;
+    }
+
+    if(!device_file->m_registered_pages || read->m_offset > device_file->m_registered_length ||
+        read->m_length > device_file->m_registered_length - read->m_offset
+    ) {
+        status = -EINVAL;
+    } else if(device_file->m_registered_mm != current->mm) {
+        // Process, that shares the file (e.g. after `fork()`), doesn't read into the pages
+        // of another process.
+        status = -EPERM;
+    } else {
+        iov_iter_bvec(&iter, ITER_DEST, device_file->m_registered_bvecs,
+            device_file->m_registered_page_count, device_file->m_registered_length
+        );
+        iov_iter_advance(&iter, read->m_offset);
+        iov_iter_truncate(&iter, read->m_length);
+
+        init_sync_kiocb(&kiocb, filep);
+        status = device_read(&kiocb, &iter, device_rx_direct_iter(device_file, &iter));
+    }
+
+    mutex_unlock(&(device_file->m_registered_mutex));
+
+    return status;
+}
+
+/**
+ * @brief Writes the data of the iterator as a single message of the framed device, i.e. the message
+ * is framed and put into the TX ring as a whole. Blocking call waits for the space, that fits the
+ * largest frame of the message, non-blocking call fails, if there is no such space. Should be called
+ * with `m_mutex` locked, which is unlocked on return.
+ *
+ * @return Size of the message, `-EMSGSIZE` if the message is too large, `-EFAULT` if it couldn't
+ * be copied from the user buffer, `-EAGAIN` if the TX ring is full in non-blocking mode,
+ * `-ERESTARTSYS` if waiting has been interrupted or `-ENODEV` if the device has been disconnected.
+ */
+static ssize_t device_write_message(struct device_data * device_data, struct iov_iter * from,
+    enum framing_type framing, bool is_nowait
 ) {
-    // The same logic with mutex locking as in `device_read()` function.
-    if(mutex_lock_interruptible(&(g_device_data->m_mutex))) {
+    const enum framing_crc crc = READ_ONCE(device_data->m_framing_crc);
+    const size_t size = iov_iter_count(from);
+    const size_t frame_size_max = framing_encoded_size_max(framing, size + framing_crc_size(crc));
+
+    if(size > DEVICE_FRAMING_MESSAGE_SIZE_MAX) {
+        mutex_unlock(&(device_data->m_mutex));
+        return -EMSGSIZE;
+    }
+
+    // -- CRITICAL SECTION BEGIN --
+    while(ring_buffer_available(&(device_data->m_tx_ring)) < frame_size_max) {
+        // -- CRITICAL SECTION END --
+        mutex_unlock(&(device_data->m_mutex));
+
+        ftdi_usb_driver_tx_kick(device_data);
+
+        if(READ_ONCE(device_data->m_is_disconnected)) {
+            return -ENODEV;
+        }
+
+        if(is_nowait) {
+            return -EAGAIN;
+        }
+
+        if(wait_event_interruptible(device_data->m_tx_wait,
+            ring_buffer_available(&(device_data->m_tx_ring)) >= frame_size_max ||
+            READ_ONCE(device_data->m_is_disconnected))
+        ) {
+            return -ERESTARTSYS;
+        }
+
+        const int status = device_data_lock(device_data, is_nowait);
+
+        if(status) {
+            return status;
+        }
+
+        // -- CRITICAL SECTION BEGIN --
+    }
+
+    // Message is framed as a whole, thus it's gathered from all the buffers of the iterator first.
+    if(!copy_from_iter_full(device_data->m_tx_message, size, from)) {
+        mutex_unlock(&(device_data->m_mutex));
+        return -EFAULT;
+    }
+
+    // CRC is a part of the message, so that it's framed (i.e. escaped) along with it.
+    const size_t message_size = framing_crc_append(crc, device_data->m_tx_message, size);
+    const size_t frame_size = framing_encode(framing, device_data->m_tx_message, message_size,
+        device_data->m_tx_frame
+    );
+
+    ring_buffer_write(&(device_data->m_tx_ring), device_data->m_tx_frame, frame_size);
+
+    // -- CRITICAL SECTION END --
+    mutex_unlock(&(device_data->m_mutex));
+
+    return size;
+}
+
+ssize_t device_write_iter(struct kiocb * iocb, struct iov_iter * from) {
+    struct device_file * device_file = iocb->ki_filp->private_data;
+    struct device_data * device_data = device_file->m_device_data;
+    const u64 stats_start_ns = device_stats_op_start();
+    const bool is_nowait = device_is_nowait(iocb);
+    ssize_t written = 0;
+    long status = 0;
+
+    if(READ_ONCE(device_data->m_is_disconnected)) {
+        return -ENODEV;
+    }
+
+    // Write of 0 bytes is the doorbell of the TX ring, which has been filled via `mmap()`.
+    if(iov_iter_count(from) == 0) {
+        if(iocb->ki_flags & IOCB_DSYNC) {
+            ftdi_usb_driver_tx_kick(device_data);
+        } else {
+            ftdi_usb_driver_tx_coalesce(device_data);
+        }
+
+        return 0;
+    }
+
+    // Producer, that has mapped the TX ring, doesn't take the mutex, thus nobody else writes
+    // into the ring, while it's mapped.
+    if(atomic_read(&(device_data->m_tx_mappings))) {
+        return -EBUSY;
+    }
+
+    // The same logic with mutex locking as in `device_read_iter()` function.
+    status = device_data_lock(device_data, is_nowait);
+
+    if(status) {
         // Waiting on mutex has been interrupted, thus no mutex was acquired and we don't have to unlock it.
-        return -ERESTARTSYS;
+        return status;
+    }
+
+    const enum framing_type framing = READ_ONCE(device_data->m_framing);
+
+    if(framing) {
+        written = device_write_message(device_data, from, framing, is_nowait);
+
+        if(written < 0) {
+            return written;
+        }
+
+        // Frame goes out at once, if the writer asks for it.
+        if(iocb->ki_flags & IOCB_DSYNC) {
+            ftdi_usb_driver_tx_kick(device_data);
+        } else {
+            ftdi_usb_driver_tx_coalesce(device_data);
+        }
+
+        device_stats_op_end(&(device_data->m_stats), HOT_PATH_OP_WRITE, stats_start_ns, written);
+        return written;
     }
 
     // -- CRITICAL SECTION BEGIN --
-    const int device_buffer_size = g_device_data->m_device_buffer_size;
+    // Device is a stream, thus the file offset is ignored and the data is appended to the TX ring,
+    // which is sent to the bulk OUT endpoint by the poller. Blocking write takes all the data,
+    // waiting for the space in the ring, while the data, which is already there, is being sent.
+    // Non-blocking write takes only what fits into the ring.
+    while(iov_iter_count(from) > 0) {
+        if(ring_buffer_available(&(device_data->m_tx_ring)) > 0) {
+            // All the buffers of the iterator (e.g. header, payload and CRC of `writev()`), that fit
+            // into the ring, are gathered into it at once, thus they are sent by the same URB.
+            const long copied = ring_buffer_copy_from_iter(&(device_data->m_tx_ring), from,
+                iov_iter_count(from)
+            );
+
+            if(copied < 0) {
+                // In case if copying from the user buffer has failed,
+                // return `-EFAULT`, which means "bad address".
+                status = copied;
+                break;
+            }
+
+            written += copied;
+            continue;
+        }
 
-    if(*file_offset >= device_buffer_size) {
-        // If the file offset is already at the end of the device buffer
-        // or is even beyond it, then we don't write anything to the device.
-        // Before returning, we have to unlock the mutex.
         // -- CRITICAL SECTION END --
-        mutex_unlock(&(g_device_data->m_mutex));
-        return 0;
+        mutex_unlock(&(device_data->m_mutex));
+
+        // Let the poller send what has been written so far, so that the space is freed.
+        ftdi_usb_driver_tx_kick(device_data);
+
+        if(READ_ONCE(device_data->m_is_disconnected)) {
+            return written ? written : -ENODEV;
+        }
+
+        if(is_nowait) {
+            return written ? written : -EAGAIN;
+        }
+
+        if(wait_event_interruptible(device_data->m_tx_wait,
+            ring_buffer_available(&(device_data->m_tx_ring)) > 0 ||
+            READ_ONCE(device_data->m_is_disconnected))
+        ) {
+            return written ? written : -ERESTARTSYS;
+        }
+
+        status = device_data_lock(device_data, is_nowait);
+
+        if(status) {
+            return written ? written : status;
+        }
+
+        // -- CRITICAL SECTION BEGIN --
+    }
+
+    // -- CRITICAL SECTION END --
+    mutex_unlock(&(device_data->m_mutex));
+
+    if(written == 0) {
+        return status;
+    }
+
+    // Debug info.
+    PRINT_DEBUG("device_write_iter(): %zd bytes of data was written to device.\n", written);
+
+    // Let the poller send the data to the device, either at once, if the writer asks for it,
+    // or once TX coalescing allows it.
+    if(iocb->ki_flags & IOCB_DSYNC) {
+        ftdi_usb_driver_tx_kick(device_data);
+    } else {
+        ftdi_usb_driver_tx_coalesce(device_data);
+    }
+
+    device_stats_op_end(&(device_data->m_stats), HOT_PATH_OP_WRITE, stats_start_ns, written);
+
+    // Return the number of bytes we wrote to the device.
+    return written;
+}
+
+__poll_t device_poll(struct file * filep, struct poll_table_struct * poll_table) {
+    struct device_file * device_file = filep->private_data;
+    struct device_data * device_data = device_file->m_device_data;
+    __poll_t mask = 0;
+
+    poll_wait(filep, &(device_data->m_rx_wait), poll_table);
+    poll_wait(filep, &(device_data->m_tx_wait), poll_table);
+
+    if(READ_ONCE(device_data->m_is_disconnected)) {
+        return EPOLLHUP | EPOLLERR;
+    }
+
+    if(ring_buffer_used(&(device_data->m_rx_ring)) > 0) {
+        mask |= EPOLLIN | EPOLLRDNORM;
+    }
+
+    if(ring_buffer_available(&(device_data->m_tx_ring)) > 0) {
+        mask |= EPOLLOUT | EPOLLWRNORM;
+    }
+
+    return mask;
+}
+
+/**
+ * Default timeout of the AT command response (in milliseconds).
+ */
+#define AT_COMMAND_TIMEOUT_MS_DEFAULT 1000
+
+/**
+ * Time without new bytes (in milliseconds), after which the response of HC-06 is considered
+ * to be complete, as it doesn't terminate its responses.
+ */
+#define AT_COMMAND_RESPONSE_GAP_MS 100
+
+/**
+ * @brief Sends the AT command to HC-06 and reads its response into `at_command->m_response`.
+ *
+ * Data, which has been received before the command, is dropped, and the readers are held off,
+ * until the response has been collected, so that it isn't mixed with the other data.
+ *
+ * @return 0 on success (the response could be empty, if HC-06 didn't answer), `-EINVAL` if
+ * the command doesn't start with `AT`, `-EBUSY` if the TX ring has no space for the whole
+ * command or either ring is mapped to userspace, other negative error code on failure.
+ */
+static long device_at_command(struct device_data * device_data, struct device_at_command * at_command) {
+    at_command->m_command[DEVICE_AT_COMMAND_SIZE - 1] = '\0';
+    memset(at_command->m_response, 0, DEVICE_AT_COMMAND_SIZE);
+
+    const size_t command_length = strlen(at_command->m_command);
+
+    if(command_length < 2 || strncmp(at_command->m_command, "AT", 2) != 0) {
+        return -EINVAL;
+    }
+
+    // Module talks raw bytes, which the framed device would frame and decode.
+    if(READ_ONCE(device_data->m_framing)) {
+        return -EBUSY;
     }
 
-    if(*file_offset + num_bytes >= device_buffer_size) {
-        // Adjust the size of the buffer that we will write to the device,
-        // if the size that we want to write will be going beyond the size
-        // of the device buffer (taking into account the current file offset).
-        num_bytes = device_buffer_size - *file_offset;
+    int status = device_data_lock(device_data, false);
+
+    if(status) {
+        return status;
     }
 
-    if(copy_from_user(((char *) g_device_data->m_device_buffer) + *file_offset,
-        user_buffer, num_bytes)
+    // -- CRITICAL SECTION BEGIN --
+    // Mutex is held for the whole exchange and the response isn't put into the buffer of a waiting
+    // reader, so that no reader takes it, but the consumer, that has mapped the RX ring, doesn't
+    // take the mutex, thus the command is refused, the same as for the producer, that has mapped
+    // the TX ring. Command is sent only as a whole, as HC-06 would take a part of it for another command.
+    if(atomic_read(&(device_data->m_rx_mappings)) || atomic_read(&(device_data->m_tx_mappings)) ||
+        ring_buffer_available(&(device_data->m_tx_ring)) < command_length ||
+        !ftdi_usb_driver_rx_direct_block(device_data)
     ) {
-        // In case if copying to the user buffer has failed,
-        // return `-EFAULT`, which means "bad address".
-        // Before returning, we have to unlock the mutex.
         // -- CRITICAL SECTION END --
-        mutex_unlock(&(g_device_data->m_mutex));
-        return -EFAULT;
+        mutex_unlock(&(device_data->m_mutex));
+        return -EBUSY;
     }
 
-    // Store the number of bytes that we copied from the user.
-    g_device_data->m_device_buffer_data_len = num_bytes;
+    // Data, which is in the RX ring already, isn't a part of the response.
+    ring_buffer_consume(&(device_data->m_rx_ring), ring_buffer_used(&(device_data->m_rx_ring)));
+    ring_buffer_write(&(device_data->m_tx_ring), at_command->m_command, command_length);
+    ftdi_usb_driver_tx_kick(device_data);
 
-    // Debug info.
-    PRINT_DEBUG("device_write(): %zd bytes of data was written to device.\n", num_bytes);
+    // Collect the response, until no new bytes arrive for a while after the first one,
+    // the response buffer is full or the timeout has passed.
+    const unsigned int timeout_ms = at_command->m_timeout_ms ?
+        at_command->m_timeout_ms : AT_COMMAND_TIMEOUT_MS_DEFAULT;
+    const unsigned long deadline = jiffies + msecs_to_jiffies(timeout_ms);
+    size_t response_length = 0;
+
+    while(response_length < DEVICE_AT_COMMAND_SIZE - 1 && time_before(jiffies, deadline)) {
+        const unsigned long wait_jiffies = response_length ?
+            min(msecs_to_jiffies(AT_COMMAND_RESPONSE_GAP_MS), deadline - jiffies) : deadline - jiffies;
+
+        const long wait_status = wait_event_interruptible_timeout(device_data->m_rx_wait,
+            ring_buffer_used(&(device_data->m_rx_ring)) > 0 ||
+            READ_ONCE(device_data->m_is_disconnected),
+            wait_jiffies
+        );
+
+        if(wait_status < 0) {
+            status = -ERESTARTSYS;
+            break;
+        }
+
+        if(READ_ONCE(device_data->m_is_disconnected)) {
+            status = -ENODEV;
+            break;
+        }
 
-    for(int i = 0; i < num_bytes; ++i) {
-        PRINT_DEBUG("%c", *(((char *) g_device_data->m_device_buffer) + *file_offset + i));
+        if(wait_status == 0) {
+            // Either the gap after the response or the timeout has passed.
+            break;
+        }
+
+        struct kvec response_kvec = {
+            .iov_base = at_command->m_response + response_length,
+            .iov_len = DEVICE_AT_COMMAND_SIZE - 1 - response_length
+        };
+        struct iov_iter response_iter;
+        iov_iter_kvec(&response_iter, ITER_DEST, &response_kvec, 1, response_kvec.iov_len);
+
+        const long copied = ring_buffer_copy_to_iter(&(device_data->m_rx_ring), &response_iter,
+            response_kvec.iov_len
+        );
+
+        if(copied > 0) {
+            response_length += copied;
+        }
     }
 
-    PRINT_DEBUG("\n");
+    ftdi_usb_driver_rx_direct_unblock(device_data);
 
     // -- CRITICAL SECTION END --
-    mutex_unlock(&(g_device_data->m_mutex));
+    mutex_unlock(&(device_data->m_mutex));
 
-    // Update the offset of the device buffer.
-    *file_offset += num_bytes;
+    PRINT_DEBUG("device_at_command(): %s -> %s\n", at_command->m_command, at_command->m_response);
 
-    // Return the number of bytes we wrote to the device.
-    return num_bytes;
+    return status;
+}
+
+long device_ioctl(struct file * filep, unsigned int command, unsigned long argument) {
+    struct device_file * device_file = filep->private_data;
+    struct device_data * device_data = device_file->m_device_data;
+    u32 __user * user_value = (u32 __user *) argument;
+    u32 value = 0;
+
+    switch(command) {
+    case DEVICE_IOCTL_SET_BUSY_POLL:
+        if(get_user(value, user_value)) {
+            return -EFAULT;
+        }
+
+        WRITE_ONCE(device_file->m_busy_poll_usecs, min_t(u32, value, DEVICE_BUSY_POLL_USECS_MAX));
+        return 0;
+
+    case DEVICE_IOCTL_GET_BUSY_POLL:
+        return put_user(READ_ONCE(device_file->m_busy_poll_usecs), user_value);
+
+    case DEVICE_IOCTL_SET_RX_TIMESTAMPS:
+        if(get_user(value, user_value)) {
+            return -EFAULT;
+        }
+
+        if(value & ~(DEVICE_RX_TIMESTAMP_ENABLE | DEVICE_RX_TIMESTAMP_LATENCY_CORRECTED)) {
+            return -EINVAL;
+        }
+
+        WRITE_ONCE(device_file->m_rx_timestamp_flags, (value & DEVICE_RX_TIMESTAMP_ENABLE) ? value : 0);
+        return 0;
+
+    case DEVICE_IOCTL_GET_RX_TIMESTAMPS:
+        return put_user(READ_ONCE(device_file->m_rx_timestamp_flags), user_value);
+
+    case DEVICE_IOCTL_GET_QUEUE_DEPTH: {
+        const struct device_queue_depth queue_depth = {
+            .m_rx_bytes = ring_buffer_used(&(device_data->m_rx_ring)),
+            .m_rx_capacity = device_data->m_rx_ring.m_size,
+            .m_tx_bytes = ring_buffer_used(&(device_data->m_tx_ring)),
+            .m_tx_capacity = device_data->m_tx_ring.m_size
+        };
+
+        return copy_to_user((void __user *) argument, &queue_depth, sizeof(queue_depth)) ? -EFAULT : 0;
+    }
+
+    case DEVICE_IOCTL_AT_COMMAND: {
+        struct device_at_command at_command;
+
+        if(copy_from_user(&at_command, (void __user *) argument, sizeof(at_command))) {
+            return -EFAULT;
+        }
+
+        const long status = device_at_command(device_data, &at_command);
+
+        if(status) {
+            return status;
+        }
+
+        return copy_to_user((void __user *) argument, &at_command, sizeof(at_command)) ? -EFAULT : 0;
+    }
+
+    case DEVICE_IOCTL_TX_PUSH:
+        ftdi_usb_driver_tx_kick(device_data);
+        return 0;
+
+    case DEVICE_IOCTL_DRAIN:
+        return ftdi_usb_driver_tx_drain(device_data);
+
+    case DEVICE_IOCTL_REGISTER_BUFFER: {
+        struct device_registered_buffer buffer;
+
+        if(copy_from_user(&buffer, (void __user *) argument, sizeof(buffer))) {
+            return -EFAULT;
+        }
+
+        return device_buffer_register(device_file, &buffer);
+    }
+
+    case DEVICE_IOCTL_READ_REGISTERED: {
+        struct device_registered_read read;
+
+        if(copy_from_user(&read, (void __user *) argument, sizeof(read))) {
+            return -EFAULT;
+        }
+
+        return device_read_registered(filep, &read);
+    }
+
+    case TCSBRK:
+        // `tcdrain()` of the C library, sending a break (zero argument) isn't supported.
+        return argument ? ftdi_usb_driver_tx_drain(device_data) : -ENOTTY;
+
+    default:
+        return -ENOTTY;
+    }
+}
+
+int device_fsync(struct file * filep, loff_t start, loff_t end, int datasync) {
+    struct device_file * device_file = filep->private_data;
+    return ftdi_usb_driver_tx_drain(device_file->m_device_data);
+}
+
+static void device_ring_vma_open(struct vm_area_struct * vma) {
+    atomic_t * mappings = vma->vm_private_data;
+    atomic_inc(mappings);
+}
+
+static void device_ring_vma_close(struct vm_area_struct * vma) {
+    atomic_t * mappings = vma->vm_private_data;
+    atomic_dec(mappings);
+}
+
+/**
+ * Operations of the mappings of the rings, which count them (`vm_private_data` points to
+ * `m_rx_mappings` or `m_tx_mappings`), as a split or a copy of a mapping (e.g. by `fork()`)
+ * is one more consumer or producer. Device data outlives them, as they hold the file.
+ */
+static const struct vm_operations_struct g_device_ring_vm_operations = {
+    .open = device_ring_vma_open,
+    .close = device_ring_vma_close
+};
+
+int device_mmap(struct file * filep, struct vm_area_struct * vma) {
+    struct device_file * device_file = filep->private_data;
+    struct device_data * device_data = device_file->m_device_data;
+
+    // Private mapping wouldn't see the updates of the other side.
+    if(!(vma->vm_flags & VM_SHARED)) {
+        return -EINVAL;
+    }
+
+    switch((u64) vma->vm_pgoff << PAGE_SHIFT) {
+    case DEVICE_MMAP_RX_RING_OFFSET: {
+        // Sizes of the messages in the ring of the framed device are trusted by `read()`.
+        // Framing isn't changed, while the device is opened, i.e. while the ring is mapped.
+        if(READ_ONCE(device_data->m_framing)) {
+            return -EBUSY;
+        }
+
+        const int status = ring_buffer_mmap(&(device_data->m_rx_ring), vma);
+
+        if(status) {
+            return status;
+        }
+
+        // Callback isn't called for the mapping, which is being created.
+        vma->vm_private_data = &(device_data->m_rx_mappings);
+        vma->vm_ops = &g_device_ring_vm_operations;
+        device_ring_vma_open(vma);
+        return 0;
+    }
+
+    case DEVICE_MMAP_TX_RING_OFFSET: {
+        // Messages of the framed device are framed by `write()`, which the producer bypasses.
+        if(READ_ONCE(device_data->m_framing)) {
+            return -EBUSY;
+        }
+
+        const int status = ring_buffer_mmap(&(device_data->m_tx_ring), vma);
+
+        if(status) {
+            return status;
+        }
+
+        vma->vm_private_data = &(device_data->m_tx_mappings);
+        vma->vm_ops = &g_device_ring_vm_operations;
+        device_ring_vma_open(vma);
+        return 0;
+    }
+
+    default:
+        return -EINVAL;
+    }
+}
+
+int device_uring_cmd(struct io_uring_cmd * command, unsigned int issue_flags) {
+    const struct device_uring_cmd * payload = io_uring_sqe_cmd(command->sqe);
+
+    // Only the commands of the device are submitted this way, the terminal ones (e.g. `TCSBRK`,
+    // which waits for the data to be sent) are left to `ioctl()`, so that none of them blocks
+    // the submitter without being known here.
+    if(_IOC_TYPE(command->cmd_op) != DEVICE_IOCTL_MAGIC) {
+        return -ENOTTY;
+    }
+
+    // AT command waits for the response, drain waits for the data to be sent, registration
+    // pins the pages and read of the registered buffer waits for the data, thus they can't be
+    // completed inline.
+    const bool is_blocking = command->cmd_op == DEVICE_IOCTL_AT_COMMAND ||
+        command->cmd_op == DEVICE_IOCTL_DRAIN || command->cmd_op == DEVICE_IOCTL_REGISTER_BUFFER ||
+        command->cmd_op == DEVICE_IOCTL_READ_REGISTERED;
+
+    if(is_blocking && (issue_flags & IO_URING_F_NONBLOCK)) {
+        return -EAGAIN;
+    }
+
+    const u64 argument = READ_ONCE(payload->m_argument);
+
+    return device_ioctl(command->file, command->cmd_op, (unsigned long) u64_to_user_ptr(argument));
 }
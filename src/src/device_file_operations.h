@@ -14,10 +14,9 @@
 
 /**
  * @brief Returns the `file_operations` structure that has implementation
- * of `open()`, `release()`, `read()`, and `write()`.
- *
- * @param device_data Structure that will be used to read from/write to the device file in sysfs.
+ * of `open()`, `release()`, `read()`, and `write()`. Each opened file finds
+ * its device data by the minor number of the device file.
  */
-struct file_operations * get_file_operations(struct device_data * device_data);
+struct file_operations * get_file_operations(void);
 
 #endif // DEVICE_FILE_OPERATIONS_H
@@ -0,0 +1,240 @@
+/**
+ * @brief File contains `ioctl()` commands and the `mmap()` layout of the device files, which are
+ * shared with userspace, thus it only includes the headers, which are available to userspace as well.
+ */
+
+#ifndef DEVICE_IOCTL_H
+#define DEVICE_IOCTL_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/**
+ * Magic number of the `ioctl()` commands of this driver.
+ */
+#define DEVICE_IOCTL_MAGIC 0xE7
+
+/**
+ * Maximum time budget of busy polling (in microseconds).
+ */
+#define DEVICE_BUSY_POLL_USECS_MAX 10000
+
+/**
+ * Sets the time budget of busy polling of this file (in microseconds, `__u32`), i.e. how long
+ * blocking `read()` spins on the received data before going to sleep, 0 disables busy polling.
+ * Setting applies only to the file, which it was made on, and is capped at
+ * `DEVICE_BUSY_POLL_USECS_MAX`.
+ */
+#define DEVICE_IOCTL_SET_BUSY_POLL _IOW(DEVICE_IOCTL_MAGIC, 1, __u32)
+
+/**
+ * Returns the time budget of busy polling of this file (in microseconds, `__u32`).
+ */
+#define DEVICE_IOCTL_GET_BUSY_POLL _IOR(DEVICE_IOCTL_MAGIC, 2, __u32)
+
+/**
+ * Number of bytes queued in the device in both directions along with the capacity of the queues.
+ */
+struct device_queue_depth {
+    /** Received bytes, which haven't been read yet. */
+    __u32 m_rx_bytes;
+    __u32 m_rx_capacity;
+
+    /** Written bytes, which haven't been sent to the adapter yet. */
+    __u32 m_tx_bytes;
+    __u32 m_tx_capacity;
+};
+
+/**
+ * Returns the queue depth of the device (`struct device_queue_depth`).
+ */
+#define DEVICE_IOCTL_GET_QUEUE_DEPTH _IOR(DEVICE_IOCTL_MAGIC, 3, struct device_queue_depth)
+
+/**
+ * Maximum length of the AT command and of its response (including the ending NUL character).
+ */
+#define DEVICE_AT_COMMAND_SIZE 64
+
+/**
+ * AT command of HC-06, e.g. `AT+VERSION` or `AT+BAUD4`, which is sent to the module, while
+ * it isn't paired. HC-06 doesn't terminate its responses, thus the response is complete,
+ * once no more bytes arrive for a short while after the first one or the timeout has passed.
+ */
+struct device_at_command {
+    /** NUL terminated command, which has to start with `AT`. */
+    char m_command[DEVICE_AT_COMMAND_SIZE];
+
+    /** NUL terminated response, which is filled by the driver. */
+    char m_response[DEVICE_AT_COMMAND_SIZE];
+
+    /** Time to wait for the response (in milliseconds), 0 means the default of 1 second. */
+    __u32 m_timeout_ms;
+};
+
+/**
+ * Sends the AT command and waits for its response (`struct device_at_command`). Any data, that
+ * has been received before the command, is dropped, and reads wait for the end of the exchange.
+ * Fails with `EBUSY`, while the RX ring or the TX ring is mapped.
+ */
+#define DEVICE_IOCTL_AT_COMMAND _IOWR(DEVICE_IOCTL_MAGIC, 4, struct device_at_command)
+
+/**
+ * Sends the written data, which is held back by TX coalescing, at once. The same could be done
+ * per write by passing `RWF_DSYNC` to `pwritev2()` or by opening the file with `O_DSYNC`.
+ * It is also the doorbell of the TX ring, which is mapped to userspace, i.e. it sends the data,
+ * that has been put into the ring, at once (`write()` of 0 bytes is the doorbell too, but it
+ * is subject to TX coalescing).
+ */
+#define DEVICE_IOCTL_TX_PUSH _IO(DEVICE_IOCTL_MAGIC, 5)
+
+/**
+ * Waits, until all the written data has left the host and the adapter reports its transmitter
+ * to be empty, the same as `fsync()` and `tcdrain()` (i.e. `TCSBRK` with non-zero argument).
+ */
+#define DEVICE_IOCTL_DRAIN _IO(DEVICE_IOCTL_MAGIC, 6)
+
+/**
+ * Maximum length of the buffer, which is registered via `DEVICE_IOCTL_REGISTER_BUFFER`.
+ */
+#define DEVICE_REGISTERED_BUFFER_SIZE_MAX (16 * 1024 * 1024)
+
+/**
+ * Buffer of the process, which large reads of the file are made into.
+ */
+struct device_registered_buffer {
+    /** Address of the buffer. */
+    __u64 m_address;
+
+    /** Length of the buffer, 0 unregisters the buffer, which has been registered before. */
+    __u64 m_length;
+};
+
+/**
+ * Registers the buffer for the reads of this file (`struct device_registered_buffer`). Pages of
+ * the buffer are pinned once, thus a large `DEVICE_IOCTL_READ_REGISTERED` into any part of it takes
+ * the received data straight from the completion of the bulk IN URBs, bypassing the ring of the
+ * received data, without pinning the pages each time. Registering another buffer replaces the
+ * previous one, the buffer is unregistered along with the closing of the file as well. Pinned pages
+ * count against `RLIMIT_MEMLOCK`, unless the process has `CAP_IPC_LOCK`.
+ */
+#define DEVICE_IOCTL_REGISTER_BUFFER _IOW(DEVICE_IOCTL_MAGIC, 7, struct device_registered_buffer)
+
+/**
+ * Part of the registered buffer, which `DEVICE_IOCTL_READ_REGISTERED` reads into.
+ */
+struct device_registered_read {
+    /** Offset of the part from the beginning of the registered buffer. */
+    __u64 m_offset;
+
+    /** Length of the part, i.e. the maximum number of bytes to read. */
+    __u64 m_length;
+};
+
+/**
+ * Reads into the part of the registered buffer (`struct device_registered_read`) the same way as
+ * `read()` does, the result is the number of bytes read. Data goes into the pinned pages, whatever
+ * is mapped at the address of the buffer now, thus only the process, that has registered the buffer,
+ * reads into it (`EPERM` otherwise). Fails with `EINVAL`, if no buffer is registered or the part
+ * isn't within it.
+ */
+#define DEVICE_IOCTL_READ_REGISTERED _IOW(DEVICE_IOCTL_MAGIC, 10, struct device_registered_read)
+
+/**
+ * Flags of the timestamp mode of the file. With `DEVICE_RX_TIMESTAMP_LATENCY_CORRECTED` the latency
+ * timer is subtracted from the arrival time of the data, which the chip has sent, once its latency
+ * timer has expired, as an estimate of the time the data has spent in the chip.
+ */
+#define DEVICE_RX_TIMESTAMP_ENABLE (1U << 0)
+#define DEVICE_RX_TIMESTAMP_LATENCY_CORRECTED (1U << 1)
+
+/**
+ * Chunk of the received data, which is returned by `read()` in the timestamp mode. Each chunk
+ * is the header, which is followed by `m_length` bytes of the data, that have arrived at the same
+ * time, i.e. by the same bulk IN transfer. Data, which doesn't fit into the buffer of `read()`,
+ * is returned by the next `read()` in a chunk with the same arrival time.
+ */
+struct device_rx_chunk {
+    /** Arrival time of the data at the host (`CLOCK_MONOTONIC`, in nanoseconds), 0 if unknown. */
+    __u64 m_timestamp_ns;
+
+    /** Number of bytes of the data, which follow the header. */
+    __u32 m_length;
+    __u32 m_reserved;
+};
+
+/**
+ * Sets the timestamp mode of this file (`__u32` of `DEVICE_RX_TIMESTAMP_*` flags, 0 disables it).
+ * In the timestamp mode `read()` returns the data as `struct device_rx_chunk` chunks, thus its
+ * buffer has to fit the header of the chunk and at least one byte of the data.
+ */
+#define DEVICE_IOCTL_SET_RX_TIMESTAMPS _IOW(DEVICE_IOCTL_MAGIC, 8, __u32)
+
+/**
+ * Returns the timestamp mode of this file (`__u32` of `DEVICE_RX_TIMESTAMP_*` flags).
+ */
+#define DEVICE_IOCTL_GET_RX_TIMESTAMPS _IOR(DEVICE_IOCTL_MAGIC, 9, __u32)
+
+/**
+ * Maximum size of the message in the framed mode, which is selected by the `framing` sysfs attribute
+ * of the device (`none`, `cobs` or `slip`). In the framed mode each `write()` is a single message,
+ * which is framed by the driver, and each `read()` returns a single decoded message (`-EMSGSIZE` if
+ * it doesn't fit into the buffer, the message is kept then). Ring with the received data can't be
+ * mapped to userspace in the framed mode (`EBUSY`), as it holds the sizes of the messages, neither
+ * can the ring with the data to send, as its messages are framed by `write()`.
+ * The `framing_crc` sysfs attribute (`none`, `crc16` or `crc32c`) makes the driver append the CRC
+ * (little endian) to each written message and verify and strip it from each received one, messages
+ * with the wrong CRC are dropped and counted by `rx_bad_crc_frames` of the debugfs `hot_path_stats` file,
+ * frames without a message (i.e. with the CRC only) are counted by `rx_bad_frames`.
+ */
+#define DEVICE_FRAMING_MESSAGE_SIZE_MAX 4096
+
+/**
+ * Payload of the `IORING_OP_URING_CMD` submissions of the device files, which is located in the
+ * command area of the submission queue entry. The `cmd_op` of the submission is one of the
+ * `DEVICE_IOCTL_*` commands and `m_argument` is the pointer, which would be passed to `ioctl()`.
+ * Result of the command is the result of the completion queue entry. Terminal commands
+ * (e.g. `TCSBRK`) are refused (`ENOTTY`), they are available via `ioctl()` only.
+ */
+struct device_uring_cmd {
+    __u64 m_argument;
+};
+
+/**
+ * Offset of the `mmap()` of the device file, which maps the ring with the received data
+ * (`MAP_SHARED` only). Mapping starts with a page of `struct device_ring_indices`, which is
+ * followed by the data of the ring, thus its length is the page size plus `m_rx_capacity`
+ * of `DEVICE_IOCTL_GET_QUEUE_DEPTH`. Process, that maps the ring, takes the place of `read()`:
+ * it loads `m_head` with acquire semantics, reads the bytes from `m_tail` up to it (indices
+ * are free-running, i.e. the offset in the data is `index & (capacity - 1)`) and stores the new
+ * `m_tail` with release semantics. `poll()` reports `POLLIN`, once there is new data.
+ */
+#define DEVICE_MMAP_RX_RING_OFFSET 0ULL
+
+/**
+ * Offset of the `mmap()` of the device file, which maps the ring with the data to send
+ * (`MAP_SHARED` only). Layout is the same as of the RX ring, its length is the page size plus
+ * `m_tx_capacity` of `DEVICE_IOCTL_GET_QUEUE_DEPTH`. Process, that maps the ring, takes the place
+ * of `write()`: it loads `m_tail` with acquire semantics, puts the bytes from `m_head` up to
+ * `m_tail + capacity`, stores the new `m_head` with release semantics and rings the doorbell
+ * (`DEVICE_IOCTL_TX_PUSH` or `write()` of 0 bytes). `poll()` reports `POLLOUT`, once there is
+ * free space. Data is sent directly from the ring, it isn't copied by the driver at all. While
+ * the ring is mapped, `write()` of any data and `DEVICE_IOCTL_AT_COMMAND` fail with `EBUSY`.
+ * Ring of the framed device can't be mapped (`EBUSY`).
+ */
+#define DEVICE_MMAP_TX_RING_OFFSET 0x10000000ULL
+
+/**
+ * Producer and consumer indices of the ring, which is mapped to userspace. Each index is
+ * on its own cache line, so that the producer and the consumer don't share it.
+ */
+struct device_ring_indices {
+    /** Producer index, i.e. where the next byte will be written to. */
+    __u32 m_head;
+    __u32 m_reserved0[15];
+
+    /** Consumer index, i.e. where the next byte will be read from. */
+    __u32 m_tail;
+    __u32 m_reserved1[15];
+};
+
+#endif // DEVICE_IOCTL_H
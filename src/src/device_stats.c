@@ -0,0 +1,160 @@
+#include "device_stats.h"
+#include "custom_macros.h"
+
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+
+const char * const g_hot_path_op_names[HOT_PATH_OP_COUNT] = {
+    [HOT_PATH_OP_READ] = "read",
+    [HOT_PATH_OP_WRITE] = "write",
+    [HOT_PATH_OP_TX_URB_SUBMIT] = "tx_urb_submit",
+    [HOT_PATH_OP_TX_URB_COMPLETE] = "tx_urb_complete",
+    [HOT_PATH_OP_RX_URB_COMPLETE] = "rx_urb_complete",
+};
+
+int device_stats_allocate(struct device_stats * stats) {
+    // Per-CPU memory is zeroed by `alloc_percpu()`.
+    stats->m_counters = alloc_percpu(struct hot_path_counters);
+    stats->m_debugfs_dir = NULL;
+
+    return stats->m_counters ? 0 : -ENOMEM;
+}
+
+void device_stats_free(struct device_stats * stats) {
+    free_percpu(stats->m_counters);
+    stats->m_counters = NULL;
+}
+
+void device_stats_sum(struct device_stats * stats, struct hot_path_counters * sum) {
+    memset(sum, 0, sizeof(*sum));
+
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        const struct hot_path_counters * counters = per_cpu_ptr(stats->m_counters, cpu);
+
+        for(int op = 0; op < HOT_PATH_OP_COUNT; ++op) {
+            sum->m_ops[op].m_calls += counters->m_ops[op].m_calls;
+            sum->m_ops[op].m_ns += counters->m_ops[op].m_ns;
+            sum->m_ops[op].m_bytes += counters->m_ops[op].m_bytes;
+        }
+
+        sum->m_mutex_contended += counters->m_mutex_contended;
+        sum->m_rx_dropped_bytes += counters->m_rx_dropped_bytes;
+        sum->m_rx_direct_bytes += counters->m_rx_direct_bytes;
+        sum->m_rx_bad_frames += counters->m_rx_bad_frames;
+        sum->m_rx_bad_crc_frames += counters->m_rx_bad_crc_frames;
+        sum->m_suspends += counters->m_suspends;
+        sum->m_resumes += counters->m_resumes;
+        sum->m_resume_first_byte_count += counters->m_resume_first_byte_count;
+        sum->m_resume_first_byte_ns += counters->m_resume_first_byte_ns;
+        sum->m_busy_poll_hits += counters->m_busy_poll_hits;
+        sum->m_busy_poll_misses += counters->m_busy_poll_misses;
+        sum->m_tx_coalesce_held_writes += counters->m_tx_coalesce_held_writes;
+        sum->m_tx_coalesce_batches += counters->m_tx_coalesce_batches;
+    }
+}
+
+/**
+ * @brief Prints the counters as `<name> <value>` lines, so that they could be parsed by
+ * scripts and the `bench` tool. Averages per operation are printed with 3 decimal places.
+ */
+static int device_stats_show(struct seq_file * file, void * unused) {
+    struct device_stats * stats = file->private;
+    struct hot_path_counters sum;
+
+    device_stats_sum(stats, &sum);
+
+    for(int op = 0; op < HOT_PATH_OP_COUNT; ++op) {
+        const struct hot_path_op_counters * counters = &(sum.m_ops[op]);
+        const char * name = g_hot_path_op_names[op];
+        const u64 calls = counters->m_calls ? counters->m_calls : 1;
+
+        seq_printf(file, "%s_calls %llu\n", name, counters->m_calls);
+        seq_printf(file, "%s_bytes %llu\n", name, counters->m_bytes);
+        seq_printf(file, "%s_ns %llu\n", name, counters->m_ns);
+        seq_printf(file, "%s_ns_per_op %llu\n", name, div64_u64(counters->m_ns, calls));
+    }
+
+    seq_printf(file, "mutex_contended %llu\n", sum.m_mutex_contended);
+    seq_printf(file, "rx_dropped_bytes %llu\n", sum.m_rx_dropped_bytes);
+    seq_printf(file, "rx_direct_bytes %llu\n", sum.m_rx_direct_bytes);
+    seq_printf(file, "rx_bad_frames %llu\n", sum.m_rx_bad_frames);
+    seq_printf(file, "rx_bad_crc_frames %llu\n", sum.m_rx_bad_crc_frames);
+    seq_printf(file, "suspends %llu\n", sum.m_suspends);
+    seq_printf(file, "resumes %llu\n", sum.m_resumes);
+    seq_printf(file, "resume_to_first_byte_count %llu\n", sum.m_resume_first_byte_count);
+    seq_printf(file, "resume_to_first_byte_ns %llu\n", sum.m_resume_first_byte_ns);
+    seq_printf(file, "resume_to_first_byte_ns_per_resume %llu\n", div64_u64(sum.m_resume_first_byte_ns,
+        sum.m_resume_first_byte_count ? sum.m_resume_first_byte_count : 1
+    ));
+
+    const u64 busy_polls = sum.m_busy_poll_hits + sum.m_busy_poll_misses;
+    const u64 busy_poll_hits_per_kilo = div64_u64(sum.m_busy_poll_hits * 1000, busy_polls ? busy_polls : 1);
+
+    seq_printf(file, "busy_poll_hits %llu\n", sum.m_busy_poll_hits);
+    seq_printf(file, "busy_poll_misses %llu\n", sum.m_busy_poll_misses);
+    seq_printf(file, "busy_poll_hit_ratio %llu.%03llu\n",
+        busy_poll_hits_per_kilo / 1000, busy_poll_hits_per_kilo % 1000
+    );
+
+    const u64 held_writes_per_kilo_batch = div64_u64(sum.m_tx_coalesce_held_writes * 1000,
+        sum.m_tx_coalesce_batches ? sum.m_tx_coalesce_batches : 1
+    );
+
+    seq_printf(file, "tx_coalesce_held_writes %llu\n", sum.m_tx_coalesce_held_writes);
+    seq_printf(file, "tx_coalesce_batches %llu\n", sum.m_tx_coalesce_batches);
+    seq_printf(file, "tx_coalesce_held_writes_per_batch %llu.%03llu\n",
+        held_writes_per_kilo_batch / 1000, held_writes_per_kilo_batch % 1000
+    );
+
+    return 0;
+}
+
+static int device_stats_open(struct inode * inode, struct file * filep) {
+    return single_open(filep, device_stats_show, inode->i_private);
+}
+
+/**
+ * @brief Resets the counters of all CPUs. Updates that race with the reset may
+ * survive it, which is fine for statistics.
+ */
+static ssize_t device_stats_write(struct file * filep, const char __user * user_buffer,
+    size_t num_bytes, loff_t * file_offset
+) {
+    struct device_stats * stats = ((struct seq_file *) filep->private_data)->private;
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        memset(per_cpu_ptr(stats->m_counters, cpu), 0, sizeof(struct hot_path_counters));
+    }
+
+    return num_bytes;
+}
+
+static const struct file_operations g_device_stats_file_operations = {
+    .owner = THIS_MODULE,
+    .open = device_stats_open,
+    .read = seq_read,
+    .write = device_stats_write,
+    .llseek = seq_lseek,
+    .release = single_release,
+};
+
+void device_stats_debugfs_create(struct device_stats * stats, const char * name) {
+    // Debugfs failures are not fatal for the driver, thus return values are not checked,
+    // as it is recommended for the debugfs API.
+    stats->m_debugfs_dir = debugfs_create_dir(name, NULL);
+    debugfs_create_file("hot_path_stats", 0600, stats->m_debugfs_dir, stats,
+        &g_device_stats_file_operations
+    );
+}
+
+void device_stats_debugfs_remove(struct device_stats * stats) {
+    debugfs_remove_recursive(stats->m_debugfs_dir);
+    stats->m_debugfs_dir = NULL;
+}
@@ -0,0 +1,241 @@
+/**
+ * @brief File contains counters of the data path (file operations and URB handlers),
+ * which are used to measure per-call costs of the hot path without any USB device
+ * specific tooling. Counters are exposed via debugfs in
+ * `/sys/kernel/debug/<usb_device_class_name><minor>/hot_path_stats`.
+ */
+
+#ifndef DEVICE_STATS_H
+#define DEVICE_STATS_H
+
+/** Header that contains per-CPU variables and `this_cpu_*()` operations. */
+#include <linux/percpu.h>
+
+/** Header that contains `ktime_get_ns()`. */
+#include <linux/ktime.h>
+
+#include <linux/types.h>
+
+struct dentry;
+
+/**
+ * Operations of the hot path, which are measured separately.
+ */
+enum hot_path_op {
+    HOT_PATH_OP_READ,
+    HOT_PATH_OP_WRITE,
+    HOT_PATH_OP_TX_URB_SUBMIT,
+    HOT_PATH_OP_TX_URB_COMPLETE,
+    HOT_PATH_OP_RX_URB_COMPLETE,
+    HOT_PATH_OP_COUNT
+};
+
+/**
+ * Names of the hot path operations, which are used as prefixes in the statistics file.
+ */
+extern const char * const g_hot_path_op_names[HOT_PATH_OP_COUNT];
+
+/**
+ * Counters of a single hot path operation.
+ */
+struct hot_path_op_counters {
+    /** Number of calls of the operation. */
+    u64 m_calls;
+
+    /** Total time spent in the operation (in nanoseconds). */
+    u64 m_ns;
+
+    /** Total number of bytes that were processed by the operation. */
+    u64 m_bytes;
+};
+
+/**
+ * Counters of all hot path operations. An instance of this structure is kept per CPU,
+ * so that updating the counters doesn't add any cache line bouncing between the CPUs,
+ * i.e. measurements under concurrency are not distorted by the measurement itself.
+ */
+struct hot_path_counters {
+    struct hot_path_op_counters m_ops[HOT_PATH_OP_COUNT];
+
+    /** Number of times the device mutex was already locked by another process. */
+    u64 m_mutex_contended;
+
+    /** Number of received bytes that were dropped, as the RX ring was full. */
+    u64 m_rx_dropped_bytes;
+
+    /** Number of received bytes that were put straight into the buffers of the readers. */
+    u64 m_rx_direct_bytes;
+
+    /** Number of received frames that were dropped, as they were malformed or too long. */
+    u64 m_rx_bad_frames;
+
+    /** Number of received messages that were dropped, as their CRC was wrong. */
+    u64 m_rx_bad_crc_frames;
+
+    /** Number of runtime suspends and resumes of the device. */
+    u64 m_suspends;
+    u64 m_resumes;
+
+    /**
+     * Number of resumes, which were caused by the first opened file and followed by received
+     * data, and the total time from those resumes to the first received byte (in nanoseconds).
+     */
+    u64 m_resume_first_byte_count;
+    u64 m_resume_first_byte_ns;
+
+    /**
+     * Number of busy polls in `read()`, which have found the data within the time budget
+     * (hits) and which have run out of it and gone to sleep (misses).
+     */
+    u64 m_busy_poll_hits;
+    u64 m_busy_poll_misses;
+
+    /**
+     * Number of writes, which have been held back by TX coalescing, and the number of URBs,
+     * which have sent the held data, i.e. of the batches formed out of those writes.
+     */
+    u64 m_tx_coalesce_held_writes;
+    u64 m_tx_coalesce_batches;
+};
+
+/**
+ * Statistics of a single device.
+ */
+struct device_stats {
+    struct hot_path_counters __percpu * m_counters;
+
+    /** Debugfs directory, where the statistics file is located. */
+    struct dentry * m_debugfs_dir;
+};
+
+/**
+ * @brief Allocates per-CPU counters.
+ *
+ * @return 0 on success, `-ENOMEM` on failure.
+ */
+int device_stats_allocate(struct device_stats * stats);
+
+/**
+ * @brief Frees per-CPU counters, should be called after `device_stats_debugfs_remove()`.
+ */
+void device_stats_free(struct device_stats * stats);
+
+/**
+ * @brief Sums up the counters of all CPUs.
+ */
+void device_stats_sum(struct device_stats * stats, struct hot_path_counters * sum);
+
+/**
+ * @brief Creates debugfs directory with the given name and the `hot_path_stats` file in it.
+ * Reading the file prints the counters, writing anything to it resets them.
+ */
+void device_stats_debugfs_create(struct device_stats * stats, const char * name);
+
+/**
+ * @brief Removes debugfs directory, which was created by `device_stats_debugfs_create()`.
+ */
+void device_stats_debugfs_remove(struct device_stats * stats);
+
+/**
+ * @brief Returns the timestamp, which should be passed to `device_stats_op_end()`,
+ * once the operation is done.
+ */
+static inline u64 device_stats_op_start(void) {
+    return ktime_get_ns();
+}
+
+/**
+ * @brief Accounts a single call of the operation, which started at `start_ns`
+ * and processed `num_bytes` bytes.
+ */
+static inline void device_stats_op_end(struct device_stats * stats, enum hot_path_op op,
+    u64 start_ns, size_t num_bytes
+) {
+    this_cpu_inc(stats->m_counters->m_ops[op].m_calls);
+    this_cpu_add(stats->m_counters->m_ops[op].m_ns, ktime_get_ns() - start_ns);
+    this_cpu_add(stats->m_counters->m_ops[op].m_bytes, num_bytes);
+}
+
+/**
+ * @brief Accounts a contended lock of the device mutex.
+ */
+static inline void device_stats_mutex_contended(struct device_stats * stats) {
+    this_cpu_inc(stats->m_counters->m_mutex_contended);
+}
+
+/**
+ * @brief Accounts received bytes that didn't fit into the RX ring.
+ */
+static inline void device_stats_rx_dropped(struct device_stats * stats, unsigned int num_bytes) {
+    this_cpu_add(stats->m_counters->m_rx_dropped_bytes, num_bytes);
+}
+
+/**
+ * @brief Accounts received bytes that bypassed the RX ring.
+ */
+static inline void device_stats_rx_direct(struct device_stats * stats, unsigned int num_bytes) {
+    this_cpu_add(stats->m_counters->m_rx_direct_bytes, num_bytes);
+}
+
+/**
+ * @brief Accounts received frames that were dropped.
+ */
+static inline void device_stats_rx_bad_frames(struct device_stats * stats, unsigned int num_frames) {
+    this_cpu_add(stats->m_counters->m_rx_bad_frames, num_frames);
+}
+
+/**
+ * @brief Accounts a received message that was dropped due to its CRC.
+ */
+static inline void device_stats_rx_bad_crc_frame(struct device_stats * stats) {
+    this_cpu_inc(stats->m_counters->m_rx_bad_crc_frames);
+}
+
+/**
+ * @brief Accounts a suspend of the device.
+ */
+static inline void device_stats_suspend(struct device_stats * stats) {
+    this_cpu_inc(stats->m_counters->m_suspends);
+}
+
+/**
+ * @brief Accounts a resume of the device.
+ */
+static inline void device_stats_resume(struct device_stats * stats) {
+    this_cpu_inc(stats->m_counters->m_resumes);
+}
+
+/**
+ * @brief Accounts the time from the resume of the device to the first byte received after it.
+ */
+static inline void device_stats_resume_first_byte(struct device_stats * stats, u64 latency_ns) {
+    this_cpu_inc(stats->m_counters->m_resume_first_byte_count);
+    this_cpu_add(stats->m_counters->m_resume_first_byte_ns, latency_ns);
+}
+
+/**
+ * @brief Accounts a busy poll, which has either found the data (hit) or not (miss).
+ */
+static inline void device_stats_busy_poll(struct device_stats * stats, bool is_hit) {
+    if(is_hit) {
+        this_cpu_inc(stats->m_counters->m_busy_poll_hits);
+    } else {
+        this_cpu_inc(stats->m_counters->m_busy_poll_misses);
+    }
+}
+
+/**
+ * @brief Accounts a write, which has been held back by TX coalescing.
+ */
+static inline void device_stats_tx_coalesce_held(struct device_stats * stats) {
+    this_cpu_inc(stats->m_counters->m_tx_coalesce_held_writes);
+}
+
+/**
+ * @brief Accounts a URB, which has sent the data of the held writes.
+ */
+static inline void device_stats_tx_coalesce_batch(struct device_stats * stats) {
+    this_cpu_inc(stats->m_counters->m_tx_coalesce_batches);
+}
+
+#endif // DEVICE_STATS_H
@@ -0,0 +1,712 @@
+#include "framing.h"
+
+#include <linux/debugfs.h>
+#include <linux/errno.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/version.h>
+#include <linux/crc-t10dif.h>
+#include <kunit/visibility.h>
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 14, 0)
+#   include <linux/crc32.h>
+#else
+#   include <linux/crc32c.h>
+#endif
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 12, 0)
+#   include <linux/unaligned.h>
+#else
+#   include <asm/unaligned.h>
+#endif
+
+/**
+ * Largest COBS block, i.e. the code byte, which isn't followed by an implied zero.
+ */
+#define COBS_BLOCK_MAX 0xFF
+
+/**
+ * @brief Returns true if some byte of the word is zero. Expression has no false positives,
+ * as the borrow, that could mark a non-zero byte, comes only from a lower zero byte.
+ */
+static inline bool framing_has_zero_byte(unsigned long word) {
+    return ((word - REPEAT_BYTE(0x01)) & ~word & REPEAT_BYTE(0x80)) != 0;
+}
+
+/**
+ * @brief Returns the offset of the first byte, that is either `first` or `second`, `num_bytes` if
+ * there is no such byte. Data is scanned a word at a time, only the word with the byte is scanned
+ * byte by byte, thus the runs of the ordinary bytes between the special ones cost a few
+ * instructions per word instead of a compare and a branch per byte.
+ */
+static size_t framing_find(const u8 * data, size_t num_bytes, u8 first, u8 second) {
+    const unsigned long first_pattern = REPEAT_BYTE(first);
+    const unsigned long second_pattern = REPEAT_BYTE(second);
+    size_t offset = 0;
+
+    for(; offset + sizeof(unsigned long) <= num_bytes; offset += sizeof(unsigned long)) {
+        const unsigned long word = get_unaligned((const unsigned long *) (data + offset));
+
+        if(framing_has_zero_byte(word ^ first_pattern) || framing_has_zero_byte(word ^ second_pattern)) {
+            break;
+        }
+    }
+
+    for(; offset < num_bytes; ++offset) {
+        if(data[offset] == first || data[offset] == second) {
+            break;
+        }
+    }
+
+    return offset;
+}
+
+const char * const g_framing_type_names[FRAMING_TYPE_COUNT] = {
+    [FRAMING_NONE] = "none",
+    [FRAMING_COBS] = "cobs",
+    [FRAMING_SLIP] = "slip"
+};
+
+const char * const g_framing_crc_names[FRAMING_CRC_COUNT] = {
+    [FRAMING_CRC_NONE] = "none",
+    [FRAMING_CRC_CRC16] = "crc16",
+    [FRAMING_CRC_CRC32C] = "crc32c"
+};
+
+// -----
+// CRCs.
+// -----
+
+/**
+ * @brief Computes the CRC of the message. Kernel picks the accelerated implementation of each
+ * CRC (e.g. PCLMULQDQ or the `crc32` instruction on x86), if the CPU has it.
+ */
+static u32 framing_crc_compute(enum framing_crc crc, const u8 * message, size_t num_bytes) {
+    switch(crc) {
+    case FRAMING_CRC_CRC16:
+        return crc_t10dif(message, num_bytes);
+
+    case FRAMING_CRC_CRC32C:
+        // Library doesn't invert the CRC, while the standard CRC32C is inverted on both ends.
+        return ~crc32c(~0U, message, num_bytes);
+
+    default:
+        return 0;
+    }
+}
+
+size_t framing_crc_append(enum framing_crc crc, u8 * message, size_t num_bytes) {
+    const unsigned int crc_size = framing_crc_size(crc);
+    const u32 value = framing_crc_compute(crc, message, num_bytes);
+
+    for(unsigned int i = 0; i < crc_size; ++i) {
+        message[num_bytes + i] = value >> (8 * i);
+    }
+
+    return num_bytes + crc_size;
+}
+
+long framing_crc_verify(enum framing_crc crc, const u8 * message, size_t num_bytes) {
+    const unsigned int crc_size = framing_crc_size(crc);
+    u32 value = 0;
+
+    if(num_bytes < crc_size) {
+        return -EBADMSG;
+    }
+
+    num_bytes -= crc_size;
+
+    for(unsigned int i = 0; i < crc_size; ++i) {
+        value |= (u32) message[num_bytes + i] << (8 * i);
+    }
+
+    return framing_crc_compute(crc, message, num_bytes) == value ? (long) num_bytes : -EBADMSG;
+}
+
+// ---------
+// Encoders.
+// ---------
+
+/**
+ * @brief Splits the message into blocks of non-zero bytes, each of them starts with the code
+ * byte, i.e. the distance to the next zero, so that the frame has no zero but its delimiter.
+ */
+VISIBLE_IF_KUNIT size_t cobs_encode_scalar(const u8 * message, size_t num_bytes, u8 * frame) {
+    u8 * code = frame;
+    size_t length = 1;
+
+    *code = 1;
+
+    for(size_t i = 0; i < num_bytes; ++i) {
+        if(message[i]) {
+            frame[length++] = message[i];
+            ++(*code);
+        }
+
+        // Zero ends the block, as well as the block, which can't grow anymore.
+        if(!message[i] || *code == COBS_BLOCK_MAX) {
+            code = &(frame[length++]);
+            *code = 1;
+        }
+    }
+
+    frame[length++] = 0;
+    return length;
+}
+
+/**
+ * @brief Escapes the delimiter and the escape byte in the message and surrounds it with the
+ * delimiters, the leading one flushes the noise, which the receiver could have got in between.
+ */
+VISIBLE_IF_KUNIT size_t slip_encode_scalar(const u8 * message, size_t num_bytes, u8 * frame) {
+    size_t length = 0;
+
+    frame[length++] = SLIP_END;
+
+    for(size_t i = 0; i < num_bytes; ++i) {
+        switch(message[i]) {
+        case SLIP_END:
+            frame[length++] = SLIP_ESC;
+            frame[length++] = SLIP_ESC_END;
+            break;
+
+        case SLIP_ESC:
+            frame[length++] = SLIP_ESC;
+            frame[length++] = SLIP_ESC_ESC;
+            break;
+
+        default:
+            frame[length++] = message[i];
+            break;
+        }
+    }
+
+    frame[length++] = SLIP_END;
+    return length;
+}
+
+/**
+ * @brief The same as `cobs_encode_scalar()`, but each block is found by `framing_find()` and copied
+ * at once. Output is the same byte for byte.
+ */
+static size_t cobs_encode_word(const u8 * message, size_t num_bytes, u8 * frame) {
+    size_t length = 0;
+    size_t offset = 0;
+
+    for(;;) {
+        const size_t run = framing_find(message + offset,
+            min_t(size_t, num_bytes - offset, COBS_BLOCK_MAX - 1), 0, 0
+        );
+
+        frame[length] = run + 1;
+        memcpy(frame + length + 1, message + offset, run);
+        length += run + 1;
+        offset += run;
+
+        // Full block isn't followed by an implied zero, thus it's followed by another block,
+        // even at the end of the message.
+        if(run == COBS_BLOCK_MAX - 1) {
+            continue;
+        }
+
+        if(offset == num_bytes) {
+            break;
+        }
+
+        // Zero is implied by the end of the block.
+        ++offset;
+    }
+
+    frame[length++] = 0;
+    return length;
+}
+
+/**
+ * @brief The same as `slip_encode_scalar()`, but the runs of the ordinary bytes are found by
+ * `framing_find()` and copied at once.
+ */
+static size_t slip_encode_word(const u8 * message, size_t num_bytes, u8 * frame) {
+    size_t length = 0;
+    size_t offset = 0;
+
+    frame[length++] = SLIP_END;
+
+    while(offset < num_bytes) {
+        const size_t run = framing_find(message + offset, num_bytes - offset, SLIP_END, SLIP_ESC);
+
+        memcpy(frame + length, message + offset, run);
+        length += run;
+        offset += run;
+
+        if(offset == num_bytes) {
+            break;
+        }
+
+        frame[length++] = SLIP_ESC;
+        frame[length++] = message[offset++] == SLIP_END ? SLIP_ESC_END : SLIP_ESC_ESC;
+    }
+
+    frame[length++] = SLIP_END;
+    return length;
+}
+
+size_t framing_encode(enum framing_type type, const u8 * message, size_t num_bytes, u8 * frame) {
+    switch(type) {
+    case FRAMING_COBS:
+        return cobs_encode_word(message, num_bytes, frame);
+
+    case FRAMING_SLIP:
+        return slip_encode_word(message, num_bytes, frame);
+
+    default:
+        memcpy(frame, message, num_bytes);
+        return num_bytes;
+    }
+}
+
+// ---------
+// Decoders.
+// ---------
+
+int framing_decoder_allocate(struct framing_decoder * decoder, unsigned int capacity) {
+    decoder->m_message = kmalloc(capacity, GFP_KERNEL);
+
+    if(!decoder->m_message) {
+        return -ENOMEM;
+    }
+
+    decoder->m_capacity = capacity;
+    framing_decoder_reset(decoder, FRAMING_NONE);
+    return 0;
+}
+
+void framing_decoder_free(struct framing_decoder * decoder) {
+    kfree(decoder->m_message);
+    decoder->m_message = NULL;
+}
+
+/**
+ * @brief Starts decoding of the next frame.
+ */
+static void framing_decoder_next(struct framing_decoder * decoder) {
+    decoder->m_length = 0;
+    decoder->m_cobs_remaining = 0;
+    decoder->m_cobs_has_zero = false;
+    decoder->m_slip_is_escaped = false;
+    decoder->m_is_bad = false;
+}
+
+void framing_decoder_reset(struct framing_decoder * decoder, enum framing_type type) {
+    decoder->m_type = type;
+    framing_decoder_next(decoder);
+}
+
+/**
+ * @brief Appends the byte to the message, the frame is bad, once the message doesn't fit.
+ */
+static void framing_decoder_append(struct framing_decoder * decoder, u8 byte) {
+    if(decoder->m_length == decoder->m_capacity) {
+        decoder->m_is_bad = true;
+        return;
+    }
+
+    decoder->m_message[decoder->m_length++] = byte;
+}
+
+/**
+ * @brief Completes the frame at its delimiter. Empty frames (e.g. the leading delimiter of SLIP)
+ * carry no message.
+ *
+ * @return 1 if the frame has been bad, 0 otherwise.
+ */
+static unsigned int framing_decoder_complete(struct framing_decoder * decoder, bool is_bad,
+    framing_message_fn on_message, void * context
+) {
+    const unsigned int length = decoder->m_length;
+
+    framing_decoder_next(decoder);
+
+    if(is_bad) {
+        return 1;
+    }
+
+    if(length) {
+        on_message(context, decoder->m_message, length);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Appends the run of bytes to the message, the frame is bad, once the message doesn't fit.
+ */
+static void framing_decoder_append_run(struct framing_decoder * decoder, const u8 * data, size_t num_bytes) {
+    if(num_bytes > decoder->m_capacity - decoder->m_length) {
+        decoder->m_is_bad = true;
+        return;
+    }
+
+    memcpy(decoder->m_message + decoder->m_length, data, num_bytes);
+    decoder->m_length += num_bytes;
+}
+
+/**
+ * @brief Decodes a single byte of the COBS frame.
+ *
+ * @return 1 if the byte has completed a bad frame, 0 otherwise.
+ */
+static unsigned int cobs_decode_byte(struct framing_decoder * decoder, u8 byte,
+    framing_message_fn on_message, void * context
+) {
+    if(!byte) {
+        // Frame is complete only at the end of its last block, whose implied zero is dropped.
+        return framing_decoder_complete(decoder, decoder->m_is_bad || decoder->m_cobs_remaining,
+            on_message, context
+        );
+    }
+
+    if(decoder->m_is_bad) {
+        return 0;
+    }
+
+    if(decoder->m_cobs_remaining == 0) {
+        // Code byte of the next block, the previous block is followed by its implied zero.
+        if(decoder->m_cobs_has_zero) {
+            framing_decoder_append(decoder, 0);
+        }
+
+        decoder->m_cobs_remaining = byte - 1;
+        decoder->m_cobs_has_zero = byte != COBS_BLOCK_MAX;
+    } else {
+        framing_decoder_append(decoder, byte);
+        --(decoder->m_cobs_remaining);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Decodes a single byte of the SLIP frame.
+ *
+ * @return 1 if the byte has completed a bad frame, 0 otherwise.
+ */
+static unsigned int slip_decode_byte(struct framing_decoder * decoder, u8 byte,
+    framing_message_fn on_message, void * context
+) {
+    if(byte == SLIP_END) {
+        return framing_decoder_complete(decoder, decoder->m_is_bad, on_message, context);
+    }
+
+    if(decoder->m_is_bad) {
+        return 0;
+    }
+
+    if(decoder->m_slip_is_escaped) {
+        decoder->m_slip_is_escaped = false;
+
+        if(byte == SLIP_ESC_END) {
+            framing_decoder_append(decoder, SLIP_END);
+        } else if(byte == SLIP_ESC_ESC) {
+            framing_decoder_append(decoder, SLIP_ESC);
+        } else {
+            decoder->m_is_bad = true;
+        }
+    } else if(byte == SLIP_ESC) {
+        decoder->m_slip_is_escaped = true;
+    } else {
+        framing_decoder_append(decoder, byte);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Decodes the received bytes one by one, it's the reference for `framing_decode()`.
+ */
+VISIBLE_IF_KUNIT unsigned int framing_decode_scalar(struct framing_decoder * decoder, const u8 * data,
+    size_t num_bytes, framing_message_fn on_message, void * context
+) {
+    unsigned int bad_frames = 0;
+
+    for(size_t i = 0; i < num_bytes; ++i) {
+        switch(decoder->m_type) {
+        case FRAMING_COBS:
+            bad_frames += cobs_decode_byte(decoder, data[i], on_message, context);
+            break;
+
+        case FRAMING_SLIP:
+            bad_frames += slip_decode_byte(decoder, data[i], on_message, context);
+            break;
+
+        default:
+            on_message(context, data, num_bytes);
+            return 0;
+        }
+    }
+
+    return bad_frames;
+}
+
+/**
+ * @brief Decodes the COBS frames: data bytes of each block and the bytes of a bad frame up to its
+ * delimiter are handled a run at a time, the rest (code bytes and delimiters) a byte at a time.
+ */
+static unsigned int cobs_decode_word(struct framing_decoder * decoder, const u8 * data, size_t num_bytes,
+    framing_message_fn on_message, void * context
+) {
+    unsigned int bad_frames = 0;
+    size_t i = 0;
+
+    while(i < num_bytes) {
+        if(decoder->m_is_bad) {
+            i += framing_find(data + i, num_bytes - i, 0, 0);
+        } else if(decoder->m_cobs_remaining) {
+            // Block has no zero, the zero within it is the delimiter of the truncated frame.
+            const size_t run = framing_find(data + i,
+                min_t(size_t, num_bytes - i, decoder->m_cobs_remaining), 0, 0
+            );
+
+            framing_decoder_append_run(decoder, data + i, run);
+            decoder->m_cobs_remaining -= run;
+            i += run;
+
+            if(!decoder->m_cobs_remaining) {
+                continue;
+            }
+        }
+
+        if(i < num_bytes) {
+            bad_frames += cobs_decode_byte(decoder, data[i++], on_message, context);
+        }
+    }
+
+    return bad_frames;
+}
+
+/**
+ * @brief Decodes the SLIP frames: the runs of the ordinary bytes and the bytes of a bad frame up
+ * to its delimiter are handled a run at a time, the rest (escapes and delimiters) a byte at a time.
+ */
+static unsigned int slip_decode_word(struct framing_decoder * decoder, const u8 * data, size_t num_bytes,
+    framing_message_fn on_message, void * context
+) {
+    unsigned int bad_frames = 0;
+    size_t i = 0;
+
+    while(i < num_bytes) {
+        if(decoder->m_is_bad) {
+            i += framing_find(data + i, num_bytes - i, SLIP_END, SLIP_END);
+        } else if(!decoder->m_slip_is_escaped) {
+            const size_t run = framing_find(data + i, num_bytes - i, SLIP_END, SLIP_ESC);
+
+            framing_decoder_append_run(decoder, data + i, run);
+            i += run;
+        }
+
+        if(i < num_bytes) {
+            bad_frames += slip_decode_byte(decoder, data[i++], on_message, context);
+        }
+    }
+
+    return bad_frames;
+}
+
+unsigned int framing_decode(struct framing_decoder * decoder, const u8 * data, size_t num_bytes,
+    framing_message_fn on_message, void * context
+) {
+    switch(decoder->m_type) {
+    case FRAMING_COBS:
+        return cobs_decode_word(decoder, data, num_bytes, on_message, context);
+
+    case FRAMING_SLIP:
+        return slip_decode_word(decoder, data, num_bytes, on_message, context);
+
+    default:
+        on_message(context, data, num_bytes);
+        return 0;
+    }
+}
+
+// ---------------
+// Microbenchmark.
+// ---------------
+
+/**
+ * Size of the messages and the number of bytes, that each variant of the codec
+ * processes in the microbenchmark.
+ */
+#define FRAMING_BENCH_MESSAGE_SIZE 1024
+#define FRAMING_BENCH_BYTES (8 * 1024 * 1024)
+
+/**
+ * Content of the messages of the microbenchmark: random bytes, i.e. binary data with
+ * the special bytes here and there, and printable text without any special byte.
+ */
+enum framing_bench_pattern {
+    FRAMING_BENCH_BINARY,
+    FRAMING_BENCH_TEXT,
+    FRAMING_BENCH_PATTERN_COUNT
+};
+
+static const char * const g_framing_bench_pattern_names[FRAMING_BENCH_PATTERN_COUNT] = {
+    [FRAMING_BENCH_BINARY] = "binary",
+    [FRAMING_BENCH_TEXT] = "text"
+};
+
+/**
+ * Buffers of the microbenchmark.
+ */
+struct framing_bench {
+    u8 * m_message;
+    u8 * m_scalar_frame;
+    u8 * m_word_frame;
+    struct framing_decoder m_decoder;
+    size_t m_decoded_bytes;
+};
+
+static void framing_bench_on_message(void * context, const u8 * message, unsigned int num_bytes) {
+    struct framing_bench * bench = context;
+    bench->m_decoded_bytes += num_bytes;
+}
+
+/**
+ * @brief Prints the cost of the scalar and the word-at-a-time variants (in nanoseconds per KiB of
+ * the message) along with the speedup of the latter.
+ */
+static void framing_bench_print(struct seq_file * file, const char * name, u64 scalar_ns, u64 word_ns) {
+    const u64 kibs = FRAMING_BENCH_BYTES / 1024;
+    const u64 speedup_per_kilo = div64_u64(scalar_ns * 1000, word_ns ? word_ns : 1);
+
+    seq_printf(file, "%s_scalar_ns_per_kib %llu\n", name, div64_u64(scalar_ns, kibs));
+    seq_printf(file, "%s_word_ns_per_kib %llu\n", name, div64_u64(word_ns, kibs));
+    seq_printf(file, "%s_speedup %llu.%03llu\n", name, speedup_per_kilo / 1000, speedup_per_kilo % 1000);
+}
+
+/**
+ * @brief Measures encoding and decoding of the messages of the given framing and content
+ * by both variants of the codec, which have to produce the same output.
+ */
+static void framing_bench_run(struct seq_file * file, struct framing_bench * bench, enum framing_type type,
+    enum framing_bench_pattern pattern
+) {
+    const unsigned int iterations = FRAMING_BENCH_BYTES / FRAMING_BENCH_MESSAGE_SIZE;
+    size_t (*encode_scalar)(const u8 *, size_t, u8 *) =
+        type == FRAMING_COBS ? cobs_encode_scalar : slip_encode_scalar;
+    size_t (*encode_word)(const u8 *, size_t, u8 *) =
+        type == FRAMING_COBS ? cobs_encode_word : slip_encode_word;
+    size_t scalar_frame_size = 0;
+    size_t word_frame_size = 0;
+    char name[32];
+
+    get_random_bytes(bench->m_message, FRAMING_BENCH_MESSAGE_SIZE);
+
+    if(pattern == FRAMING_BENCH_TEXT) {
+        for(unsigned int i = 0; i < FRAMING_BENCH_MESSAGE_SIZE; ++i) {
+            bench->m_message[i] = ' ' + bench->m_message[i] % ('~' - ' ' + 1);
+        }
+    }
+
+    snprintf(name, sizeof(name), "%s_%s", g_framing_type_names[type], g_framing_bench_pattern_names[pattern]);
+
+    u64 start_ns = ktime_get_ns();
+
+    for(unsigned int i = 0; i < iterations; ++i) {
+        scalar_frame_size = encode_scalar(bench->m_message, FRAMING_BENCH_MESSAGE_SIZE, bench->m_scalar_frame);
+    }
+
+    const u64 encode_scalar_ns = ktime_get_ns() - start_ns;
+    cond_resched();
+    start_ns = ktime_get_ns();
+
+    for(unsigned int i = 0; i < iterations; ++i) {
+        word_frame_size = encode_word(bench->m_message, FRAMING_BENCH_MESSAGE_SIZE, bench->m_word_frame);
+    }
+
+    const u64 encode_word_ns = ktime_get_ns() - start_ns;
+    cond_resched();
+
+    const bool is_encode_equal = scalar_frame_size == word_frame_size &&
+        memcmp(bench->m_scalar_frame, bench->m_word_frame, scalar_frame_size) == 0;
+
+    framing_decoder_reset(&(bench->m_decoder), type);
+    bench->m_decoded_bytes = 0;
+    start_ns = ktime_get_ns();
+
+    for(unsigned int i = 0; i < iterations; ++i) {
+        framing_decode_scalar(&(bench->m_decoder), bench->m_scalar_frame, scalar_frame_size,
+            framing_bench_on_message, bench
+        );
+    }
+
+    const u64 decode_scalar_ns = ktime_get_ns() - start_ns;
+    const size_t scalar_decoded_bytes = bench->m_decoded_bytes;
+    cond_resched();
+
+    framing_decoder_reset(&(bench->m_decoder), type);
+    bench->m_decoded_bytes = 0;
+    start_ns = ktime_get_ns();
+
+    for(unsigned int i = 0; i < iterations; ++i) {
+        framing_decode(&(bench->m_decoder), bench->m_scalar_frame, scalar_frame_size,
+            framing_bench_on_message, bench
+        );
+    }
+
+    const u64 decode_word_ns = ktime_get_ns() - start_ns;
+    cond_resched();
+
+    const bool is_decode_equal = scalar_decoded_bytes == FRAMING_BENCH_BYTES &&
+        bench->m_decoded_bytes == FRAMING_BENCH_BYTES &&
+        memcmp(bench->m_decoder.m_message, bench->m_message, FRAMING_BENCH_MESSAGE_SIZE) == 0;
+
+    strlcat(name, "_encode", sizeof(name));
+    framing_bench_print(file, name, encode_scalar_ns, encode_word_ns);
+    seq_printf(file, "%s_ok %d\n", name, is_encode_equal);
+
+    snprintf(name, sizeof(name), "%s_%s_decode", g_framing_type_names[type], g_framing_bench_pattern_names[pattern]);
+    framing_bench_print(file, name, decode_scalar_ns, decode_word_ns);
+    seq_printf(file, "%s_ok %d\n", name, is_decode_equal);
+}
+
+/**
+ * @brief Runs the microbenchmark and prints the results as `<name> <value>` lines,
+ * the same way as the hot path statistics.
+ */
+static int framing_bench_show(struct seq_file * file, void * unused) {
+    struct framing_bench bench = {
+        .m_message = kmalloc(FRAMING_BENCH_MESSAGE_SIZE, GFP_KERNEL),
+        .m_scalar_frame = kmalloc(framing_encoded_size_max(FRAMING_SLIP, FRAMING_BENCH_MESSAGE_SIZE), GFP_KERNEL),
+        .m_word_frame = kmalloc(framing_encoded_size_max(FRAMING_SLIP, FRAMING_BENCH_MESSAGE_SIZE), GFP_KERNEL)
+    };
+    int status = -ENOMEM;
+
+    if(bench.m_message && bench.m_scalar_frame && bench.m_word_frame &&
+        !framing_decoder_allocate(&(bench.m_decoder), FRAMING_BENCH_MESSAGE_SIZE)
+    ) {
+        for(int type = FRAMING_COBS; type < FRAMING_TYPE_COUNT; ++type) {
+            for(int pattern = 0; pattern < FRAMING_BENCH_PATTERN_COUNT; ++pattern) {
+                framing_bench_run(file, &bench, type, pattern);
+            }
+        }
+
+        framing_decoder_free(&(bench.m_decoder));
+        status = 0;
+    }
+
+    kfree(bench.m_message);
+    kfree(bench.m_scalar_frame);
+    kfree(bench.m_word_frame);
+    return status;
+}
+
+DEFINE_SHOW_ATTRIBUTE(framing_bench);
+
+void framing_debugfs_create(struct dentry * directory) {
+    debugfs_create_file("framing_bench", 0400, directory, NULL, &framing_bench_fops);
+}
@@ -0,0 +1,200 @@
+/**
+ * @brief File contains the codecs of the framed mode, i.e. COBS and SLIP, which turn the byte
+ * stream of the device into messages. Encoder frames a whole message at once, decoder is fed with
+ * the received bytes as they arrive, thus a message could span many bulk IN transfers.
+ */
+
+#ifndef FRAMING_H
+#define FRAMING_H
+
+#include <linux/types.h>
+
+struct dentry;
+
+/**
+ * Framing of the messages.
+ */
+enum framing_type {
+    /** Raw byte stream, i.e. no framing at all. */
+    FRAMING_NONE,
+
+    /** Consistent Overhead Byte Stuffing, each frame is terminated by 0x00. */
+    FRAMING_COBS,
+
+    /** Serial Line IP (RFC 1055), each frame is surrounded by 0xC0. */
+    FRAMING_SLIP,
+
+    FRAMING_TYPE_COUNT
+};
+
+/**
+ * Special bytes of SLIP.
+ */
+#define SLIP_END 0xC0
+#define SLIP_ESC 0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+
+/**
+ * Names of the framing types, which are used by sysfs.
+ */
+extern const char * const g_framing_type_names[FRAMING_TYPE_COUNT];
+
+/**
+ * CRC, which is appended to each message (little endian), before it's framed.
+ */
+enum framing_crc {
+    FRAMING_CRC_NONE,
+
+    /** CRC16 of T10 DIF (polynomial 0x8BB7). */
+    FRAMING_CRC_CRC16,
+
+    /** CRC32C (Castagnoli), the same as of iSCSI and ext4. */
+    FRAMING_CRC_CRC32C,
+
+    FRAMING_CRC_COUNT
+};
+
+/**
+ * Size of the largest CRC.
+ */
+#define FRAMING_CRC_SIZE_MAX 4
+
+/**
+ * Names of the CRCs, which are used by sysfs.
+ */
+extern const char * const g_framing_crc_names[FRAMING_CRC_COUNT];
+
+/**
+ * @brief Returns the size of the CRC.
+ */
+static inline unsigned int framing_crc_size(enum framing_crc crc) {
+    switch(crc) {
+    case FRAMING_CRC_CRC16:
+        return 2;
+
+    case FRAMING_CRC_CRC32C:
+        return 4;
+
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief Appends the CRC of the message to it, the message has to fit `framing_crc_size()` more bytes.
+ *
+ * @return Size of the message along with its CRC.
+ */
+size_t framing_crc_append(enum framing_crc crc, u8 * message, size_t num_bytes);
+
+/**
+ * @brief Verifies the CRC at the end of the message.
+ *
+ * @return Size of the message without its CRC, negative value if the CRC is wrong
+ * or the message is too short to have it.
+ */
+long framing_crc_verify(enum framing_crc crc, const u8 * message, size_t num_bytes);
+
+/**
+ * @brief Returns the maximum size of the frame of the message of `num_bytes` bytes,
+ * delimiters included.
+ */
+static inline size_t framing_encoded_size_max(enum framing_type type, size_t num_bytes) {
+    switch(type) {
+    case FRAMING_COBS:
+        // Code byte per 254 bytes of data and the delimiter.
+        return num_bytes + num_bytes / 254 + 2;
+
+    case FRAMING_SLIP:
+        // Every byte could be escaped, frame starts and ends with the delimiter.
+        return 2 * num_bytes + 2;
+
+    default:
+        return num_bytes;
+    }
+}
+
+/**
+ * @brief Frames the message into `frame`, which has to fit `framing_encoded_size_max()` bytes.
+ *
+ * @return Size of the frame.
+ */
+size_t framing_encode(enum framing_type type, const u8 * message, size_t num_bytes, u8 * frame);
+
+/**
+ * Function, which is called by the decoder for each complete message.
+ */
+typedef void (*framing_message_fn)(void * context, const u8 * message, unsigned int num_bytes);
+
+/**
+ * State of the decoder of the received frames.
+ */
+struct framing_decoder {
+    enum framing_type m_type;
+
+    /** Message, which is being decoded, and its capacity. */
+    u8 * m_message;
+    unsigned int m_length;
+    unsigned int m_capacity;
+
+    /**
+     * COBS: number of the data bytes, which are left in the current block, and whether the block
+     * is followed by an implied zero, i.e. whether its code byte has been less than 0xFF.
+     */
+    u8 m_cobs_remaining;
+    bool m_cobs_has_zero;
+
+    /** SLIP: whether the previous byte has been the escape byte. */
+    bool m_slip_is_escaped;
+
+    /** Frame is malformed or too long, thus it's dropped at its delimiter. */
+    bool m_is_bad;
+};
+
+/**
+ * @brief Allocates the buffer of the messages of up to `capacity` bytes.
+ *
+ * @return 0 on success, `-ENOMEM` on failure.
+ */
+int framing_decoder_allocate(struct framing_decoder * decoder, unsigned int capacity);
+
+/**
+ * @brief Frees the buffer of the messages.
+ */
+void framing_decoder_free(struct framing_decoder * decoder);
+
+/**
+ * @brief Drops the partially decoded frame and switches the decoder to the given framing.
+ */
+void framing_decoder_reset(struct framing_decoder * decoder, enum framing_type type);
+
+/**
+ * @brief Decodes the received bytes, `on_message` is called for each complete message.
+ *
+ * @return Number of the frames, which have been dropped, as they were malformed or too long.
+ */
+unsigned int framing_decode(struct framing_decoder * decoder, const u8 * data, size_t num_bytes,
+    framing_message_fn on_message, void * context
+);
+
+#if IS_ENABLED(CONFIG_KUNIT)
+/**
+ * Scalar codecs, i.e. the references, which the KUnit suite checks the word-at-a-time
+ * variants of `framing_encode()` and `framing_decode()` against.
+ */
+size_t cobs_encode_scalar(const u8 * message, size_t num_bytes, u8 * frame);
+size_t slip_encode_scalar(const u8 * message, size_t num_bytes, u8 * frame);
+
+unsigned int framing_decode_scalar(struct framing_decoder * decoder, const u8 * data,
+    size_t num_bytes, framing_message_fn on_message, void * context
+);
+#endif
+
+/**
+ * @brief Creates the `framing_bench` file in the debugfs directory. Reading the file runs the
+ * microbenchmark of the scalar and the word-at-a-time variants of the codecs and prints their cost.
+ */
+void framing_debugfs_create(struct dentry * directory);
+
+#endif // FRAMING_H
@@ -0,0 +1,105 @@
+#include "ftdi_protocol.h"
+#include "custom_macros.h"
+
+#include <linux/errno.h>
+#include <linux/math.h>
+
+/**
+ * Timeout of a single SIO request (in milliseconds).
+ */
+#define FTDI_SIO_TIMEOUT_MS 1000
+
+/**
+ * Clock of the baud rate generator of FT232R. Baud rate is `48 MHz / 16 / divisor`.
+ */
+#define FTDI_FT232R_CLOCK 48000000
+
+/**
+ * Clock of the baud rate generator of H-series chips. With the divide-by-2.5 prescaler
+ * turned off (bit 17 of the divisor) baud rate is `120 MHz / 10 / divisor`.
+ */
+#define FTDI_H_CLOCK 120000000
+
+/** Bit of the divisor, which turns off the divide-by-2.5 prescaler of H-series chips. */
+#define FTDI_H_CLOCK_DIVISOR_BIT 0x00020000
+
+/** Lowest baud rate, which could be reached with the prescaler of H-series chips turned off. */
+#define FTDI_H_CLOCK_MIN_BAUD_RATE 1200
+
+int ftdi_max_baud_rate(enum ftdi_chip_type chip_type) {
+    return chip_type == FTDI_CHIP_FT232R ? 3000000 : 12000000;
+}
+
+bool ftdi_is_multi_channel(enum ftdi_chip_type chip_type) {
+    return chip_type == FTDI_CHIP_FT2232H || chip_type == FTDI_CHIP_FT4232H;
+}
+
+int ftdi_sio_request(struct usb_device * usb_device, u8 request, u16 value, u16 channel) {
+    const int status = usb_control_msg(usb_device, usb_sndctrlpipe(usb_device, 0), request,
+        USB_DIR_OUT | USB_TYPE_VENDOR | USB_RECIP_DEVICE, value, channel,
+        NULL, 0, FTDI_SIO_TIMEOUT_MS
+    );
+
+    if(status < 0) {
+        PRINT_DEBUG("ftdi_sio_request(): request 0x%02x of channel %u failed: %d.\n",
+            request, channel, status
+        );
+    }
+
+    return status < 0 ? status : 0;
+}
+
+/**
+ * @brief Encodes `clock / (divisor_base * baud_rate)` as the FTDI divisor, i.e. as
+ * the 14-bit integer part with the 3-bit fraction in eighths, where the fraction
+ * is encoded by the lookup table (bits are not in the natural order).
+ */
+static u32 ftdi_encode_divisor(int clock, int divisor_base, int baud_rate) {
+    static const u8 fraction_codes[8] = { 0, 3, 2, 4, 1, 5, 6, 7 };
+
+    // Divisor in eighths, rounded to the closest one. Both operands fit into 32 bits
+    // for the supported clocks and baud rates.
+    const u32 divisor_eighths = DIV_ROUND_CLOSEST(8U * clock, (u32) divisor_base * baud_rate);
+    u32 divisor = (divisor_eighths >> 3) | ((u32) fraction_codes[divisor_eighths & 0x7] << 14);
+
+    // Divisors of 1 and 1.5 are encoded as special values.
+    if(divisor == 1) {
+        divisor = 0;
+    } else if(divisor == 0x4001) {
+        divisor = 1;
+    }
+
+    return divisor;
+}
+
+int ftdi_set_baud_rate(struct usb_device * usb_device, enum ftdi_chip_type chip_type,
+    u16 channel, int baud_rate
+) {
+    if(baud_rate <= 0 || baud_rate > ftdi_max_baud_rate(chip_type)) {
+        return -EINVAL;
+    }
+
+    u32 divisor = 0;
+
+    if(chip_type == FTDI_CHIP_FT232R || baud_rate < FTDI_H_CLOCK_MIN_BAUD_RATE) {
+        divisor = ftdi_encode_divisor(FTDI_FT232R_CLOCK, 16, baud_rate);
+    } else {
+        divisor = ftdi_encode_divisor(FTDI_H_CLOCK, 10, baud_rate) | FTDI_H_CLOCK_DIVISOR_BIT;
+    }
+
+    // Lower 16 bits of the divisor go to `wValue`, the rest goes to `wIndex`. Multi-channel
+    // chips take the channel in the low byte of `wIndex`, thus the rest is moved to the high byte.
+    const u16 value = divisor & 0xffff;
+    u16 index = divisor >> 16;
+
+    if(ftdi_is_multi_channel(chip_type)) {
+        index = (index << 8) | channel;
+    }
+
+    const int status = usb_control_msg(usb_device, usb_sndctrlpipe(usb_device, 0),
+        FTDI_SIO_SET_BAUD_RATE, USB_DIR_OUT | USB_TYPE_VENDOR | USB_RECIP_DEVICE,
+        value, index, NULL, 0, FTDI_SIO_TIMEOUT_MS
+    );
+
+    return status < 0 ? status : 0;
+}
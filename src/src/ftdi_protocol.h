@@ -0,0 +1,95 @@
+/**
+ * @brief File contains FTDI vendor requests (SIO requests), which configure the UART
+ * of each channel of the chip, i.e. its baud rate, data format, flow control and the
+ * latency timer, along with the chip types that the driver supports.
+ */
+
+#ifndef FTDI_PROTOCOL_H
+#define FTDI_PROTOCOL_H
+
+#include <linux/usb.h>
+#include <linux/types.h>
+
+/**
+ * Chip types, which differ in the baud rate generator and in the number of channels.
+ * Value is stored in `driver_info` of the device id table.
+ */
+enum ftdi_chip_type {
+    /** Single channel full-speed chip, 3 MHz baud rate base clock, up to 3 Mbaud. */
+    FTDI_CHIP_FT232R,
+
+    /** Dual channel high-speed chip, 12 MHz baud rate base clock, up to 12 Mbaud. */
+    FTDI_CHIP_FT2232H,
+
+    /** Quad channel high-speed chip, 12 MHz baud rate base clock, up to 12 Mbaud. */
+    FTDI_CHIP_FT4232H
+};
+
+/**
+ * SIO requests, i.e. `bRequest` values of the vendor control requests.
+ */
+#define FTDI_SIO_RESET 0x00
+#define FTDI_SIO_SET_MODEM_CTRL 0x01
+#define FTDI_SIO_SET_FLOW_CTRL 0x02
+#define FTDI_SIO_SET_BAUD_RATE 0x03
+#define FTDI_SIO_SET_DATA 0x04
+#define FTDI_SIO_GET_MODEM_STATUS 0x05
+#define FTDI_SIO_SET_LATENCY_TIMER 0x09
+#define FTDI_SIO_GET_LATENCY_TIMER 0x0a
+
+/** Values of `wValue` of `FTDI_SIO_RESET` request. */
+#define FTDI_SIO_RESET_SIO 0
+#define FTDI_SIO_RESET_PURGE_RX 1
+#define FTDI_SIO_RESET_PURGE_TX 2
+
+/** Value of `wValue` of `FTDI_SIO_SET_DATA` request: 8 data bits, no parity, 1 stop bit. */
+#define FTDI_SIO_SET_DATA_8N1 0x0008
+
+/** Value of `wValue` of `FTDI_SIO_SET_FLOW_CTRL` request: no flow control. */
+#define FTDI_SIO_DISABLE_FLOW_CTRL 0x0000
+
+/**
+ * Size of the modem/line status header, which FTDI chips put at the beginning
+ * of every bulk IN packet.
+ */
+#define FTDI_STATUS_HEADER_SIZE 2
+
+/**
+ * Bits of the line status byte, i.e. of the second byte of the status header
+ * of every bulk IN packet.
+ */
+#define FTDI_LINE_STATUS_OE 0x02
+#define FTDI_LINE_STATUS_FE 0x08
+#define FTDI_LINE_STATUS_THRE 0x20
+#define FTDI_LINE_STATUS_TEMT 0x40
+
+/**
+ * @brief Returns the highest baud rate, which the chip of the given type supports.
+ */
+int ftdi_max_baud_rate(enum ftdi_chip_type chip_type);
+
+/**
+ * @brief Returns true if the chip of the given type is a multi-channel chip, i.e. the
+ * channel has to be passed in the high byte of the `wIndex` of the baud rate request too.
+ */
+bool ftdi_is_multi_channel(enum ftdi_chip_type chip_type);
+
+/**
+ * @brief Sends the SIO request with the given `wValue` to the channel. Channels are numbered
+ * from 1 (interface A) on the multi-channel chips, single channel chips accept 0 or 1.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int ftdi_sio_request(struct usb_device * usb_device, u8 request, u16 value, u16 channel);
+
+/**
+ * @brief Sets the baud rate of the channel.
+ *
+ * @return 0 on success, `-EINVAL` if the chip doesn't support the baud rate,
+ * other negative error code if the request has failed.
+ */
+int ftdi_set_baud_rate(struct usb_device * usb_device, enum ftdi_chip_type chip_type,
+    u16 channel, int baud_rate
+);
+
+#endif // FTDI_PROTOCOL_H
@@ -1,124 +1,923 @@
 #include "ftdi_usb_driver.h"
 #include "custom_macros.h"
 #include "device_file_operations.h"
+#include "ftdi_protocol.h"
+#include "poller.h"
+#include "device_attributes.h"
+#include "device_ioctl.h"
+#include "framing.h"
+#include "usb_core.h"
 
 #include <linux/sprintf.h>
+#include <linux/fs.h>
+#include <linux/xarray.h>
+#include <linux/pm_runtime.h>
+#include <linux/dma-mapping.h>
+#include <linux/usb/hcd.h>
+#include <linux/uio.h>
+#include <kunit/visibility.h>
 
 #define FTDI_VENDOR_ID 0x0403
-#define FTDI_PRODUCT_ID 0x6001
-#define BULK_EP_OUT 0x02
+#define FTDI_FT232R_PRODUCT_ID 0x6001
+#define FTDI_FT2232H_PRODUCT_ID 0x6010
+#define FTDI_FT4232H_PRODUCT_ID 0x6011
 
-#define TIMER_START_JIFFIES 1000
-#define TIMER_RESCHEDULE_JIFFIES 20
+/**
+ * Number of bulk IN URBs that are kept in flight, so that the host controller always
+ * has a buffer to put the incoming packets to, while the previous URB is being completed.
+ */
+#define RX_URB_COUNT 4
+
+/**
+ * Limits of the bulk IN URB size (in bytes).
+ */
+#define RX_URB_SIZE_MIN 512
+#define RX_URB_SIZE_MAX (16 * 1024)
+
+/**
+ * Size of the ring buffer with the received data (in bytes).
+ */
+#define RX_RING_SIZE (64 * 1024)
+
+/**
+ * Default RX coalescing parameters, which favor latency, i.e. readers are woken up at once.
+ */
+#define RX_COALESCE_USECS_DEFAULT 0
+#define RX_COALESCE_BYTES_DEFAULT 1
+
+/**
+ * Limits of the bulk OUT URB size (in bytes).
+ */
+#define TX_URB_SIZE_MIN 64
+#define TX_URB_SIZE_MAX (64 * 1024)
+
+/**
+ * Default TX coalescing time, which favors latency, i.e. written data is sent at once.
+ * Coalescing bytes default to the max packet size of the bulk OUT endpoint.
+ */
+#define TX_COALESCE_USECS_DEFAULT 0
+
+/**
+ * Size of the ring buffer with the data to send (in bytes).
+ */
+#define TX_RING_SIZE (64 * 1024)
+
+/**
+ * Delay before the next attempt to send the data, if the URB couldn't be submitted (in nanoseconds).
+ */
+#define TX_RETRY_DELAY_NS (20 * NSEC_PER_MSEC)
+
+/**
+ * Maximum time to wait for a single bulk OUT URB, while the TX ring is flushed (in milliseconds).
+ */
+#define TX_FLUSH_TIMEOUT_MS 1000
 
 // -------------------------------------------------------------------------
 // Definition of functions for allocating and freeing device data structure.
 // -------------------------------------------------------------------------
 
 /**
- * Device data for storing data from reading from USB bulk IN endpoint and 
- * writing to USB bulk OUT endpoint.
+ * Size of the bulk IN URBs, requested via module parameter. Actual size is derived from it
+ * per device, once the max packet size of its bulk IN endpoint is known.
+ */
+static int g_usb_bulk_in_urb_size = 0;
+
+/**
+ * Maximum size of the bulk OUT URBs, requested via module parameter. Actual size is derived
+ * from it per device, once the max packet size of its bulk OUT endpoint is known.
+ */
+static int g_usb_bulk_out_urb_size = 0;
+
+/**
+ * Baud rate and latency timer (in milliseconds), which every channel is configured with in `probe()`.
+ */
+static int g_baud_rate = 0;
+static int g_latency_timer_ms = 0;
+
+/**
+ * Idle period (in milliseconds), after which the device is suspended, negative value
+ * leaves the autosuspend delay of the device as it is.
  */
-static struct device_data * g_device_data = NULL;
+static int g_autosuspend_delay_ms = -1;
 
 /**
- * @brief Frees device data structure, thus it should be during device deregistration,
- * when we are sure that neither `read()` nor `write()` file operations can be called 
- * on this device.
+ * @brief Frees device data structure. It is called once the last reference to the device
+ * data is dropped, i.e. when the device has been disconnected and all the files that
+ * have it opened have been closed, thus neither `read()` nor `write()` file operations
+ * can be called on this device.
  */
-static void device_data_free(void) {
-    if(g_device_data) {
-		// Uninitialize this device only if the device data was successfully allocated.
-		if(g_device_data->m_device_buffer) {
-            // Unitialize this device if the device buffer was 
-            // successfully allocated.
-            kfree(g_device_data->m_device_buffer);
+static void device_data_free(struct device_data * device_data) {
+    if(device_data) {
+		// Free only what has been successfully allocated, URB has no buffer of its own,
+        // as the data is sent directly from the TX ring.
+        usb_free_urb(device_data->m_tx_urb);
+        ring_buffer_free(&(device_data->m_tx_ring));
+
+        if(device_data->m_rx_urbs) {
+            for(int i = 0; i < device_data->m_rx_urb_count; ++i) {
+                if(device_data->m_rx_urbs[i]) {
+                    kfree(device_data->m_rx_urbs[i]->transfer_buffer);
+                    usb_free_urb(device_data->m_rx_urbs[i]);
+                }
+            }
+
+            kfree(device_data->m_rx_urbs);
         }
 
-		kfree(g_device_data);
+        ring_buffer_free(&(device_data->m_rx_ring));
+        kfree(device_data->m_rx_timestamps);
+        framing_decoder_free(&(device_data->m_rx_decoder));
+        kfree(device_data->m_tx_message);
+        kfree(device_data->m_tx_frame);
+        device_stats_free(&(device_data->m_stats));
+        usb_put_intf(device_data->m_interface);
+        usb_put_dev(device_data->m_usb_device);
+		kfree(device_data);
 	}
 }
 
+/**
+ * @brief Called by `kref_put()`, once the last reference to the device data is dropped.
+ */
+static void device_data_release(struct kref * kref) {
+    device_data_free(container_of(kref, struct device_data, m_kref));
+}
+
+void device_data_put(struct device_data * device_data) {
+    kref_put(&(device_data->m_kref), device_data_release);
+}
+
+/**
+ * @brief Allocates bulk IN URBs along with their transfer buffers. URBs are reused
+ * for the whole lifetime of the device, thus nothing is allocated on the receive path.
+ */
+static int rx_urbs_allocate(struct device_data * device_data) {
+    device_data->m_rx_urb_count = RX_URB_COUNT;
+    device_data->m_rx_urbs = kcalloc(RX_URB_COUNT, sizeof(struct urb *), GFP_KERNEL);
+
+    if(!device_data->m_rx_urbs) {
+        return -ENOMEM;
+    }
+
+    for(int i = 0; i < RX_URB_COUNT; ++i) {
+        struct urb * urb = usb_alloc_urb(0, GFP_KERNEL);
+
+        if(!urb) {
+            return -ENOMEM;
+        }
+
+        device_data->m_rx_urbs[i] = urb;
+        urb->transfer_buffer = kmalloc(device_data->m_rx_urb_size, GFP_KERNEL);
+
+        if(!urb->transfer_buffer) {
+            return -ENOMEM;
+        }
+    }
+
+    return 0;
+}
+
+static void tx_service(struct poller_client * client);
+static void tx_urb_complete(struct urb * urb);
+static void rx_coalesce_service(struct poller_client * client);
+static void rx_halt_work(struct work_struct * work);
+
 /**
  * @brief Allocates device data structure, which will be used in 
  * `read()` and `write()` file operations.
- * Should be called during device registration, before `read()` and `write()`
- * file operations could be called on this device.
+ * Should be called during device probing, before `read()` and `write()`
+ * file operations could be called on this device. All the buffers are sized
+ * according to the bulk endpoints, that were discovered on the interface.
+ *
+ * @return Device data on success, `NULL` on failure.
  */
-static int device_data_allocate(int usb_bulk_endpoint_max_packet_size) {
+VISIBLE_IF_KUNIT struct device_data * device_data_allocate(struct usb_interface * interface,
+    const struct usb_endpoint_descriptor * bulk_in, const struct usb_endpoint_descriptor * bulk_out
+) {
     // Allocate device data and memset it to 0.
-	g_device_data = kmalloc(sizeof(struct device_data), GFP_KERNEL);
+	struct device_data * device_data = kzalloc(sizeof(struct device_data), GFP_KERNEL);
 
-	if (!g_device_data) {
-		device_data_free();
-		return -ENOMEM;
+	if (!device_data) {
+		return NULL;
 	}
 
-	memset(g_device_data, 0, sizeof(struct device_data));
+    kref_init(&(device_data->m_kref));
+    device_data->m_usb_device = usb_get_dev(interface_to_usbdev(interface));
+    device_data->m_interface = usb_get_intf(interface);
+    device_data->m_bulk_in_endpoint_address = bulk_in->bEndpointAddress;
+    device_data->m_bulk_out_endpoint_address = bulk_out->bEndpointAddress;
+    device_data->m_bulk_in_max_packet_size = usb_endpoint_maxp(bulk_in);
+    device_data->m_bulk_out_max_packet_size = usb_endpoint_maxp(bulk_out);
+
+	// Data, written to the device, is buffered in the TX ring and sent by a single reused URB.
+    device_data->m_tx_urb = usb_alloc_urb(0, GFP_KERNEL);
+
+    if(!device_data->m_tx_urb || ring_buffer_allocate(&(device_data->m_tx_ring), TX_RING_SIZE)) {
+        device_data_free(device_data);
+        return NULL;
+    }
+
+    sg_init_table(device_data->m_tx_sg, ARRAY_SIZE(device_data->m_tx_sg));
+    device_data->m_tx_ring_dma = DMA_MAPPING_ERROR;
+
+    // Bulk OUT URB size is a multiple of the max packet size, so that only the last URB
+    // of the written data ends with a short packet.
+    const int out_max_packet_size = device_data->m_bulk_out_max_packet_size;
+    device_data->m_tx_urb_size = max(out_max_packet_size, rounddown(
+        clamp(g_usb_bulk_out_urb_size, TX_URB_SIZE_MIN, TX_URB_SIZE_MAX), out_max_packet_size
+    ));
+
+    // Allocate counters of the hot path.
+    if(device_stats_allocate(&(device_data->m_stats))) {
+        device_data_free(device_data);
+        return NULL;
+    }
 
-	// Initialize this device buffer and memset it to 0. We set its value to the 
-    // maximum packate size of USB bulk endpoint + 1 (for the ending NUL character).
-    g_device_data->m_device_buffer_size = usb_bulk_endpoint_max_packet_size + 1;
-	g_device_data->m_device_buffer_data_len = 0;
-    g_device_data->m_device_buffer = kmalloc(
-        usb_bulk_endpoint_max_packet_size * sizeof(char), GFP_KERNEL
+    // Bulk IN URB size is a multiple of the max packet size, as every packet in the URB
+    // has its own status header, that should be stripped.
+    const int max_packet_size = device_data->m_bulk_in_max_packet_size;
+    device_data->m_rx_urb_size = rounddown(
+        clamp(g_usb_bulk_in_urb_size, RX_URB_SIZE_MIN, RX_URB_SIZE_MAX), max_packet_size
     );
 
-    if(!g_device_data->m_device_buffer) {
-        device_data_free();
-        return -ENOMEM;
+    if(device_data->m_rx_urb_size < max_packet_size) {
+        device_data->m_rx_urb_size = max_packet_size;
+    }
+
+    if(rx_urbs_allocate(device_data) || ring_buffer_allocate(&(device_data->m_rx_ring), RX_RING_SIZE)) {
+        device_data_free(device_data);
+        return NULL;
     }
 
-    memset(g_device_data->m_device_buffer, 0, usb_bulk_endpoint_max_packet_size * sizeof(char));
+    device_data->m_rx_timestamps = kcalloc(RX_TIMESTAMP_RING_SIZE, sizeof(struct rx_timestamp), GFP_KERNEL);
 
-    // Initialize mutex.
-    mutex_init(&(g_device_data->m_mutex));
+    // Buffers of the framed mode are allocated once, so that neither the URB completion handler
+    // nor `write()` allocates anything per message. Messages are followed by their CRC.
+    const unsigned int message_size_max = DEVICE_FRAMING_MESSAGE_SIZE_MAX + FRAMING_CRC_SIZE_MAX;
 
-    return 0;
+    device_data->m_tx_message = kmalloc(message_size_max, GFP_KERNEL);
+    device_data->m_tx_frame = kmalloc(framing_encoded_size_max(FRAMING_SLIP, message_size_max), GFP_KERNEL);
+
+    if(!device_data->m_rx_timestamps || !device_data->m_tx_message || !device_data->m_tx_frame ||
+        framing_decoder_allocate(&(device_data->m_rx_decoder), message_size_max)
+    ) {
+        device_data_free(device_data);
+        return NULL;
+    }
+
+    init_usb_anchor(&(device_data->m_rx_anchor));
+    init_usb_anchor(&(device_data->m_rx_halted_anchor));
+    init_usb_anchor(&(device_data->m_tx_anchor));
+    INIT_WORK(&(device_data->m_rx_halt_work), rx_halt_work);
+    init_waitqueue_head(&(device_data->m_rx_wait));
+    init_waitqueue_head(&(device_data->m_tx_wait));
+    atomic_set(&(device_data->m_rx_mappings), 0);
+    atomic_set(&(device_data->m_tx_mappings), 0);
+    atomic_set(&(device_data->m_tx_drainers), 0);
+
+    // Small writes are held back, until a full packet is waiting, if TX coalescing is enabled.
+    device_data->m_tx_coalesce_usecs = TX_COALESCE_USECS_DEFAULT;
+    device_data->m_tx_coalesce_bytes = device_data->m_bulk_out_max_packet_size;
+    spin_lock_init(&(device_data->m_rx_producer_lock));
+
+    // Bulk OUT endpoint is serviced by the driver-wide poller, once `write()` has some data for it.
+    // Bulk IN endpoint doesn't need the poller, as its URBs are resubmitted by their
+    // completion handler.
+    poller_client_init(&(device_data->m_poller_client), tx_service);
+
+    // Readers are woken up by the poller as well, if RX coalescing holds their wakeup back.
+    device_data->m_rx_coalesce_usecs = RX_COALESCE_USECS_DEFAULT;
+    device_data->m_rx_coalesce_bytes = RX_COALESCE_BYTES_DEFAULT;
+    poller_client_init(&(device_data->m_rx_coalesce_client), rx_coalesce_service);
+
+    // Initialize mutexes.
+    mutex_init(&(device_data->m_mutex));
+    mutex_init(&(device_data->m_open_mutex));
+
+    return device_data;
+}
+
+// ---------------------------------------------------
+// Definition of USB bulk IN/OUT endpoint operations.
+// ---------------------------------------------------
+
+/**
+ * @brief Stores the modem and line status bytes of the received status header.
+ */
+static void rx_update_status(struct device_data * device_data, const u8 * header) {
+    WRITE_ONCE(device_data->m_modem_status, header[0]);
+    WRITE_ONCE(device_data->m_line_status, header[1]);
+    WRITE_ONCE(device_data->m_rx_status_count, device_data->m_rx_status_count + 1);
+}
+
+/**
+ * @brief Records the arrival time of the payload, which has been put into the RX ring at
+ * `position`, overwriting the oldest record, if the timestamp ring is full. Should be called
+ * with `m_rx_producer_lock` locked.
+ */
+static void rx_timestamp_push(struct device_data * device_data, u32 position, u64 arrival_ns, bool is_short) {
+    const unsigned int head = device_data->m_rx_timestamp_head;
+
+    if(head - device_data->m_rx_timestamp_tail == RX_TIMESTAMP_RING_SIZE) {
+        ++(device_data->m_rx_timestamp_tail);
+    }
+
+    device_data->m_rx_timestamps[head & (RX_TIMESTAMP_RING_SIZE - 1)] = (struct rx_timestamp) {
+        .m_position = position,
+        .m_is_short = is_short,
+        .m_ns = arrival_ns
+    };
+
+    device_data->m_rx_timestamp_head = head + 1;
+}
+
+/**
+ * @brief Puts the decoded message into the RX ring along with its size, the message, which
+ * doesn't fit, is dropped as a whole, as well as the empty message and the message with the
+ * wrong CRC, so that it neither wakes up the readers nor is copied to them. Should be called with `m_rx_producer_lock`
+ * locked.
+ */
+static void rx_put_message(void * context, const u8 * message, unsigned int num_bytes) {
+    struct device_data * device_data = context;
+    const long verified = framing_crc_verify(device_data->m_framing_crc, message, num_bytes);
+
+    if(verified < 0) {
+        device_stats_rx_bad_crc_frame(&(device_data->m_stats));
+        return;
+    }
+
+    num_bytes = verified;
+
+    // Messages are limited by `write()` on the other side, the longer one can't be read. Frame,
+    // which holds nothing but the CRC, can't be read either, as the empty read is the end of file.
+    if(num_bytes == 0 || num_bytes > DEVICE_FRAMING_MESSAGE_SIZE_MAX) {
+        device_stats_rx_bad_frames(&(device_data->m_stats), 1);
+        return;
+    }
+
+    const u16 size = num_bytes;
+
+    if(!ring_buffer_write_record(&(device_data->m_rx_ring), &size, sizeof(size), message, num_bytes)) {
+        device_stats_rx_dropped(&(device_data->m_stats), num_bytes);
+    }
+}
+
+/**
+ * @brief Strips the status headers from the packets of the completed bulk IN URB and
+ * puts their payload into the RX ring. Host controller puts packets one after another
+ * into the URB buffer, each of them is `m_bulk_in_max_packet_size` bytes long, except the last
+ * one, which may be shorter (short packet is what completes the URB before it's full).
+ * If a reader waits for a large read, the payload is put straight into its buffer instead.
+ * If the device is framed, the payload is decoded and the RX ring gets the messages.
+ *
+ * @return True if any data has been put into the RX ring or into the buffer of the reader.
+ */
+static bool rx_process_packets(struct device_data * device_data, const u8 * buffer, int length) {
+    const int max_packet_size = device_data->m_bulk_in_max_packet_size;
+    const u64 arrival_ns = ktime_get_ns();
+    unsigned int dropped = 0;
+    unsigned int direct = 0;
+    unsigned int bad_frames = 0;
+
+    spin_lock(&(device_data->m_rx_producer_lock));
+
+    const u32 position = READ_ONCE(device_data->m_rx_ring.m_indices->m_head);
+
+    for(int offset = 0; offset < length; offset += max_packet_size) {
+        const int packet_length = min(max_packet_size, length - offset);
+
+        if(packet_length < FTDI_STATUS_HEADER_SIZE) {
+            break;
+        }
+
+        rx_update_status(device_data, buffer + offset);
+
+        const u8 * payload = buffer + offset + FTDI_STATUS_HEADER_SIZE;
+        unsigned int payload_length = packet_length - FTDI_STATUS_HEADER_SIZE;
+
+        // Framed device gets the decoded messages in the RX ring instead of the payload.
+        if(device_data->m_rx_decoder.m_type != FRAMING_NONE) {
+            bad_frames += framing_decode(&(device_data->m_rx_decoder), payload, payload_length,
+                rx_put_message, device_data
+            );
+            continue;
+        }
+
+        // Buffer of the reader consists of kernel pages, thus it's filled right here. Once it's
+        // full, the rest goes to the RX ring, so the data is never put into the buffer after
+        // the data in the ring, i.e. its order is kept.
+        if(payload_length && device_data->m_rx_direct_iter &&
+            ring_buffer_used(&(device_data->m_rx_ring)) == 0
+        ) {
+            const size_t copied = copy_to_iter(payload, payload_length, device_data->m_rx_direct_iter);
+
+            payload += copied;
+            payload_length -= copied;
+            direct += copied;
+        }
+
+        if(payload_length) {
+            dropped += payload_length - ring_buffer_write(&(device_data->m_rx_ring),
+                payload, payload_length
+            );
+        }
+    }
+
+    if(direct) {
+        WRITE_ONCE(device_data->m_rx_direct_filled, device_data->m_rx_direct_filled + direct);
+    }
+
+    const bool is_ring_filled = READ_ONCE(device_data->m_rx_ring.m_indices->m_head) != position;
+
+    if(is_ring_filled) {
+        rx_timestamp_push(device_data, position, arrival_ns, length % max_packet_size != 0);
+    }
+
+    spin_unlock(&(device_data->m_rx_producer_lock));
+
+    if(dropped) {
+        device_stats_rx_dropped(&(device_data->m_stats), dropped);
+    }
+
+    if(direct) {
+        device_stats_rx_direct(&(device_data->m_stats), direct);
+    }
+
+    if(bad_frames) {
+        device_stats_rx_bad_frames(&(device_data->m_stats), bad_frames);
+    }
+
+    return is_ring_filled || direct;
+}
+
+/**
+ * @brief Wakes up the readers, once enough data has been received, according to the RX coalescing
+ * parameters, i.e. once `m_rx_coalesce_bytes` bytes are unread (in the RX ring or in the buffer
+ * of the reader, which is filled directly) or `m_rx_coalesce_usecs`
+ * microseconds have passed since the first unread byte has been received. The latter is
+ * handled by the poller, which is scheduled along with the first unread byte.
+ */
+static void rx_wake_readers(struct device_data * device_data) {
+    const unsigned int coalesce_usecs = READ_ONCE(device_data->m_rx_coalesce_usecs);
+
+    const size_t unread = ring_buffer_used(&(device_data->m_rx_ring)) +
+        READ_ONCE(device_data->m_rx_direct_filled);
+
+    if(coalesce_usecs == 0 || unread >= READ_ONCE(device_data->m_rx_coalesce_bytes)) {
+        clear_bit(RX_COALESCE_PENDING_BIT, &(device_data->m_rx_coalesce_flags));
+        wake_up_interruptible(&(device_data->m_rx_wait));
+    } else if(!test_and_set_bit(RX_COALESCE_PENDING_BIT, &(device_data->m_rx_coalesce_flags))) {
+        poller_schedule(&(device_data->m_rx_coalesce_client), coalesce_usecs * NSEC_PER_USEC);
+    }
+}
+
+/**
+ * @brief Called by the poller, once the coalescing time has passed since the first unread byte.
+ */
+static void rx_coalesce_service(struct poller_client * client) {
+    struct device_data * device_data = container_of(client, struct device_data, m_rx_coalesce_client);
+
+    if(test_and_clear_bit(RX_COALESCE_PENDING_BIT, &(device_data->m_rx_coalesce_flags))) {
+        wake_up_interruptible(&(device_data->m_rx_wait));
+    }
+}
+
+/**
+ * @brief Resubmits the bulk IN URB, which has been completed.
+ */
+static void rx_urb_resubmit(struct device_data * device_data, struct urb * urb, gfp_t mem_flags) {
+    usb_anchor_urb(urb, &(device_data->m_rx_anchor));
+    const int urb_submit_status = usb_core_submit_urb(device_data, urb, mem_flags);
+
+    if(urb_submit_status) {
+        usb_unanchor_urb(urb);
+        PRINT_DEBUG("rx_urb_resubmit(): failed to resubmit urb: %d.\n", urb_submit_status);
+    }
+}
+
+/**
+ * @brief Callback that is called by USB core, once a bulk IN URB has been completed.
+ * Received data is put into the RX ring, readers are woken up and the URB is resubmitted.
+ */
+static void rx_urb_complete(struct urb * urb) {
+    const u64 stats_start_ns = device_stats_op_start();
+    struct device_data * device_data = urb->context;
+
+    switch(urb->status) {
+    case 0:
+        break;
+
+    case -ENOENT:
+    case -ECONNRESET:
+    case -ESHUTDOWN:
+    case -ENODEV:
+        // URB was killed or the device was disconnected, thus it is not resubmitted.
+        return;
+
+    case -EPIPE:
+        // Halt of the stalled endpoint is cleared by the work, as it sleeps, which
+        // resubmits the URB then.
+        PRINT_DEBUG("rx_urb_complete(): bulk IN endpoint has stalled.\n");
+        usb_anchor_urb(urb, &(device_data->m_rx_halted_anchor));
+
+        if(!test_bit(RX_IS_STOPPED_BIT, &(device_data->m_rx_flags))) {
+            schedule_work(&(device_data->m_rx_halt_work));
+        }
+
+        return;
+
+    default:
+        // Other errors (e.g. `-EPROTO`, `-EILSEQ`, `-EOVERFLOW`) are transient errors of the bus,
+        // thus the data of the URB is lost, but the device keeps receiving.
+        PRINT_DEBUG("rx_urb_complete(): URB bulk IN failed: %d\n", urb->status);
+        rx_urb_resubmit(device_data, urb, GFP_ATOMIC);
+        return;
+    }
+
+    // Every completion carries at least the status header, i.e. the device reports its
+    // status once per latency timer period even if there is no data, thus readers are
+    // woken up only if there is a payload.
+    if(urb->actual_length > FTDI_STATUS_HEADER_SIZE) {
+        // Readers aren't woken up, unless there is something for them, e.g. not for a part
+        // of the message or for a dropped one.
+        if(rx_process_packets(device_data, urb->transfer_buffer, urb->actual_length)) {
+            rx_wake_readers(device_data);
+        }
+
+        // Received data postpones the autosuspend of the device. First data after a resume
+        // completes the measurement of the resume-to-first-byte latency.
+        usb_mark_last_busy(device_data->m_usb_device);
+        const u64 resume_ns = xchg(&(device_data->m_resume_ns), 0);
+
+        if(resume_ns) {
+            device_stats_resume_first_byte(&(device_data->m_stats), ktime_get_ns() - resume_ns);
+        }
+    } else if(urb->actual_length == FTDI_STATUS_HEADER_SIZE) {
+        rx_update_status(device_data, urb->transfer_buffer);
+    }
+
+    // Callers, that wait for the TX data to be drained, look at the fresh line status.
+    if(atomic_read(&(device_data->m_tx_drainers))) {
+        wake_up_interruptible(&(device_data->m_tx_wait));
+    }
+
+    device_stats_op_end(&(device_data->m_stats), HOT_PATH_OP_RX_URB_COMPLETE,
+        stats_start_ns, urb->actual_length
+    );
+
+    // Resubmit the URB, we are in the interrupt context, thus we can't sleep.
+    rx_urb_resubmit(device_data, urb, GFP_ATOMIC);
 }
 
-// --------------------------------------------------------------------------------------------
-// Definition of USB bulk IN/OUT endpoint operations along with timer to check those endpoints.
-// --------------------------------------------------------------------------------------------
+/**
+ * @brief Clears the halt of the stalled bulk IN endpoint and resubmits the URBs, which have been
+ * completed with the stall. URBs are left halted, if the halt couldn't be cleared.
+ */
+static void rx_halt_work(struct work_struct * work) {
+    struct device_data * device_data = container_of(work, struct device_data, m_rx_halt_work);
+    struct urb * urb = NULL;
+
+    if(test_bit(RX_IS_STOPPED_BIT, &(device_data->m_rx_flags))) {
+        return;
+    }
+
+    const int status = usb_core_clear_halt(device_data,
+        usb_rcvbulkpipe(device_data->m_usb_device, device_data->m_bulk_in_endpoint_address)
+    );
+
+    if(status) {
+        PRINT_DEBUG("rx_halt_work(): failed to clear halt: %d.\n", status);
+        return;
+    }
+
+    while((urb = usb_get_from_anchor(&(device_data->m_rx_halted_anchor)))) {
+        rx_urb_resubmit(device_data, urb, GFP_KERNEL);
+        usb_put_urb(urb);
+    }
+}
 
 /**
- * Structure with USB device, that will be initialized in `probe()` method.
+ * @brief Kills all the bulk IN URBs and waits for their completion handlers to finish.
  */
-static struct usb_device * g_usb_device = NULL;
+static void rx_stop(struct device_data * device_data) {
+    // Work, which clears the halt, is done before the URBs are killed, so that it doesn't resubmit
+    // any of them afterwards. Work, which is scheduled meanwhile, does nothing, but it's not left
+    // pending. Halted URBs are dropped, `rx_start()` submits all the URBs anew.
+    set_bit(RX_IS_STOPPED_BIT, &(device_data->m_rx_flags));
+    cancel_work_sync(&(device_data->m_rx_halt_work));
+    usb_core_kill_urbs(device_data, &(device_data->m_rx_anchor));
+    cancel_work_sync(&(device_data->m_rx_halt_work));
+    usb_scuttle_anchored_urbs(&(device_data->m_rx_halted_anchor));
+}
+
+/**
+ * @brief Submits all the bulk IN URBs, which are resubmitted by their completion
+ * handler from then on, until they are killed by `rx_stop()`.
+ */
+static int rx_start(struct device_data * device_data) {
+    clear_bit(RX_IS_STOPPED_BIT, &(device_data->m_rx_flags));
+
+    for(int i = 0; i < device_data->m_rx_urb_count; ++i) {
+        struct urb * urb = device_data->m_rx_urbs[i];
+
+        usb_fill_bulk_urb(urb, device_data->m_usb_device,
+            usb_rcvbulkpipe(device_data->m_usb_device, device_data->m_bulk_in_endpoint_address),
+            urb->transfer_buffer, device_data->m_rx_urb_size,
+            rx_urb_complete, device_data
+        );
+
+        usb_anchor_urb(urb, &(device_data->m_rx_anchor));
+        const int urb_submit_status = usb_core_submit_urb(device_data, urb, GFP_KERNEL);
+
+        if(urb_submit_status) {
+            usb_unanchor_urb(urb);
+            PRINT_DEBUG("rx_start(): failed to submit urb: %d.\n", urb_submit_status);
+            rx_stop(device_data);
+            return urb_submit_status;
+        }
+    }
+
+    return 0;
+}
+
+unsigned int ftdi_usb_driver_rx_timestamp(struct device_data * device_data, bool is_latency_corrected,
+    u64 * arrival_ns
+) {
+    const u32 tail = READ_ONCE(device_data->m_rx_ring.m_indices->m_tail);
+    const unsigned int used = ring_buffer_used(&(device_data->m_rx_ring));
+    unsigned int length = used;
+    unsigned long flags;
+
+    *arrival_ns = 0;
+
+    spin_lock_irqsave(&(device_data->m_rx_producer_lock), flags);
+
+    // Records of the data, which has been consumed already (e.g. by another file), are dropped,
+    // the last record, which starts at the tail or before it, is the one of the data at the tail.
+    while(device_data->m_rx_timestamp_head != device_data->m_rx_timestamp_tail) {
+        const unsigned int next = device_data->m_rx_timestamp_tail + 1;
+        const struct rx_timestamp * next_timestamp =
+            &(device_data->m_rx_timestamps[next & (RX_TIMESTAMP_RING_SIZE - 1)]);
+
+        if(next == device_data->m_rx_timestamp_head || (s32) (next_timestamp->m_position - tail) > 0) {
+            break;
+        }
+
+        device_data->m_rx_timestamp_tail = next;
+    }
+
+    if(device_data->m_rx_timestamp_head != device_data->m_rx_timestamp_tail) {
+        const unsigned int index = device_data->m_rx_timestamp_tail;
+        const struct rx_timestamp * timestamp =
+            &(device_data->m_rx_timestamps[index & (RX_TIMESTAMP_RING_SIZE - 1)]);
+
+        // Record, which starts after the tail, means that the record of the data at the tail has
+        // been overwritten, thus its arrival time is unknown.
+        if((s32) (timestamp->m_position - tail) <= 0) {
+            *arrival_ns = timestamp->m_ns;
+
+            // Data of the short packet has been held by the chip up to the latency timer.
+            if(is_latency_corrected && timestamp->m_is_short) {
+                *arrival_ns -= min_t(u64, *arrival_ns, (u64) g_latency_timer_ms * NSEC_PER_MSEC);
+            }
+
+            if(index + 1 != device_data->m_rx_timestamp_head) {
+                const struct rx_timestamp * next_timestamp =
+                    &(device_data->m_rx_timestamps[(index + 1) & (RX_TIMESTAMP_RING_SIZE - 1)]);
+
+                length = min(length, next_timestamp->m_position - tail);
+            }
+        } else {
+            length = min(length, timestamp->m_position - tail);
+        }
+    }
+
+    spin_unlock_irqrestore(&(device_data->m_rx_producer_lock), flags);
+
+    return length;
+}
+
+bool ftdi_usb_driver_rx_direct_start(struct device_data * device_data, struct iov_iter * iter) {
+    unsigned long flags;
+    bool is_started = false;
+
+    spin_lock_irqsave(&(device_data->m_rx_producer_lock), flags);
+
+    // Data in the RX ring has to be read first, another reader could have started already.
+    if(!device_data->m_rx_direct_iter && !device_data->m_rx_direct_is_blocked &&
+        ring_buffer_used(&(device_data->m_rx_ring)) == 0
+    ) {
+        device_data->m_rx_direct_iter = iter;
+        device_data->m_rx_direct_filled = 0;
+        is_started = true;
+    }
+
+    spin_unlock_irqrestore(&(device_data->m_rx_producer_lock), flags);
+
+    return is_started;
+}
+
+size_t ftdi_usb_driver_rx_direct_stop(struct device_data * device_data) {
+    unsigned long flags;
+
+    // Once the lock is released, no completion handler is filling the buffer anymore.
+    spin_lock_irqsave(&(device_data->m_rx_producer_lock), flags);
+
+    const size_t filled = device_data->m_rx_direct_filled;
+    device_data->m_rx_direct_iter = NULL;
+    device_data->m_rx_direct_filled = 0;
+
+    spin_unlock_irqrestore(&(device_data->m_rx_producer_lock), flags);
+
+    return filled;
+}
+
+bool ftdi_usb_driver_rx_direct_block(struct device_data * device_data) {
+    unsigned long flags;
+
+    spin_lock_irqsave(&(device_data->m_rx_producer_lock), flags);
+
+    const bool is_blocked = !device_data->m_rx_direct_iter;
+
+    if(is_blocked) {
+        device_data->m_rx_direct_is_blocked = true;
+    }
+
+    spin_unlock_irqrestore(&(device_data->m_rx_producer_lock), flags);
+
+    return is_blocked;
+}
+
+void ftdi_usb_driver_rx_direct_unblock(struct device_data * device_data) {
+    unsigned long flags;
+
+    spin_lock_irqsave(&(device_data->m_rx_producer_lock), flags);
+    device_data->m_rx_direct_is_blocked = false;
+    spin_unlock_irqrestore(&(device_data->m_rx_producer_lock), flags);
+}
 
 /**
- * Timer that is used for reading from the bulk IN endpoint.
+ * @brief Maps the data of the TX ring for DMA to the device once, so that neither `write()`
+ * nor the process, that has the ring mapped, pays for mapping of each URB. If the ring couldn't
+ * be mapped, USB core maps each URB as usual.
  */
-static struct timer_list timer_bulk_in;
+static void tx_dma_map(struct device_data * device_data) {
+    struct usb_bus * bus = device_data->m_usb_device->bus;
+
+    if(!hcd_uses_dma(bus_to_hcd(bus))) {
+        return;
+    }
+
+    const dma_addr_t dma = dma_map_single(bus->sysdev, device_data->m_tx_ring.m_data,
+        device_data->m_tx_ring.m_size, DMA_TO_DEVICE
+    );
+
+    if(dma_mapping_error(bus->sysdev, dma)) {
+        PRINT_DEBUG("tx_dma_map(): TX ring couldn't be mapped for DMA.\n");
+        return;
+    }
+
+    device_data->m_tx_ring_dma = dma;
+}
 
 /**
- * Timer that is used for writing to the bulk OUT endpoint.
+ * @brief Unmaps the data of the TX ring, once no URB is sent from it anymore.
  */
-static struct timer_list timer_bulk_out;
+static void tx_dma_unmap(struct device_data * device_data) {
+    if(device_data->m_tx_ring_dma != DMA_MAPPING_ERROR) {
+        dma_unmap_single(device_data->m_usb_device->bus->sysdev, device_data->m_tx_ring_dma,
+            device_data->m_tx_ring.m_size, DMA_TO_DEVICE
+        );
+
+        device_data->m_tx_ring_dma = DMA_MAPPING_ERROR;
+    }
+}
 
 /**
- * @brief Schedules the timer for provided jiffies value.
+ * @brief Hands the part of the TX ring, which has been mapped for DMA, over to the device
+ * and returns its DMA address.
  */
-static void schedule_timer(struct timer_list * timer, unsigned long timeout_jiffies) {
-    const int is_timer_running = mod_timer(timer, timeout_jiffies);
+static dma_addr_t tx_dma_sync(struct device_data * device_data, const char * data, unsigned int num_bytes) {
+    const unsigned long offset = data - device_data->m_tx_ring.m_data;
+
+    dma_sync_single_range_for_device(device_data->m_usb_device->bus->sysdev,
+        device_data->m_tx_ring_dma, offset, num_bytes, DMA_TO_DEVICE
+    );
+
+    return device_data->m_tx_ring_dma + offset;
 }
 
 /**
- * @brief Called by timer to check USB bulk IN endpoint to make 
- * URB read transaction from USB device.
+ * @brief Fills the bulk OUT URB with the next segment of the data of the TX ring. Segment is at most
+ * `m_tx_urb_size` bytes long and, unless it's the last one, its size is a multiple of the max packet
+ * size, so that the device receives full packets only. Data is sent directly from the ring, i.e. it
+ * isn't copied. Should be called with `TX_URB_IN_FLIGHT_BIT` taken.
+ *
+ * @return Size of the segment, 0 if the TX ring is empty.
  */
-static void timer_handler_bulk_in(struct timer_list * timer) {
-    //retval = usb_bulk_msg(device, usb_rcvbulkpipe(device, BULK_EP_IN),
-    //        bulk_buf, MAX_PKT_SIZE, &read_cnt, 5000);
+static unsigned int tx_urb_fill(struct device_data * device_data) {
+    struct urb * urb = device_data->m_tx_urb;
+    const unsigned int max_packet_size = device_data->m_bulk_out_max_packet_size;
+    unsigned int second_part_size = 0;
+    char * first_part = NULL;
+
+    unsigned int first_part_size = ring_buffer_peek(&(device_data->m_tx_ring),
+        &first_part, &second_part_size
+    );
+
+    const unsigned int used = first_part_size + second_part_size;
+
+    if(used == 0) {
+        return 0;
+    }
+
+    // Data, that wraps around the end of the ring, is gathered by the scatter-gather list, if
+    // the host controller supports it and either has no constraints on the size of the entries
+    // or the first entry ends on the packet boundary. Otherwise only the first part is sent
+    // and the second part is sent by the next URB.
+    const struct usb_bus * bus = device_data->m_usb_device->bus;
+    const bool is_sg = second_part_size > 0 && bus->sg_tablesize >= ARRAY_SIZE(device_data->m_tx_sg) &&
+        (bus->no_sg_constraint || first_part_size % max_packet_size == 0);
+    unsigned int num_bytes = min(is_sg ? used : first_part_size, device_data->m_tx_urb_size);
+
+    // Segment, which is followed by more data, is cut on the packet boundary, if it's longer
+    // than a packet, the cut off tail goes to the next URB along with the rest of the data.
+    const bool is_last = num_bytes == used;
+
+    if(!is_last && num_bytes > max_packet_size) {
+        num_bytes = rounddown(num_bytes, max_packet_size);
+    }
+
+    usb_fill_bulk_urb(urb, device_data->m_usb_device,
+		usb_sndbulkpipe(device_data->m_usb_device, device_data->m_bulk_out_endpoint_address),
+		first_part, num_bytes, tx_urb_complete, device_data
+    );
+
+    urb->sg = NULL;
+    urb->num_sgs = 0;
+    urb->num_mapped_sgs = 0;
+    urb->transfer_flags &= ~(URB_ZERO_PACKET | URB_NO_TRANSFER_DMA_MAP);
+
+    const bool is_dma_mapped = device_data->m_tx_ring_dma != DMA_MAPPING_ERROR;
+
+    if(num_bytes > first_part_size) {
+        struct scatterlist * sg = device_data->m_tx_sg;
+        const unsigned int second_size = num_bytes - first_part_size;
 
-    // Reschedule this timer.
-    schedule_timer(timer, TIMER_RESCHEDULE_JIFFIES);
+        sg_set_buf(&(sg[0]), first_part, first_part_size);
+        sg_set_buf(&(sg[1]), device_data->m_tx_ring.m_data, second_size);
+
+        urb->transfer_buffer = NULL;
+        urb->sg = sg;
+        urb->num_sgs = ARRAY_SIZE(device_data->m_tx_sg);
+
+        // Entries of the list already have their DMA addresses, thus USB core doesn't map them.
+        if(is_dma_mapped) {
+            sg_dma_address(&(sg[0])) = tx_dma_sync(device_data, first_part, first_part_size);
+            sg_dma_len(&(sg[0])) = first_part_size;
+            sg_dma_address(&(sg[1])) = tx_dma_sync(device_data, device_data->m_tx_ring.m_data, second_size);
+            sg_dma_len(&(sg[1])) = second_size;
+            urb->num_mapped_sgs = urb->num_sgs;
+        }
+    } else if(is_dma_mapped) {
+        urb->transfer_dma = tx_dma_sync(device_data, first_part, num_bytes);
+    }
+
+    if(is_dma_mapped) {
+        urb->transfer_flags |= URB_NO_TRANSFER_DMA_MAP;
+    }
+
+    // Transfer, that ends exactly on the packet boundary, is terminated by the zero-length packet,
+    // so that the device doesn't wait for more data. Segments, that are followed by more data,
+    // don't need it, as the next URB continues the same stream right away.
+    if(is_last && num_bytes % max_packet_size == 0) {
+        urb->transfer_flags |= URB_ZERO_PACKET;
+    }
+
+    return num_bytes;
 }
 
 /**
- * @brief Callback that is called by USB core, once URB has been completed.
+ * @brief Accounts the submitted URB as a batch of the held writes, if some writes have been
+ * held back by TX coalescing. Their data is sent by this URB, as it takes everything that
+ * is waiting in the TX ring (up to the URB size).
  */
-static void timer_handler_bulk_out_callback(struct urb * urb) {
+static void tx_coalesce_account(struct device_data * device_data) {
+    if(test_and_clear_bit(TX_COALESCE_HELD_BIT, &(device_data->m_tx_flags))) {
+        device_stats_tx_coalesce_batch(&(device_data->m_stats));
+    }
+}
+
+/**
+ * @brief Callback that is called by USB core, once bulk OUT URB has been completed.
+ * If there is more data in the TX ring, the URB is resubmitted right away with the next
+ * segment, so that a large write isn't slowed down by the wakeup of the poller between its URBs.
+ */
+static void tx_urb_complete(struct urb * urb) {
+    const u64 stats_start_ns = device_stats_op_start();
+    struct device_data * device_data = urb->context;
+    unsigned int num_bytes = urb->transfer_buffer_length;
+
     // Check the URB status without considering `-ENOENT`, `-ECONNRESET`, and `-ESHUTDOWN`,
     // as those are the flags accompanying normal URB transactions.
     if (urb->status && 
@@ -126,74 +925,312 @@ static void timer_handler_bulk_out_callback(struct urb * urb) {
 	    urb->status == -ECONNRESET ||
 	    urb->status == -ESHUTDOWN)
     ) {
-		PRINT_DEBUG("timer_handler_bulk_out_callback(): URB bulk OUT failed: %d", urb->status);
+		PRINT_DEBUG("tx_urb_complete(): URB bulk OUT failed: %d", urb->status);
 	}
 
-    // todo:_ check this code
-	// Free URB buffer.
-	//usb_buffer_free(urb->dev, urb->transfer_buffer_length, 
-	//	urb->transfer_buffer, urb->transfer_dma
-    //);
+    // URB, that has been killed (e.g. on suspend), consumes only the data, that has reached
+    // the device, the rest is sent again later. Data of the failed URB is dropped.
+    if(urb->status == -ENOENT || urb->status == -ECONNRESET) {
+        num_bytes = urb->actual_length;
+    }
+
+    PRINT_DEBUG("tx_urb_complete(): URB has been completed.\n");
+
+    device_stats_op_end(&(device_data->m_stats), HOT_PATH_OP_TX_URB_COMPLETE,
+        stats_start_ns, urb->actual_length
+    );
+
+    // Data has left the TX ring, thus its space is given back to the writers.
+    ring_buffer_consume(&(device_data->m_tx_ring), num_bytes);
+    wake_up_interruptible(&(device_data->m_tx_wait));
+
+    // URB, that has been killed or has failed, isn't resubmitted from here, as the device
+    // is either being suspended or gone, the poller retries it otherwise.
+    if(!urb->status && tx_urb_fill(device_data) > 0) {
+        const u64 submit_start_ns = device_stats_op_start();
+
+        usb_anchor_urb(urb, &(device_data->m_tx_anchor));
+
+        if(!usb_core_submit_urb(device_data, urb, GFP_ATOMIC)) {
+            tx_coalesce_account(device_data);
+            device_stats_op_end(&(device_data->m_stats), HOT_PATH_OP_TX_URB_SUBMIT,
+                submit_start_ns, urb->transfer_buffer_length
+            );
+
+            return;
+        }
+
+        usb_unanchor_urb(urb);
+    }
+
+    // Next URB could be submitted by the poller. Data, that has been written after the ring
+    // has been looked at above, is sent by the poller as well. Bit is cleared before the ring
+    // is looked at again, paired with the barrier of `tx_service()`, so that either the service
+    // sees the bit cleared or this sees the data, which the service has given up on.
+    clear_bit_unlock(TX_URB_IN_FLIGHT_BIT, &(device_data->m_tx_flags));
+    smp_mb__after_atomic();
+
+    if(atomic_read(&(device_data->m_tx_drainers))) {
+        wake_up_interruptible(&(device_data->m_tx_wait));
+    }
 
-    PRINT_DEBUG("timer_handler_bulk_out_callback(): URB has been completed.\n");
+    if(ring_buffer_used(&(device_data->m_tx_ring)) > 0) {
+        poller_schedule(&(device_data->m_poller_client), urb->status ? TX_RETRY_DELAY_NS : 0);
+    }
 }
 
 /**
- * @brief Called by timer to check USB bulk OUT endpoint to make 
- * URB write transaction to USB device.
+ * @brief Called by the poller, once `write()` has scheduled the device, to send the data
+ * of the TX ring to the bulk OUT endpoint. The data is sent by a single URB, which is
+ * resubmitted by its completion handler, until the ring is empty. Device is serviced only
+ * while its file is opened, which keeps it resumed.
  */
-static void timer_handler_bulk_out(struct timer_list * timer) {
-    if(g_device_data->m_device_buffer_data_len == 0) {
-        // Reschedule this timer, as there is nothing to write into the device.
-        schedule_timer(timer, TIMER_RESCHEDULE_JIFFIES);
+static void tx_service(struct poller_client * client) {
+    struct device_data * device_data = container_of(client, struct device_data, m_poller_client);
+    const u64 stats_start_ns = device_stats_op_start();
+    struct urb * urb = device_data->m_tx_urb;
+
+    if(ring_buffer_used(&(device_data->m_tx_ring)) == 0) {
+        // Nothing to write into the device.
+        return;
     }
 
-    struct urb * urb = usb_alloc_urb(0, GFP_KERNEL);
-	
-    if (!urb) {
-		goto error;
-	}
-
-    char * urb_buffer = kmalloc(g_device_data->m_device_buffer_data_len * sizeof(char), GFP_KERNEL);
-	
-    if (!urb_buffer) {
-		goto error;
-	}
+    // Head of the ring is looked at before the bit, which is taken only on success, thus the failed
+    // attempt orders nothing. Paired with the barrier of `tx_urb_complete()`.
+    smp_mb();
 
-    // Write our device buffer into URB buffer.
-    for(int i = 0; i < g_device_data->m_device_buffer_data_len; ++i) {
-        urb_buffer[i] = g_device_data->m_device_buffer[i];
+    if(test_and_set_bit_lock(TX_URB_IN_FLIGHT_BIT, &(device_data->m_tx_flags))) {
+        // The rest of the data is sent, once the URB in flight has completed.
+        return;
     }
 
-    usb_fill_bulk_urb(urb, g_usb_device,
-		usb_sndbulkpipe(g_usb_device, BULK_EP_OUT),
-		urb_buffer, g_device_data->m_device_buffer_data_len, 
-        timer_handler_bulk_out_callback, g_device_data
-    );
+    // Ring is looked at after the bit has been taken, so that nothing is consumed in the meantime.
+    tx_urb_fill(device_data);
 
-	// Send URB packet.
-	const int urb_submit_status = usb_submit_urb(urb, GFP_KERNEL);
+	// Send URB packet. URB is anchored, so that it could be killed on disconnect.
+    usb_anchor_urb(urb, &(device_data->m_tx_anchor));
+	const int urb_submit_status = usb_core_submit_urb(device_data, urb, GFP_KERNEL);
 
 	if (urb_submit_status) {
-		PRINT_DEBUG("timer_handler_bulk_out(): failed to submit urb: %d.\n", urb_submit_status);
-		goto error;
+		PRINT_DEBUG("tx_service(): failed to submit urb: %d.\n", urb_submit_status);
+        usb_unanchor_urb(urb);
+        clear_bit_unlock(TX_URB_IN_FLIGHT_BIT, &(device_data->m_tx_flags));
+
+        // Try again later, the data is still in the TX ring.
+        poller_schedule(client, TX_RETRY_DELAY_NS);
+        return;
 	}
 
-    PRINT_DEBUG("timer_handler_bulk_out(): successfully submitted urb.\n");
+    PRINT_DEBUG("tx_service(): successfully submitted urb.\n");
+    tx_coalesce_account(device_data);
+
+    device_stats_op_end(&(device_data->m_stats), HOT_PATH_OP_TX_URB_SUBMIT,
+        stats_start_ns, urb->transfer_buffer_length
+    );
+}
+
+/**
+ * @brief Sends all the data of the TX ring, before the device is stopped by the last closed file.
+ * Gives up, once the device stops taking the data.
+ */
+static void tx_flush(struct device_data * device_data) {
+    unsigned int used = ring_buffer_used(&(device_data->m_tx_ring));
+
+    while(used > 0) {
+        tx_service(&(device_data->m_poller_client));
+        usb_wait_anchor_empty_timeout(&(device_data->m_tx_anchor), TX_FLUSH_TIMEOUT_MS);
+
+        const unsigned int left = ring_buffer_used(&(device_data->m_tx_ring));
+
+        if(left >= used) {
+            break;
+        }
+
+        used = left;
+    }
+}
+
+void ftdi_usb_driver_tx_kick(struct device_data * device_data) {
+    poller_schedule(&(device_data->m_poller_client), 0);
+}
+
+/**
+ * Maximum time to wait for the chip to report, that its transmitter is empty, once all the
+ * data has been sent to it (in milliseconds). It covers the latency timer, after which the
+ * chip sends its status, and draining of its TX FIFO at low baud rates.
+ */
+#define TX_DRAIN_TEMT_TIMEOUT_MS 1000
+
+/**
+ * @brief Returns true if all the data of the TX ring has been sent to the device.
+ */
+static bool tx_is_drained(struct device_data * device_data) {
+    return ring_buffer_used(&(device_data->m_tx_ring)) == 0 &&
+        !test_bit(TX_URB_IN_FLIGHT_BIT, &(device_data->m_tx_flags));
+}
+
+int ftdi_usb_driver_tx_drain(struct device_data * device_data) {
+    // Device is kept resumed, so that the data is sent and the status headers are received.
+    int status = ftdi_usb_driver_pm_get(device_data);
+
+    if(status) {
+        return status;
+    }
+
+    atomic_inc(&(device_data->m_tx_drainers));
+
+    // Data, which is held back by TX coalescing, is sent at once.
+    ftdi_usb_driver_tx_kick(device_data);
+
+    if(wait_event_interruptible(device_data->m_tx_wait,
+        tx_is_drained(device_data) || READ_ONCE(device_data->m_is_disconnected))
+    ) {
+        status = -ERESTARTSYS;
+        goto exit;
+    }
+
+    // Data has reached the chip, but it could still be in its TX FIFO, thus wait for a status
+    // header, which has been received after that, to report the empty transmitter. If it
+    // doesn't come in time, the data is considered to be drained anyway.
+    const unsigned int status_count = READ_ONCE(device_data->m_rx_status_count);
+
+    if(wait_event_interruptible_timeout(device_data->m_tx_wait,
+        (READ_ONCE(device_data->m_rx_status_count) != status_count &&
+        (READ_ONCE(device_data->m_line_status) & FTDI_LINE_STATUS_TEMT)) ||
+        READ_ONCE(device_data->m_is_disconnected),
+        msecs_to_jiffies(TX_DRAIN_TEMT_TIMEOUT_MS)) < 0
+    ) {
+        status = -ERESTARTSYS;
+        goto exit;
+    }
+
+    if(READ_ONCE(device_data->m_is_disconnected)) {
+        status = -ENODEV;
+    }
+
+exit:
+    atomic_dec(&(device_data->m_tx_drainers));
+    ftdi_usb_driver_pm_put(device_data);
+
+    return status;
+}
+
+void ftdi_usb_driver_tx_coalesce(struct device_data * device_data) {
+    const unsigned int coalesce_usecs = READ_ONCE(device_data->m_tx_coalesce_usecs);
+
+    if(coalesce_usecs == 0 ||
+        ring_buffer_used(&(device_data->m_tx_ring)) >= READ_ONCE(device_data->m_tx_coalesce_bytes)
+    ) {
+        ftdi_usb_driver_tx_kick(device_data);
+        return;
+    }
+
+    // Poller keeps the earlier deadline, thus the data is held for the coalescing time since
+    // the first held write, not since the last one. Held data is also sent earlier, once the
+    // URB in flight has completed, as its completion takes everything, that is in the TX ring.
+    set_bit(TX_COALESCE_HELD_BIT, &(device_data->m_tx_flags));
+    device_stats_tx_coalesce_held(&(device_data->m_stats));
+    poller_schedule(&(device_data->m_poller_client), (u64) coalesce_usecs * NSEC_PER_USEC);
+}
 
-	// Release our reference to this urb.
-	usb_free_urb(urb);
+int ftdi_usb_driver_open(struct device_data * device_data) {
+    // Opened device is never suspended, thus only the first opened file could find it suspended
+    // and its resume is the one, which the first received data is measured against.
+    const u64 resume_ns = pm_runtime_suspended(&(device_data->m_interface->dev)) ? ktime_get_ns() : 0;
 
-    // Reschedule this timer.
-    schedule_timer(timer, TIMER_RESCHEDULE_JIFFIES);
-    return;
+    // Device is kept resumed, while it's being started, so that the suspend and resume callbacks,
+    // which look at the number of opened files, don't race with it.
+    int status = ftdi_usb_driver_pm_get(device_data);
+    bool is_first = false;
 
-error:
-	usb_free_urb(urb);
-	kfree(urb_buffer);
+    if(status) {
+        return status;
+    }
+
+    mutex_lock(&(device_data->m_open_mutex));
+
+    if(device_data->m_is_disconnected) {
+        status = -ENODEV;
+    } else if(device_data->m_open_count == 0) {
+        is_first = true;
+
+        // First opened file starts the device. Received data, that nobody has read
+        // before the device was closed, is dropped.
+        ring_buffer_reset(&(device_data->m_rx_ring));
+        ring_buffer_reset(&(device_data->m_tx_ring));
+        device_data->m_rx_timestamp_head = 0;
+        device_data->m_rx_timestamp_tail = 0;
+        framing_decoder_reset(&(device_data->m_rx_decoder), device_data->m_framing);
+        clear_bit(RX_COALESCE_PENDING_BIT, &(device_data->m_rx_coalesce_flags));
+        WRITE_ONCE(device_data->m_resume_ns, resume_ns);
+        status = rx_start(device_data);
+
+        if(!status) {
+            tx_dma_map(device_data);
+            poller_add(&(device_data->m_poller_client));
+            poller_add(&(device_data->m_rx_coalesce_client));
+        }
+    }
+
+    if(!status) {
+        ++device_data->m_open_count;
+    }
+
+    mutex_unlock(&(device_data->m_open_mutex));
+
+    // Opened device isn't suspended, the same as by the USB serial drivers, as the submitted bulk
+    // IN URBs don't hold runtime PM references and the data, which arrives during the suspend,
+    // would be lost. Reference of the first opened file is dropped by the last closed one.
+    if(status || !is_first) {
+        ftdi_usb_driver_pm_put(device_data);
+    }
 
-    // Reschedule this timer.
-    schedule_timer(timer, TIMER_RESCHEDULE_JIFFIES);
+    return status;
+}
+
+void ftdi_usb_driver_release(struct device_data * device_data) {
+    // The same as in `ftdi_usb_driver_open()`, device is kept resumed, while it's being stopped.
+    const bool is_resumed = !ftdi_usb_driver_pm_get(device_data);
+    bool is_last = false;
+
+    mutex_lock(&(device_data->m_open_mutex));
+
+    if(--device_data->m_open_count == 0 && !device_data->m_is_disconnected) {
+        is_last = true;
+
+        // Last closed file stops all the activity of the device, so that an idle device
+        // doesn't cause any wakeups. Data, that hasn't been sent yet, is sent before that.
+        poller_remove(&(device_data->m_rx_coalesce_client));
+        poller_remove(&(device_data->m_poller_client));
+        tx_flush(device_data);
+        usb_core_kill_urbs(device_data, &(device_data->m_tx_anchor));
+        tx_dma_unmap(device_data);
+        rx_stop(device_data);
+    }
+
+    mutex_unlock(&(device_data->m_open_mutex));
+
+    // Reference of the first opened file isn't dropped after a disconnect, as the USB core drops
+    // all the references of the interface, when it's unbound.
+    if(is_last) {
+        ftdi_usb_driver_pm_put(device_data);
+    }
+
+    if(is_resumed) {
+        ftdi_usb_driver_pm_put(device_data);
+    }
+}
+
+int ftdi_usb_driver_pm_get(struct device_data * device_data) {
+    if(READ_ONCE(device_data->m_is_disconnected)) {
+        return -ENODEV;
+    }
+
+    return usb_core_autopm_get(device_data);
+}
+
+void ftdi_usb_driver_pm_put(struct device_data * device_data) {
+    usb_core_autopm_put(device_data);
 }
 
 // -------------------------------------
@@ -206,12 +1243,17 @@ error:
  * exact USB device. The vendor and product ids are obtained from the result of `lsusb` command.
  */
 static struct usb_device_id g_ftdi_devices_table[] = {
-    { USB_DEVICE(FTDI_VENDOR_ID, FTDI_PRODUCT_ID) },
+    { USB_DEVICE(FTDI_VENDOR_ID, FTDI_FT232R_PRODUCT_ID), .driver_info = FTDI_CHIP_FT232R },
+    { USB_DEVICE(FTDI_VENDOR_ID, FTDI_FT2232H_PRODUCT_ID), .driver_info = FTDI_CHIP_FT2232H },
+    { USB_DEVICE(FTDI_VENDOR_ID, FTDI_FT4232H_PRODUCT_ID), .driver_info = FTDI_CHIP_FT4232H },
     {}
 };
 
 static int driver_probe(struct usb_interface * interface, const struct usb_device_id * device_id);
 static void driver_disconnect(struct usb_interface * interface);
+static int driver_suspend(struct usb_interface * interface, pm_message_t message);
+static int driver_resume(struct usb_interface * interface);
+static int driver_reset_resume(struct usb_interface * interface);
 
 /**
  * FTDI USB device driver structure with members:
@@ -231,140 +1273,441 @@ static void driver_disconnect(struct usb_interface * interface);
  *      driver from `modules.alias` file.
  *
  *  * `disconnect()`: gets called, when the device is diconnected.
+ *  * `suspend()`, `resume()`, `reset_resume()`: get called, when the device is suspended
+ *      (either by runtime PM, after it has been idle for a while, or along with the system)
+ *      and resumed, `reset_resume()` is called instead of `resume()`, if the device has been
+ *      reset during the suspend, i.e. has lost its configuration.
  *  * `id_table()`: index of vendor and product ids of devices that this driver supports.
+ *  * `supports_autosuspend`: lets the runtime PM suspend idle devices.
  */
  static struct usb_driver g_ftdi_usb_driver = {
     .name = "ftdi_usb_driver",
     .probe = driver_probe,
     .disconnect = driver_disconnect,
+    .suspend = driver_suspend,
+    .resume = driver_resume,
+    .reset_resume = driver_reset_resume,
     .id_table = g_ftdi_devices_table,
+    .supports_autosuspend = 1,
 };
 
-int device_data_allocate(int usb_bulk_endpoint_max_packet_size);
-void device_data_free(void);
-
 /**
- * Module name and the class name, which will be used as USB device name and its class name
- * respectively.
+ * Module name and the class name, which will be used as the name of the character device
+ * region (visible in `/proc/devices`) and the name of the device class (visible in `/sys/class`)
+ * respectively. Device files are named after the class along with their minor number.
  */
+static char * g_module_name = NULL;
 static char * g_usb_device_class_name = NULL;
 
-int ftdi_usb_driver_register(char * usb_device_class_name, int usb_bulk_endpoint_max_packet_size) {
-    g_usb_device_class_name = usb_device_class_name;
+/**
+ * First device number of the character device region of this driver.
+ */
+VISIBLE_IF_KUNIT dev_t g_device_number_base = 0;
+
+/**
+ * Class of our devices, which makes udev create the device files in `/dev/` directory.
+ */
+static struct class * g_device_class = NULL;
 
-    // Allocate device data structure that will be used in `read()` and `write()` file operations.
-    int device_data_error = device_data_allocate(usb_bulk_endpoint_max_packet_size);
+/**
+ * Connected devices indexed by their minor numbers. Minor numbers are allocated from it as well,
+ * thus the lowest free minor number is reused, once a device has been disconnected.
+ */
+VISIBLE_IF_KUNIT DEFINE_XARRAY_ALLOC(g_devices);
 
-    if(device_data_error) {
-        PRINT_DEBUG("ftdi_usb_driver_register(): device data allocation failed with error code: %d\n", 
-            device_data_error
+int ftdi_usb_driver_register(char * module_name, char * usb_device_class_name,
+    int usb_bulk_in_urb_size, int usb_bulk_out_urb_size, int baud_rate, int latency_timer_ms,
+    int autosuspend_delay_ms
+) {
+    g_module_name = module_name;
+    g_usb_device_class_name = usb_device_class_name;
+    g_usb_bulk_in_urb_size = usb_bulk_in_urb_size;
+    g_usb_bulk_out_urb_size = usb_bulk_out_urb_size;
+    g_baud_rate = baud_rate;
+    g_latency_timer_ms = latency_timer_ms;
+    g_autosuspend_delay_ms = autosuspend_delay_ms;
+
+    // Allocate our own range of device numbers, instead of sharing the small window of minor
+    // numbers of the USB major number with all the other drivers, that use `usb_register_dev()`.
+    int status = alloc_chrdev_region(&g_device_number_base, 0, DEVICE_MINOR_COUNT, g_module_name);
+
+    if(status) {
+        PRINT_DEBUG("ftdi_usb_driver_register(): device numbers allocation failed with error code: %d\n",
+            status
         );
 
-        return device_data_error;
+        return status;
+    }
+
+    g_device_class = class_create(g_usb_device_class_name);
+
+    if(IS_ERR(g_device_class)) {
+        status = PTR_ERR(g_device_class);
+        PRINT_DEBUG("ftdi_usb_driver_register(): device class creation failed with error code: %d\n", status);
+        unregister_chrdev_region(g_device_number_base, DEVICE_MINOR_COUNT);
+        return status;
     }
 
-    // Create timers for bulk IN and OUT endpoints.
-	const int flags = 0;
-	timer_setup(&timer_bulk_in, &timer_handler_bulk_in, flags);
-    timer_setup(&timer_bulk_out, &timer_handler_bulk_out, flags);
+    // Start a single poller thread, which services all the devices.
+    status = poller_start(g_module_name);
+
+    if(status) {
+        PRINT_DEBUG("ftdi_usb_driver_register(): poller start failed with error code: %d\n", status);
+        class_destroy(g_device_class);
+        unregister_chrdev_region(g_device_number_base, DEVICE_MINOR_COUNT);
+        return status;
+    }
 
     // Register this FTDI USB driver.
-    const int usb_register_error = usb_register(&g_ftdi_usb_driver);
+    status = usb_register(&g_ftdi_usb_driver);
 
-    if(usb_register_error) {
+    if(status) {
         PRINT_DEBUG("ftdi_usb_driver_register(): device registration failed with error code: %d\n", 
-            usb_register_error
+            status
         );
-    } else{
-        PRINT_DEBUG("ftdi_usb_driver_register(): device was successfully registered.\n");
+
+        poller_stop();
+        class_destroy(g_device_class);
+        unregister_chrdev_region(g_device_number_base, DEVICE_MINOR_COUNT);
+        return status;
     }
 
-    return usb_register_error;
+    PRINT_DEBUG("ftdi_usb_driver_register(): device was successfully registered with major number: %d.\n",
+        MAJOR(g_device_number_base)
+    );
+
+    return 0;
 }
 
 void ftdi_usb_driver_deregister(void) {
-    // Deregister this FTDI USB driver.
+    // Deregister this FTDI USB driver. It disconnects all the devices, which
+    // frees their device data, once the files they have opened are closed.
     usb_deregister(&g_ftdi_usb_driver);
 
-    // Delete timers. In order to make sure that one core doesn't destroy the timer, 
-    // while another executes its handler, we have to use `del_timer_sync()` function,
-	// instead of plain `del_timer()` function.
-	const int is_timer_bulk_in_running = del_timer_sync(&timer_bulk_in);
+    poller_stop();
+    class_destroy(g_device_class);
+    unregister_chrdev_region(g_device_number_base, DEVICE_MINOR_COUNT);
+    xa_destroy(&g_devices);
 
-	if(is_timer_bulk_in_running == 1) {
-		PRINT_DEBUG("ftdi_usb_driver_deregister(): timer_bulk_in is still running after deleting.\n");
-	} else {
-		PRINT_DEBUG("ftdi_usb_driver_deregister(): timer_bulk_in was successfully deleted.\n");
-	}
+    PRINT_DEBUG("ftdi_usb_driver_deregister(): device was deregestered.\n");
+}
 
-    const int is_timer_bulk_out_running = del_timer_sync(&timer_bulk_out);
+struct device_data * ftdi_usb_driver_get_device_data(int minor) {
+    // Device is removed from the array in `disconnect()` under the same lock before its
+    // reference is dropped, thus the reference is taken while the device data is still alive.
+    xa_lock(&g_devices);
+    struct device_data * device_data = xa_load(&g_devices, minor);
 
-	if(is_timer_bulk_out_running == 1) {
-		PRINT_DEBUG("ftdi_usb_driver_deregister(): timer_bulk_out is still running after deleting.\n");
-	} else {
-		PRINT_DEBUG("ftdi_usb_driver_deregister(): timer_bulk_out was successfully deleted.\n");
-	}
+    if(device_data) {
+        kref_get(&(device_data->m_kref));
+    }
 
-    // Free the device data structure, allocated for this device.
-    device_data_free();
+    xa_unlock(&g_devices);
 
-    PRINT_DEBUG("ftdi_usb_driver_deregister(): device was deregestered.\n");
+    return device_data;
+}
+
+/**
+ * @brief Allocates a minor number for the device and creates its character device along with
+ * the device file `/dev/<usb_device_class_name><minor>`.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+static int device_file_create(struct device_data * device_data) {
+    u32 minor = 0;
+    int status = xa_alloc(&g_devices, &minor, device_data,
+        XA_LIMIT(0, DEVICE_MINOR_COUNT - 1), GFP_KERNEL
+    );
+
+    if(status) {
+        return status;
+    }
+
+    device_data->m_minor = minor;
+
+    // Character device is allocated separately from the device data, as it's referenced
+    // by the opened files until they are closed, i.e. it's released after our `release()`.
+    device_data->m_cdev = cdev_alloc();
+
+    if(!device_data->m_cdev) {
+        xa_erase(&g_devices, minor);
+        return -ENOMEM;
+    }
+
+    device_data->m_cdev->owner = THIS_MODULE;
+    device_data->m_cdev->ops = get_file_operations();
+
+    const dev_t device_number = MKDEV(MAJOR(g_device_number_base), minor);
+    status = cdev_add(device_data->m_cdev, device_number, 1);
+
+    if(status) {
+        kobject_put(&(device_data->m_cdev->kobj));
+        device_data->m_cdev = NULL;
+        xa_erase(&g_devices, minor);
+        return status;
+    }
+
+    device_data->m_device = device_create_with_groups(g_device_class, &(device_data->m_interface->dev),
+        device_number, device_data, get_device_attribute_groups(), "%s%d", g_usb_device_class_name, minor
+    );
+
+    if(IS_ERR(device_data->m_device)) {
+        status = PTR_ERR(device_data->m_device);
+        device_data->m_device = NULL;
+        cdev_del(device_data->m_cdev);
+        device_data->m_cdev = NULL;
+        xa_erase(&g_devices, minor);
+        return status;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Removes the device file and gives the minor number back, after this
+ * no new `open()` can find this device.
+ */
+static void device_file_remove(struct device_data * device_data) {
+    device_destroy(g_device_class, MKDEV(MAJOR(g_device_number_base), device_data->m_minor));
+    cdev_del(device_data->m_cdev);
+    xa_erase(&g_devices, device_data->m_minor);
 }
 
 /**
- * Structure with our usb device class, which will be initialized in `probe()` method.
+ * Default baud rate of HC-06, which is used if the requested one isn't supported by the chip.
  */
-static struct usb_class_driver g_usb_device_class;
+#define FTDI_FALLBACK_BAUD_RATE 9600
+
+/**
+ * @brief Resets the channel of the device and configures its UART, i.e. baud rate, 8N1 data
+ * format without flow control and the latency timer, which defines how long the chip holds
+ * a partially filled bulk IN packet before sending it.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+static int ftdi_configure_channel(struct device_data * device_data) {
+    struct usb_device * usb_device = device_data->m_usb_device;
+    const u16 channel = device_data->m_channel;
+    int baud_rate = g_baud_rate;
+
+    int status = ftdi_sio_request(usb_device, FTDI_SIO_RESET, FTDI_SIO_RESET_SIO, channel);
+
+    if(status) {
+        return status;
+    }
+
+    if(baud_rate > ftdi_max_baud_rate(device_data->m_chip_type)) {
+        PRINT_DEBUG("ftdi_configure_channel(): baud rate %d isn't supported by the chip (up to %d), using %d.\n",
+            baud_rate, ftdi_max_baud_rate(device_data->m_chip_type), FTDI_FALLBACK_BAUD_RATE
+        );
+
+        baud_rate = FTDI_FALLBACK_BAUD_RATE;
+    }
+
+    status = ftdi_set_baud_rate(usb_device, device_data->m_chip_type, channel, baud_rate);
+
+    if(status) {
+        return status;
+    }
+
+    status = ftdi_sio_request(usb_device, FTDI_SIO_SET_DATA, FTDI_SIO_SET_DATA_8N1, channel);
+
+    if(status) {
+        return status;
+    }
+
+    status = ftdi_sio_request(usb_device, FTDI_SIO_SET_FLOW_CTRL, FTDI_SIO_DISABLE_FLOW_CTRL, channel);
+
+    if(status) {
+        return status;
+    }
+
+    return ftdi_sio_request(usb_device, FTDI_SIO_SET_LATENCY_TIMER, g_latency_timer_ms, channel);
+}
 
 static int driver_probe(struct usb_interface * interface, const struct usb_device_id * device_id) {
-    // Get USB device from its interface.
-    g_usb_device = interface_to_usbdev(interface);
-
-    // Instantiate USB device class with its name and file operations.
-    // For that, we have to create a class name string like so: `usb/<usb_device_class_name>%d`,
-    // where `%d` will be filled via USB core with the minor number of the device.
-    // We have to create this string by allocating a new one that has `usb/` string + 4 for `%d`
-    // (we reserve up to 3-digit minor number, just in case, along with terminating NUL character) + 
-    // the length of our usb device class name, i.e. the custom name that we want our device to have 
-    // in `/dev/` directory along with its minor number.
-    const char * str_usb = "usb/";
-    const char * str_minor_number_placeholder = "%d";
-    const int str_alloc_size = strlen(g_usb_device_class_name) + strlen(str_usb) + 4;
-    char * new_usb_class_name_str = kmalloc(str_alloc_size * sizeof(char), GFP_KERNEL);
-
-    snprintf(new_usb_class_name_str, str_alloc_size * sizeof(char), "%s%s%s",
-        str_usb, g_usb_device_class_name, str_minor_number_placeholder
+    // Discover bulk IN and OUT endpoints (along with their max packet sizes) from the
+    // interface descriptors, instead of relying on fixed endpoint addresses and sizes.
+    struct usb_endpoint_descriptor * bulk_in = NULL;
+    struct usb_endpoint_descriptor * bulk_out = NULL;
+    const int endpoints_status = usb_find_common_endpoints(interface->cur_altsetting,
+        &bulk_in, &bulk_out, NULL, NULL
+    );
+
+    if(endpoints_status) {
+        PRINT_DEBUG("driver_probe(): interface has no bulk IN/OUT endpoints: %d.\n", endpoints_status);
+        return endpoints_status;
+    }
+
+    struct device_data * device_data = device_data_allocate(interface, bulk_in, bulk_out);
+
+    if(!device_data) {
+        PRINT_DEBUG("driver_probe(): device data allocation failed.\n");
+        return -ENOMEM;
+    }
+
+    // Multi-channel chips (FT2232H, FT4232H) expose every channel as a separate interface with
+    // its own bulk endpoints, thus each interface is probed separately and gets its own device
+    // data, RX/TX engines and device file. Channels are addressed in `wIndex` of the vendor
+    // requests starting from 1 (interface A).
+    device_data->m_chip_type = device_id->driver_info;
+    device_data->m_channel = interface->cur_altsetting->desc.bInterfaceNumber + 1;
+
+    PRINT_DEBUG("driver_probe(): channel %u, bulk IN 0x%02x (%d bytes), bulk OUT 0x%02x (%d bytes), RX URB %d bytes.\n",
+        device_data->m_channel,
+        device_data->m_bulk_in_endpoint_address, device_data->m_bulk_in_max_packet_size,
+        device_data->m_bulk_out_endpoint_address, device_data->m_bulk_out_max_packet_size,
+        device_data->m_rx_urb_size
     );
 
-    new_usb_class_name_str[strlen(new_usb_class_name_str)] = '\0';
+    const int configure_status = ftdi_configure_channel(device_data);
 
-    g_usb_device_class.name = new_usb_class_name_str;
-    g_usb_device_class.fops = get_file_operations(g_device_data);
+    if(configure_status) {
+        PRINT_DEBUG("driver_probe(): channel configuration failed: %d.\n", configure_status);
+        device_data_put(device_data);
+        return configure_status;
+    }
 
-    // Now register the USB device, so that the kernel creates it a file in sysfs, 
-    // i.e. in `/dev/` directory.
-    int registration_status = usb_register_dev(interface, &g_usb_device_class);
+    usb_set_intfdata(interface, device_data);
+
+    // Create the device file, `open()` can be called right after that.
+    const int registration_status = device_file_create(device_data);
 
     if (registration_status) {
-        PRINT_DEBUG("driver_probe(): couldn't register a USB device with status: %d.\n",
+        PRINT_DEBUG("driver_probe(): couldn't create a device file with status: %d.\n",
             registration_status
         );
-    } else {
-        PRINT_DEBUG("driver_probe(): successfully registered a USB device with minor number: %d\n",
-            interface->minor
-        );
-    }
 
-    // Once registration of USB device is done, we can free the string that we allocated for its name.
-    kfree(new_usb_class_name_str);
+        usb_set_intfdata(interface, NULL);
+        device_data_put(device_data);
+        return registration_status;
+    }
 
-    // Schedule both bulk IN and OUT timers.
-    schedule_timer(&timer_bulk_in, TIMER_START_JIFFIES);
-    schedule_timer(&timer_bulk_out, TIMER_START_JIFFIES);
+    PRINT_DEBUG("driver_probe(): successfully created a device file with minor number: %d\n",
+        device_data->m_minor
+    );
 
+    // Expose counters of the hot path via debugfs, in the directory named after the device file.
+    char debugfs_name[64];
+    snprintf(debugfs_name, sizeof(debugfs_name), "%s%d", g_usb_device_class_name, device_data->m_minor);
+    device_stats_debugfs_create(&(device_data->m_stats), debugfs_name);
+
+    // Microbenchmark of the framing codecs goes along with them.
+    framing_debugfs_create(device_data->m_stats.m_debugfs_dir);
+
+    // Device stays idle, i.e. neither bulk IN URBs are submitted nor the device is serviced by
+    // the poller, until its file is opened for the first time. Idle device is suspended by the
+    // runtime PM after the autosuspend delay, once the autosuspend is allowed by the userspace
+    // (`power/control` of the USB device), which the driver leaves alone. Delay belongs to
+    // the USB device, thus it's set by the first interface, not by every channel.
+    if(g_autosuspend_delay_ms >= 0 && interface->cur_altsetting->desc.bInterfaceNumber == 0) {
+        pm_runtime_set_autosuspend_delay(&(device_data->m_usb_device->dev), g_autosuspend_delay_ms);
+    }
     return 0;
 }
 
 static void driver_disconnect(struct usb_interface * interface) {
-    usb_deregister_dev(interface, &g_usb_device_class);
+    struct device_data * device_data = usb_get_intfdata(interface);
+
+    // Give back the minor number, after this no new `open()` can find this device.
+    device_file_remove(device_data);
+    usb_set_intfdata(interface, NULL);
+
+    // Stop receiving and sending, if the device is opened. Once the device is removed from the
+    // poller, its data isn't sent anymore, thus no new bulk OUT URB could be submitted.
+    mutex_lock(&(device_data->m_open_mutex));
+    WRITE_ONCE(device_data->m_is_disconnected, true);
+
+    if(device_data->m_open_count > 0) {
+        poller_remove(&(device_data->m_rx_coalesce_client));
+        poller_remove(&(device_data->m_poller_client));
+        rx_stop(device_data);
+    }
+
+    mutex_unlock(&(device_data->m_open_mutex));
+    usb_core_kill_urbs(device_data, &(device_data->m_tx_anchor));
+    tx_dma_unmap(device_data);
+
+    // Wake up the readers and the writers, so that they return an error.
+    wake_up_interruptible(&(device_data->m_rx_wait));
+    wake_up_interruptible(&(device_data->m_tx_wait));
+
+    device_stats_debugfs_remove(&(device_data->m_stats));
+
+    // Drop the reference of the interface, device data is freed once all its files are closed.
+    device_data_put(device_data);
+}
+
+/**
+ * Maximum time to wait for the submitted bulk OUT URBs on system suspend (in milliseconds).
+ */
+#define SUSPEND_TX_DRAIN_TIMEOUT_MS 1000
+
+static int driver_suspend(struct usb_interface * interface, pm_message_t message) {
+    struct device_data * device_data = usb_get_intfdata(interface);
+
+    if(!device_data) {
+        return 0;
+    }
+
+    // Opened file holds a runtime PM reference, thus runtime suspend isn't attempted while
+    // the device is serviced, but the data, which the last closed file couldn't send, could
+    // still be waiting in the TX ring or in flight, in which case runtime suspend is refused.
+    if(PMSG_IS_AUTO(message) && (ring_buffer_used(&(device_data->m_tx_ring)) > 0 ||
+        !usb_anchor_empty(&(device_data->m_tx_anchor)))
+    ) {
+        return -EBUSY;
+    }
+
+    // System suspend doesn't wait for the opened files, thus let the submitted
+    // data reach the device before killing what is left. Data in the TX ring and in
+    // the RX ring stays where it is and is handled after the resume.
+    usb_wait_anchor_empty_timeout(&(device_data->m_tx_anchor), SUSPEND_TX_DRAIN_TIMEOUT_MS);
+    usb_core_kill_urbs(device_data, &(device_data->m_tx_anchor));
+
+    if(READ_ONCE(device_data->m_open_count) > 0) {
+        rx_stop(device_data);
+    }
+
+    device_stats_suspend(&(device_data->m_stats));
+    PRINT_DEBUG("driver_suspend(): device has been suspended.\n");
+
+    return 0;
+}
+
+static int driver_resume(struct usb_interface * interface) {
+    struct device_data * device_data = usb_get_intfdata(interface);
+    int status = 0;
+
+    if(!device_data) {
+        return 0;
+    }
+
+    device_stats_resume(&(device_data->m_stats));
+
+    if(READ_ONCE(device_data->m_open_count) > 0) {
+        // Restart receiving and let the poller send the data, which was written while
+        // the device has been suspended.
+        status = rx_start(device_data);
+        ftdi_usb_driver_tx_kick(device_data);
+    }
+
+    PRINT_DEBUG("driver_resume(): device has been resumed: %d.\n", status);
+
+    return status;
+}
+
+static int driver_reset_resume(struct usb_interface * interface) {
+    struct device_data * device_data = usb_get_intfdata(interface);
+
+    if(device_data) {
+        // Device has lost its configuration, thus configure the channel again.
+        const int configure_status = ftdi_configure_channel(device_data);
+
+        if(configure_status) {
+            PRINT_DEBUG("driver_reset_resume(): channel configuration failed: %d.\n", configure_status);
+        }
+    }
+
+    return driver_resume(interface);
 }
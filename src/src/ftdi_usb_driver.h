@@ -7,17 +7,39 @@
 #define FTDI_USB_DRIVER_H
 
 #include <linux/usb.h>
+#include <linux/xarray.h>
 
+#include "device_data.h"
+
+/**
+ * Number of minor numbers, which are reserved for the devices of this driver. Each channel of
+ * each adapter takes one minor number, thus even racks of quad-channel adapters fit into it.
+ */
+#define DEVICE_MINOR_COUNT 4096
 
 /**
  * Registers our FTDI device USB driver.
  *
- * @param usb_device_class_name Will be used as a USB device class name.
+ * @param module_name Will be used as the name of the character device region.
+ * @param usb_device_class_name Will be used as a device class name and as a prefix
+ *      of the device file names, i.e. `/dev/<usb_device_class_name><minor>`.
+ * @param usb_bulk_in_urb_size Size of bulk IN URBs, clamped to [512, 16384] bytes and
+ *      rounded down to a multiple of the maximum packet size of the bulk IN endpoint,
+ *      which is discovered from the interface descriptors of each device.
+ * @param usb_bulk_out_urb_size Maximum size of bulk OUT URBs, clamped to [64, 65536] bytes
+ *      and rounded down to a multiple of the maximum packet size of the bulk OUT endpoint.
+ * @param baud_rate Baud rate of every channel, up to 3 Mbaud on FT232R
+ *      and up to 12 Mbaud on FT2232H/FT4232H.
+ * @param latency_timer_ms Latency timer of every channel (in milliseconds).
+ * @param autosuspend_delay_ms Idle period, after which the device is suspended by the runtime
+ *      PM (in milliseconds), once the userspace allows the autosuspend, negative value leaves
+ *      the autosuspend delay of the device as it is.
  *
  * @return 0 on success, anything else on failure.
  */
-int ftdi_usb_driver_register(char * usb_device_class_name, 
-    int usb_bulk_endpoint_max_packet_size
+int ftdi_usb_driver_register(char * module_name, char * usb_device_class_name,
+    int usb_bulk_in_urb_size, int usb_bulk_out_urb_size, int baud_rate, int latency_timer_ms,
+    int autosuspend_delay_ms
 );
 
 /**
@@ -25,5 +47,124 @@ int ftdi_usb_driver_register(char * usb_device_class_name,
  */
 void ftdi_usb_driver_deregister(void);
 
+/**
+ * Finds the connected device by the minor number of its file and takes a reference
+ * to its device data, which has to be dropped via `device_data_put()`.
+ *
+ * @return Device data on success, `NULL` if there is no such device.
+ */
+struct device_data * ftdi_usb_driver_get_device_data(int minor);
+
+/**
+ * Drops the reference to the device data, which is freed along with the last reference.
+ */
+void device_data_put(struct device_data * device_data);
+
+/**
+ * Accounts an opened file of the device. The first opened file starts receiving the data from the
+ * device and lets the poller service it.
+ *
+ * @return 0 on success, `-ENODEV` if the device has been disconnected, other negative error code
+ * if the device couldn't be started.
+ */
+int ftdi_usb_driver_open(struct device_data * device_data);
+
+/**
+ * Accounts a closed file of the device. The last closed file stops all the activity of the device.
+ */
+void ftdi_usb_driver_release(struct device_data * device_data);
+
+/**
+ * Takes a runtime PM reference, which resumes the device, if it has been suspended,
+ * and keeps it resumed until the reference is dropped via `ftdi_usb_driver_pm_put()`.
+ *
+ * @return 0 on success, negative error code if the device couldn't be resumed.
+ */
+int ftdi_usb_driver_pm_get(struct device_data * device_data);
+
+/**
+ * Drops the runtime PM reference, the device is suspended after the autosuspend delay.
+ */
+void ftdi_usb_driver_pm_put(struct device_data * device_data);
+
+/**
+ * Returns the arrival time of the data at the tail of the RX ring, i.e. the time of the completion
+ * of the bulk IN URB, which has received it (`CLOCK_MONOTONIC`, in nanoseconds, 0 if its record has
+ * been overwritten). If `is_latency_corrected` is true and the chip has sent the data, once its
+ * latency timer has expired, the latency timer is subtracted as an estimate of the time spent
+ * in the chip. Should be called by the consumer of the RX ring.
+ *
+ * @return Number of bytes at the tail of the RX ring, which have arrived at that time.
+ */
+unsigned int ftdi_usb_driver_rx_timestamp(struct device_data * device_data, bool is_latency_corrected,
+    u64 * arrival_ns
+);
+
+/**
+ * Lets the bulk IN URB completion handlers put the received data straight into the buffer of the
+ * iterator, instead of the RX ring, until `ftdi_usb_driver_rx_direct_stop()` is called. Iterator
+ * must be backed by kernel pages (e.g. bvec), as it's filled in the interrupt context. Only one
+ * reader could do it at a time and only while the RX ring is empty.
+ *
+ * @return True if the buffer is being filled, false if the data has to be read from the RX ring.
+ */
+bool ftdi_usb_driver_rx_direct_start(struct device_data * device_data, struct iov_iter * iter);
+
+/**
+ * Stops filling the buffer, which has been passed to `ftdi_usb_driver_rx_direct_start()`.
+ * Iterator has been advanced past the data put into the buffer.
+ *
+ * @return Number of bytes put into the buffer.
+ */
+size_t ftdi_usb_driver_rx_direct_stop(struct device_data * device_data);
+
+/**
+ * Keeps the readers from starting to fill their buffers via `ftdi_usb_driver_rx_direct_start()`,
+ * so that all the received data goes to the RX ring, until `ftdi_usb_driver_rx_direct_unblock()`
+ * is called.
+ *
+ * @return False if a reader is filling its buffer already, i.e. nothing has been blocked.
+ */
+bool ftdi_usb_driver_rx_direct_block(struct device_data * device_data);
+
+/**
+ * Lets the readers fill their buffers again.
+ */
+void ftdi_usb_driver_rx_direct_unblock(struct device_data * device_data);
+
+/**
+ * Schedules the data of the TX ring to be sent to the bulk OUT endpoint by the poller at once.
+ */
+void ftdi_usb_driver_tx_kick(struct device_data * device_data);
+
+/**
+ * Schedules the data of the TX ring to be sent to the bulk OUT endpoint by the poller, once
+ * TX coalescing allows it, i.e. small writes are held back for the coalescing time, so that
+ * they are sent together. Without coalescing it is the same as `ftdi_usb_driver_tx_kick()`.
+ */
+void ftdi_usb_driver_tx_coalesce(struct device_data * device_data);
+
+/**
+ * Waits, until all the written data has left the host, i.e. the TX ring is empty and the bulk
+ * OUT URB has completed, and then, until the chip reports its transmitter to be empty.
+ *
+ * @return 0 on success, `-ERESTARTSYS` if waiting has been interrupted, `-ENODEV` if the device
+ * has been disconnected.
+ */
+int ftdi_usb_driver_tx_drain(struct device_data * device_data);
+
+#if IS_ENABLED(CONFIG_KUNIT)
+/**
+ * Internals of the driver, which the KUnit suite of the data path creates its devices with,
+ * i.e. without probing: the first device number of the driver, the devices indexed by their
+ * minor numbers and the allocation of the device data for the interface.
+ */
+extern dev_t g_device_number_base;
+extern struct xarray g_devices;
+
+struct device_data * device_data_allocate(struct usb_interface * interface,
+    const struct usb_endpoint_descriptor * bulk_in, const struct usb_endpoint_descriptor * bulk_out
+);
+#endif
 
 #endif // FTDI_USB_DRIVER_H
@@ -28,10 +28,39 @@ static char * g_module_name = "emil_bluetooth_hc_06_driver";
 static char * g_device_class_name = "emil_hc_06";
 
 /**
- * Maximum packet size of the USB interface bulk in/out endpoints, that will be 
- * used to read the exact number of bytes from that endpoint into our buffer.
+ * Size of the transfer buffer of bulk IN URBs (in bytes). It is larger than the maximum
+ * packet size, so that the host controller fills a single URB with many packets before
+ * completing it, which results in far fewer completion interrupts per received megabyte.
+ * Value is clamped to [512, 16384] and rounded down to a multiple of the max packet size.
  */
-static int g_usb_bulk_endpoint_max_packet_size = 64;
+static int g_usb_bulk_in_urb_size = 4096;
+
+/**
+ * Maximum size of bulk OUT URBs (in bytes). Written data is split into URBs of this size,
+ * so that a large write is sent by a handful of URBs instead of one URB per packet.
+ * Value is clamped to [64, 65536] and rounded down to a multiple of the max packet size.
+ */
+static int g_usb_bulk_out_urb_size = 16384;
+
+/**
+ * Baud rate of the UART of every channel. HC-06 communicates at 9600 baud by default,
+ * FT232R supports up to 3 Mbaud, FT2232H and FT4232H support up to 12 Mbaud.
+ */
+static int g_baud_rate = 9600;
+
+/**
+ * Latency timer of every channel (in milliseconds, from 1 to 255), i.e. how long the chip
+ * waits before sending a partially filled bulk IN packet.
+ */
+static int g_latency_timer_ms = 16;
+
+/**
+ * Idle period (in milliseconds), after which the device is suspended by the runtime PM,
+ * so that an idle adapter doesn't keep the bus awake. Negative value leaves the autosuspend
+ * delay of the device as it is. Autosuspend itself is allowed by the userspace, e.g. by udev
+ * rule `ATTR{power/control}="auto"`.
+ */
+static int g_autosuspend_delay_ms = 2000;
 
 /**
  * Permission `S_IRUGO` means that the world can see the value of this parameter,
@@ -40,7 +69,11 @@ static int g_usb_bulk_endpoint_max_packet_size = 64;
  */
 module_param(g_module_name, charp, S_IRUGO);
 module_param(g_device_class_name, charp, S_IRUGO);
-module_param(g_usb_bulk_endpoint_max_packet_size, int, S_IRUGO);
+module_param(g_usb_bulk_in_urb_size, int, S_IRUGO);
+module_param(g_usb_bulk_out_urb_size, int, S_IRUGO);
+module_param(g_baud_rate, int, S_IRUGO);
+module_param(g_latency_timer_ms, int, S_IRUGO);
+module_param(g_autosuspend_delay_ms, int, S_IRUGO);
 
 // --------------------------------------------
 // Initialization and unitialization functions.
@@ -61,15 +94,39 @@ patch-level: %d, sub-level: %d)\n",
 		LINUX_VERSION_PATCHLEVEL, LINUX_VERSION_SUBLEVEL
 	);
 
-	if(g_usb_bulk_endpoint_max_packet_size <= 0) {
-		PRINT_DEBUG("__INIT__ module %s>> invalid value of USB bulk endpoint max size (should be > 0): %d.\n",
-			g_module_name, g_usb_bulk_endpoint_max_packet_size
+	if(g_usb_bulk_in_urb_size <= 0) {
+		PRINT_DEBUG("__INIT__ module %s>> invalid value of USB bulk IN URB size (should be > 0): %d.\n",
+			g_module_name, g_usb_bulk_in_urb_size
 		);
 	}
 
-	// Register FTDI USB device.
+	if(g_usb_bulk_out_urb_size <= 0) {
+		PRINT_DEBUG("__INIT__ module %s>> invalid value of USB bulk OUT URB size (should be > 0): %d.\n",
+			g_module_name, g_usb_bulk_out_urb_size
+		);
+	}
+
+	if(g_baud_rate <= 0 || g_baud_rate > 12000000) {
+		PRINT_DEBUG("__INIT__ module %s>> invalid value of baud rate (should be in (0, 12000000]): %d.\n",
+			g_module_name, g_baud_rate
+		);
+
+		return -EINVAL;
+	}
+
+	if(g_latency_timer_ms < 1 || g_latency_timer_ms > 255) {
+		PRINT_DEBUG("__INIT__ module %s>> invalid value of latency timer (should be in [1, 255]): %d.\n",
+			g_module_name, g_latency_timer_ms
+		);
+
+		return -EINVAL;
+	}
+
+	// Register FTDI USB device. Endpoints and their max packet sizes are discovered
+	// per device from its interface descriptors.
 	int usb_registration_status = ftdi_usb_driver_register(
-		g_device_class_name, g_usb_bulk_endpoint_max_packet_size
+		g_module_name, g_device_class_name, g_usb_bulk_in_urb_size, g_usb_bulk_out_urb_size,
+		g_baud_rate, g_latency_timer_ms, g_autosuspend_delay_ms
 	);
 
 	if(usb_registration_status) {
@@ -0,0 +1,187 @@
+#include "poller.h"
+#include "custom_macros.h"
+
+#include <linux/err.h>
+#include <linux/freezer.h>
+#include <linux/hrtimer.h>
+#include <linux/kthread.h>
+#include <linux/mutex.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+
+/**
+ * Slack of the poller deadlines (in nanoseconds). Clients, whose deadlines are within the slack
+ * of each other, are serviced in a single wakeup and the timer of the thread could be merged
+ * with other timers of the system.
+ */
+#define POLLER_SLACK_NS (50 * NSEC_PER_USEC)
+
+/**
+ * Poller thread.
+ */
+static struct task_struct * g_poller_thread = NULL;
+
+/**
+ * Clients of the poller. List is protected by `g_poller_clients_mutex`, which is also held,
+ * while clients are being serviced, so that a client couldn't be removed in the middle of it.
+ */
+static LIST_HEAD(g_poller_clients);
+static DEFINE_MUTEX(g_poller_clients_mutex);
+
+/**
+ * Protects the deadlines of the clients, which are updated from any context.
+ */
+static DEFINE_SPINLOCK(g_poller_deadline_lock);
+
+/**
+ * @brief Returns the deadline of the client and clears it, if the client is due by `now`.
+ *
+ * @return True if the client is due.
+ */
+static bool poller_take_due(struct poller_client * client, ktime_t now) {
+    unsigned long flags;
+    bool is_due = false;
+
+    spin_lock_irqsave(&g_poller_deadline_lock, flags);
+
+    if(ktime_before(client->m_deadline, ktime_add_ns(now, POLLER_SLACK_NS))) {
+        client->m_deadline = KTIME_MAX;
+        is_due = true;
+    }
+
+    spin_unlock_irqrestore(&g_poller_deadline_lock, flags);
+
+    return is_due;
+}
+
+/**
+ * @brief Returns the earliest deadline of all the clients, `KTIME_MAX` if there is no work.
+ * Should be called with `g_poller_clients_mutex` locked.
+ */
+static ktime_t poller_next_deadline(void) {
+    ktime_t next_deadline = KTIME_MAX;
+    unsigned long flags;
+    struct poller_client * client;
+
+    spin_lock_irqsave(&g_poller_deadline_lock, flags);
+
+    list_for_each_entry(client, &g_poller_clients, m_node) {
+        if(ktime_before(client->m_deadline, next_deadline)) {
+            next_deadline = client->m_deadline;
+        }
+    }
+
+    spin_unlock_irqrestore(&g_poller_deadline_lock, flags);
+
+    return next_deadline;
+}
+
+/**
+ * @brief Function of the poller thread, which services all the due clients and sleeps
+ * until the next deadline. Thread is frozen during the system suspend, so that the clients,
+ * which are rescheduled meanwhile (e.g. the data of the killed bulk OUT URB), aren't serviced
+ * until the devices are resumed.
+ */
+static int poller_thread_fn(void * data) {
+    set_freezable();
+
+    while(!kthread_should_stop()) {
+        struct poller_client * client;
+
+        try_to_freeze();
+        mutex_lock(&g_poller_clients_mutex);
+
+        const ktime_t now = ktime_get();
+
+        list_for_each_entry(client, &g_poller_clients, m_node) {
+            if(poller_take_due(client, now)) {
+                client->m_service(client);
+            }
+        }
+
+        // Thread state is changed before looking at the deadlines, so that the wakeup of
+        // `poller_schedule()`, which is called after that, isn't lost, i.e. `schedule()` returns
+        // immediately, if the thread has been woken up in the meantime. Sleeping thread is
+        // frozen without being woken up.
+        set_current_state(TASK_INTERRUPTIBLE | TASK_FREEZABLE);
+        ktime_t next_deadline = poller_next_deadline();
+        mutex_unlock(&g_poller_clients_mutex);
+
+        if(kthread_should_stop()) {
+            __set_current_state(TASK_RUNNING);
+            break;
+        }
+
+        if(next_deadline == KTIME_MAX) {
+            // Every device is idle, thus sleep until some work is scheduled.
+            schedule();
+        } else if(ktime_after(next_deadline, ktime_get())) {
+            schedule_hrtimeout_range(&next_deadline, POLLER_SLACK_NS, HRTIMER_MODE_ABS);
+        } else {
+            __set_current_state(TASK_RUNNING);
+        }
+    }
+
+    return 0;
+}
+
+int poller_start(const char * name) {
+    g_poller_thread = kthread_run(poller_thread_fn, NULL, "%s", name);
+
+    if(IS_ERR(g_poller_thread)) {
+        const int status = PTR_ERR(g_poller_thread);
+        g_poller_thread = NULL;
+        return status;
+    }
+
+    return 0;
+}
+
+void poller_stop(void) {
+    if(g_poller_thread) {
+        kthread_stop(g_poller_thread);
+        g_poller_thread = NULL;
+    }
+}
+
+void poller_client_init(struct poller_client * client, poller_service_fn service) {
+    INIT_LIST_HEAD(&(client->m_node));
+    client->m_deadline = KTIME_MAX;
+    client->m_service = service;
+}
+
+void poller_add(struct poller_client * client) {
+    client->m_deadline = KTIME_MAX;
+
+    mutex_lock(&g_poller_clients_mutex);
+    list_add_tail(&(client->m_node), &g_poller_clients);
+    mutex_unlock(&g_poller_clients_mutex);
+}
+
+void poller_remove(struct poller_client * client) {
+    // Clients are serviced with the mutex locked, thus the client isn't being serviced,
+    // once the mutex is acquired here.
+    mutex_lock(&g_poller_clients_mutex);
+    list_del_init(&(client->m_node));
+    mutex_unlock(&g_poller_clients_mutex);
+}
+
+void poller_schedule(struct poller_client * client, u64 delay_ns) {
+    const ktime_t deadline = ktime_add_ns(ktime_get(), delay_ns);
+    bool is_earlier = false;
+    unsigned long flags;
+
+    spin_lock_irqsave(&g_poller_deadline_lock, flags);
+
+    if(ktime_before(deadline, client->m_deadline)) {
+        client->m_deadline = deadline;
+        is_earlier = true;
+    }
+
+    spin_unlock_irqrestore(&g_poller_deadline_lock, flags);
+
+    // Thread has to be woken up only if its sleep could be too long for the new deadline.
+    if(is_earlier) {
+        wake_up_process(g_poller_thread);
+    }
+}
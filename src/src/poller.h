@@ -0,0 +1,77 @@
+/**
+ * @brief File contains a single driver-wide poller, i.e. a kernel thread, which services the
+ * deferred work of all the devices (sending the buffered data, flushes of coalesced data, etc.).
+ * Each device schedules its work with a deadline, the thread sleeps until the earliest deadline
+ * of all the devices, services every device that is due at once and sleeps without any timeout,
+ * if no device has any work scheduled. Thus the number of wakeups doesn't grow with the number
+ * of connected adapters and idle adapters don't wake the CPU at all.
+ */
+
+#ifndef POLLER_H
+#define POLLER_H
+
+#include <linux/ktime.h>
+#include <linux/list.h>
+
+struct poller_client;
+
+/**
+ * Function, which services the work of the client. It is called from the poller thread, i.e. in
+ * process context, but it mustn't wait for its device (e.g. for a resume), as every other client
+ * waits for it then, the work, which can't be done right away, is scheduled again instead.
+ */
+typedef void (*poller_service_fn)(struct poller_client * client);
+
+/**
+ * Client of the poller, which is embedded into the structure of each device.
+ */
+struct poller_client {
+    /** Node in the list of the clients of the poller. */
+    struct list_head m_node;
+
+    /** Time when the client has to be serviced, `KTIME_MAX` if no work is scheduled. */
+    ktime_t m_deadline;
+
+    /** Function that services the work of the client. */
+    poller_service_fn m_service;
+};
+
+/**
+ * @brief Starts the poller thread.
+ *
+ * @param name Name of the thread (visible in `ps`).
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int poller_start(const char * name);
+
+/**
+ * @brief Stops the poller thread. All the clients have to be removed before.
+ */
+void poller_stop(void);
+
+/**
+ * @brief Initializes the client, it isn't added to the poller yet.
+ */
+void poller_client_init(struct poller_client * client, poller_service_fn service);
+
+/**
+ * @brief Adds the client to the poller. No work is scheduled for it yet.
+ */
+void poller_add(struct poller_client * client);
+
+/**
+ * @brief Removes the client from the poller. Once this function returns, the service
+ * function of the client is neither running nor will be called anymore. Could be called
+ * for the client, which hasn't been added or has already been removed.
+ */
+void poller_remove(struct poller_client * client);
+
+/**
+ * @brief Schedules the client to be serviced in `delay_ns` nanoseconds (0 means as soon as
+ * possible). If the client has already been scheduled earlier, the earlier deadline is kept.
+ * Could be called from any context, including URB completion handlers.
+ */
+void poller_schedule(struct poller_client * client, u64 delay_ns);
+
+#endif // POLLER_H
@@ -0,0 +1,170 @@
+#include "ring_buffer.h"
+
+#include <linux/errno.h>
+#include <linux/gfp.h>
+#include <linux/log2.h>
+#include <linux/minmax.h>
+#include <linux/mm.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/uio.h>
+
+int ring_buffer_allocate(struct ring_buffer * ring, unsigned int size) {
+    size = roundup_pow_of_two(max_t(unsigned int, size, PAGE_SIZE));
+    ring->m_size = size;
+
+    // Buffer is allocated as physically contiguous pages, so that it could be
+    // used for DMA and mapped to userspace, if needed. Indices get a page of their
+    // own for the same reason, as only whole pages could be mapped.
+    ring->m_data = (char *) __get_free_pages(GFP_KERNEL | __GFP_ZERO, get_order(size));
+    ring->m_indices = (struct ring_buffer_indices *) get_zeroed_page(GFP_KERNEL);
+
+    if(!ring->m_data || !ring->m_indices) {
+        ring_buffer_free(ring);
+        return -ENOMEM;
+    }
+
+    return 0;
+}
+
+void ring_buffer_free(struct ring_buffer * ring) {
+    if(ring->m_data) {
+        free_pages((unsigned long) ring->m_data, get_order(ring->m_size));
+        ring->m_data = NULL;
+    }
+
+    if(ring->m_indices) {
+        free_page((unsigned long) ring->m_indices);
+        ring->m_indices = NULL;
+    }
+}
+
+void ring_buffer_reset(struct ring_buffer * ring) {
+    WRITE_ONCE(ring->m_indices->m_head, 0);
+    WRITE_ONCE(ring->m_indices->m_tail, 0);
+}
+
+/**
+ * @brief Copies the data into the ring at the producer index `head` without publishing it.
+ * Should be called only for the data, that fits into the ring.
+ */
+static void ring_buffer_copy_in(struct ring_buffer * ring, unsigned int head, const void * data,
+    unsigned int num_bytes
+) {
+    const unsigned int offset = head & (ring->m_size - 1);
+
+    // Data may wrap around the end of the buffer, thus it is copied in (at most) two parts.
+    const unsigned int first_part = min(num_bytes, ring->m_size - offset);
+    memcpy(ring->m_data + offset, data, first_part);
+    memcpy(ring->m_data, (const char *) data + first_part, num_bytes - first_part);
+}
+
+unsigned int ring_buffer_write(struct ring_buffer * ring, const void * data, unsigned int num_bytes) {
+    const unsigned int head = READ_ONCE(ring->m_indices->m_head);
+
+    num_bytes = min(num_bytes, ring_buffer_available(ring));
+    ring_buffer_copy_in(ring, head, data, num_bytes);
+
+    // Publish the data to the consumer only after it has been copied.
+    smp_store_release(&(ring->m_indices->m_head), head + num_bytes);
+
+    return num_bytes;
+}
+
+bool ring_buffer_write_record(struct ring_buffer * ring, const void * header, unsigned int header_size,
+    const void * data, unsigned int num_bytes
+) {
+    const unsigned int head = READ_ONCE(ring->m_indices->m_head);
+
+    if((u64) header_size + num_bytes > ring_buffer_available(ring)) {
+        return false;
+    }
+
+    ring_buffer_copy_in(ring, head, header, header_size);
+    ring_buffer_copy_in(ring, head + header_size, data, num_bytes);
+
+    // Consumer sees either the whole record or nothing of it.
+    smp_store_release(&(ring->m_indices->m_head), head + header_size + num_bytes);
+
+    return true;
+}
+
+long ring_buffer_copy_to_iter(struct ring_buffer * ring, struct iov_iter * iter, size_t num_bytes) {
+    const unsigned int tail = READ_ONCE(ring->m_indices->m_tail);
+    const unsigned int offset = tail & (ring->m_size - 1);
+
+    num_bytes = min_t(size_t, num_bytes, ring_buffer_used(ring));
+
+    const unsigned int first_part = min_t(unsigned int, num_bytes, ring->m_size - offset);
+    unsigned int copied = copy_to_iter(ring->m_data + offset, first_part, iter);
+
+    if(copied == first_part && num_bytes > first_part) {
+        copied += copy_to_iter(ring->m_data, num_bytes - first_part, iter);
+    }
+
+    if(copied == 0 && num_bytes > 0) {
+        return -EFAULT;
+    }
+
+    // Give the space back to the producer only after the data has been copied out.
+    smp_store_release(&(ring->m_indices->m_tail), tail + copied);
+
+    return copied;
+}
+
+long ring_buffer_copy_from_iter(struct ring_buffer * ring, struct iov_iter * iter, size_t num_bytes) {
+    const unsigned int head = READ_ONCE(ring->m_indices->m_head);
+    const unsigned int offset = head & (ring->m_size - 1);
+
+    num_bytes = min_t(size_t, num_bytes, ring_buffer_available(ring));
+
+    const unsigned int first_part = min_t(unsigned int, num_bytes, ring->m_size - offset);
+    unsigned int copied = copy_from_iter(ring->m_data + offset, first_part, iter);
+
+    if(copied == first_part && num_bytes > first_part) {
+        copied += copy_from_iter(ring->m_data, num_bytes - first_part, iter);
+    }
+
+    if(copied == 0 && num_bytes > 0) {
+        return -EFAULT;
+    }
+
+    // Publish the data to the consumer only after all of it has been copied.
+    smp_store_release(&(ring->m_indices->m_head), head + copied);
+
+    return copied;
+}
+
+unsigned int ring_buffer_peek(const struct ring_buffer * ring, char ** first_part,
+    unsigned int * second_part_size
+) {
+    const unsigned int offset = READ_ONCE(ring->m_indices->m_tail) & (ring->m_size - 1);
+    const unsigned int used = ring_buffer_used(ring);
+    const unsigned int first_part_size = min(used, ring->m_size - offset);
+
+    *first_part = ring->m_data + offset;
+    *second_part_size = used - first_part_size;
+
+    return first_part_size;
+}
+
+int ring_buffer_mmap(struct ring_buffer * ring, struct vm_area_struct * vma) {
+    if(vma->vm_end - vma->vm_start != PAGE_SIZE + ring->m_size) {
+        return -EINVAL;
+    }
+
+    // Mapping can't grow and isn't a part of core dumps, as it is shared with the device.
+    vm_flags_set(vma, VM_DONTEXPAND | VM_DONTDUMP);
+
+    int status = remap_pfn_range(vma, vma->vm_start, virt_to_phys(ring->m_indices) >> PAGE_SHIFT,
+        PAGE_SIZE, vma->vm_page_prot
+    );
+
+    if(status) {
+        return status;
+    }
+
+    return remap_pfn_range(vma, vma->vm_start + PAGE_SIZE, virt_to_phys(ring->m_data) >> PAGE_SHIFT,
+        ring->m_size, vma->vm_page_prot
+    );
+}
@@ -0,0 +1,157 @@
+/**
+ * @brief File contains a single-producer/single-consumer byte ring buffer, which is used to
+ * pass data between URB completion handlers (interrupt context) and file operations (process
+ * context) without a lock shared by both sides. Ring could be mapped to userspace, so that
+ * a process takes the place of one of the sides and accesses the data without a copy.
+ */
+
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <linux/types.h>
+#include <linux/compiler.h>
+#include <linux/minmax.h>
+#include <asm/barrier.h>
+
+struct vm_area_struct;
+
+/**
+ * Indices of the ring, which are located in their own page, so that they could be mapped to
+ * userspace along with the data. Each index is on its own cache line, so that the producer
+ * and the consumer don't bounce the same cache line between their CPUs.
+ */
+struct ring_buffer_indices {
+    /** Producer index, i.e. where the next byte will be written to. */
+    unsigned int m_head;
+    unsigned int m_reserved0[15];
+
+    /** Consumer index, i.e. where the next byte will be read from. */
+    unsigned int m_tail;
+    unsigned int m_reserved1[15];
+};
+
+/**
+ * Ring buffer with free-running producer and consumer indices. Size of the buffer is a
+ * power of two, thus an index is converted to the buffer offset by masking it with `size - 1`
+ * and the number of used bytes is simply `head - tail` (even after the indices wrap around).
+ * Indices are published with release semantics and read with acquire semantics, so that
+ * the other side sees the data that was written before the index was updated. Once the ring
+ * is mapped to userspace, the index of the other side could be anything, thus the number of
+ * used bytes is clamped to the size of the buffer and the data is never accessed out of it.
+ */
+struct ring_buffer {
+    /** Page-backed buffer with the data. */
+    char * m_data;
+
+    /** Size of the buffer (power of two). */
+    unsigned int m_size;
+
+    /** Page with the producer and the consumer indices. */
+    struct ring_buffer_indices * m_indices;
+};
+
+/**
+ * @brief Allocates the buffer of the ring along with the page of its indices. Size is rounded
+ * up to a power of two and to at least one page.
+ *
+ * @return 0 on success, `-ENOMEM` on failure.
+ */
+int ring_buffer_allocate(struct ring_buffer * ring, unsigned int size);
+
+/**
+ * @brief Frees the buffer of the ring.
+ */
+void ring_buffer_free(struct ring_buffer * ring);
+
+/**
+ * @brief Drops all the data in the ring. Must not race with the producer or the consumer.
+ */
+void ring_buffer_reset(struct ring_buffer * ring);
+
+/**
+ * @brief Returns the number of bytes that could be read from the ring.
+ */
+static inline unsigned int ring_buffer_used(const struct ring_buffer * ring) {
+    return min(smp_load_acquire(&(ring->m_indices->m_head)) - READ_ONCE(ring->m_indices->m_tail),
+        ring->m_size
+    );
+}
+
+/**
+ * @brief Returns the number of bytes that could be written to the ring.
+ */
+static inline unsigned int ring_buffer_available(const struct ring_buffer * ring) {
+    const unsigned int used = READ_ONCE(ring->m_indices->m_head) -
+        smp_load_acquire(&(ring->m_indices->m_tail));
+
+    return ring->m_size - min(used, ring->m_size);
+}
+
+/**
+ * @brief Producer side: copies up to `num_bytes` bytes into the ring.
+ *
+ * @return Number of bytes that were copied, i.e. that fit into the ring.
+ */
+unsigned int ring_buffer_write(struct ring_buffer * ring, const void * data, unsigned int num_bytes);
+
+/**
+ * @brief Producer side: copies the header and the data into the ring as a single record, which is
+ * published to the consumer at once, i.e. the consumer never sees only a part of it.
+ *
+ * @return True if the record has been copied, false if it doesn't fit into the ring.
+ */
+bool ring_buffer_write_record(struct ring_buffer * ring, const void * header, unsigned int header_size,
+    const void * data, unsigned int num_bytes
+);
+
+struct iov_iter;
+
+/**
+ * @brief Consumer side: copies up to `num_bytes` bytes from the ring to the iterator, which could
+ * describe either user buffers (possibly many of them, e.g. for `readv()`) or kernel buffers,
+ * and consumes them.
+ *
+ * @return Number of bytes that were copied or `-EFAULT`, if nothing could be copied
+ * due to the bad user address.
+ */
+long ring_buffer_copy_to_iter(struct ring_buffer * ring, struct iov_iter * iter, size_t num_bytes);
+
+/**
+ * @brief Producer side: copies up to `num_bytes` bytes from the iterator, which could describe
+ * many user buffers (e.g. for `writev()`), into the ring. All the copied bytes are published to
+ * the consumer at once, i.e. the consumer never sees only a part of them.
+ *
+ * @return Number of bytes that were copied or `-EFAULT`, if nothing could be copied
+ * due to the bad user address.
+ */
+long ring_buffer_copy_from_iter(struct ring_buffer * ring, struct iov_iter * iter, size_t num_bytes);
+
+/**
+ * @brief Consumer side: returns the data, that could be read from the ring, without consuming it.
+ * As the data may wrap around the end of the buffer, it is returned as (at most) two parts:
+ * the first one starts at `*first_part` and the second one starts at the beginning of the buffer.
+ *
+ * @return Size of the first part. Size of the second part is stored to `second_part_size`.
+ */
+unsigned int ring_buffer_peek(const struct ring_buffer * ring, char ** first_part,
+    unsigned int * second_part_size
+);
+
+/**
+ * @brief Consumer side: consumes `num_bytes` bytes, which have been peeked before,
+ * and gives their space back to the producer.
+ */
+static inline void ring_buffer_consume(struct ring_buffer * ring, unsigned int num_bytes) {
+    smp_store_release(&(ring->m_indices->m_tail), READ_ONCE(ring->m_indices->m_tail) + num_bytes);
+}
+
+/**
+ * @brief Maps the ring to userspace: the page of the indices goes first, followed by the data.
+ * Mapping has to cover both of them exactly.
+ *
+ * @return 0 on success, `-EINVAL` if the size of the mapping doesn't match the ring,
+ * other negative error code on failure.
+ */
+int ring_buffer_mmap(struct ring_buffer * ring, struct vm_area_struct * vma);
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,23 @@
+#include "usb_core.h"
+#include "device_data.h"
+
+int usb_core_submit_urb(struct device_data * device_data, struct urb * urb, gfp_t mem_flags) {
+    return usb_submit_urb(urb, mem_flags);
+}
+
+void usb_core_kill_urbs(struct device_data * device_data, struct usb_anchor * anchor) {
+    usb_kill_anchored_urbs(anchor);
+}
+
+int usb_core_clear_halt(struct device_data * device_data, unsigned int pipe) {
+    return usb_clear_halt(device_data->m_usb_device, pipe);
+}
+
+int usb_core_autopm_get(struct device_data * device_data) {
+    return usb_autopm_get_interface(device_data->m_interface);
+}
+
+void usb_core_autopm_put(struct device_data * device_data) {
+    usb_mark_last_busy(device_data->m_usb_device);
+    usb_autopm_put_interface(device_data->m_interface);
+}
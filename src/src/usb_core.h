@@ -0,0 +1,48 @@
+/**
+ * @brief File contains the calls of the USB core, which the data path of the driver makes, i.e.
+ * submitting and killing of the URBs and taking of the runtime PM references. KUnit build of the
+ * module links the mock of the USB core (`tests/ftdi_usb_driver_test.c`) instead of this file,
+ * thus the data path runs without any device there.
+ */
+
+#ifndef USB_CORE_H
+#define USB_CORE_H
+
+#include <linux/usb.h>
+
+struct device_data;
+
+/**
+ * @brief Submits the URB of the device.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int usb_core_submit_urb(struct device_data * device_data, struct urb * urb, gfp_t mem_flags);
+
+/**
+ * @brief Kills the anchored URBs of the device and waits for their completion handlers to finish.
+ */
+void usb_core_kill_urbs(struct device_data * device_data, struct usb_anchor * anchor);
+
+/**
+ * @brief Clears the halt of the endpoint of the device, may sleep.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int usb_core_clear_halt(struct device_data * device_data, unsigned int pipe);
+
+/**
+ * @brief Takes a runtime PM reference to the interface, which resumes the device, if it has been
+ * suspended, may sleep.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+int usb_core_autopm_get(struct device_data * device_data);
+
+/**
+ * @brief Drops the runtime PM reference to the interface, the device is suspended once the
+ * autosuspend delay has passed since now.
+ */
+void usb_core_autopm_put(struct device_data * device_data);
+
+#endif // USB_CORE_H
@@ -0,0 +1,305 @@
+/**
+ * @brief File contains the KUnit suite of the codecs of the framed mode and of the CRCs, which is
+ * built into the module by `make kunit`. Word-at-a-time variants of the codecs are checked against
+ * their scalar references, which are visible to the KUnit build only.
+ */
+
+#include "../src/framing.h"
+
+#include <kunit/test.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+/**
+ * Largest message of the suite and the number of the messages, that the decoder keeps.
+ */
+#define FRAMING_TEST_MESSAGE_SIZE_MAX 1024
+#define FRAMING_TEST_MESSAGE_COUNT 8
+
+/**
+ * Messages, which have been decoded.
+ */
+struct framing_test_messages {
+    u8 m_data[FRAMING_TEST_MESSAGE_COUNT][FRAMING_TEST_MESSAGE_SIZE_MAX];
+    unsigned int m_sizes[FRAMING_TEST_MESSAGE_COUNT];
+    unsigned int m_count;
+};
+
+static void framing_test_on_message(void * context, const u8 * message, unsigned int num_bytes) {
+    struct framing_test_messages * messages = context;
+
+    if(messages->m_count < FRAMING_TEST_MESSAGE_COUNT) {
+        memcpy(messages->m_data[messages->m_count], message, num_bytes);
+        messages->m_sizes[messages->m_count] = num_bytes;
+    }
+
+    ++(messages->m_count);
+}
+
+static void framing_test_decoder_free(void * data) {
+    framing_decoder_free(data);
+}
+
+/**
+ * @brief Allocates the decoder of the messages of up to `FRAMING_TEST_MESSAGE_SIZE_MAX` bytes,
+ * which is freed at the end of the test.
+ */
+static struct framing_decoder * framing_test_decoder(struct kunit * test, enum framing_type type) {
+    struct framing_decoder * decoder = kunit_kzalloc(test, sizeof(struct framing_decoder), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_NULL(test, decoder);
+    KUNIT_ASSERT_EQ(test, framing_decoder_allocate(decoder, FRAMING_TEST_MESSAGE_SIZE_MAX), 0);
+    KUNIT_ASSERT_EQ(test, kunit_add_action_or_reset(test, framing_test_decoder_free, decoder), 0);
+
+    framing_decoder_reset(decoder, type);
+    return decoder;
+}
+
+/**
+ * @brief Fills the message with the bytes, that are special to both of the framings, here and there.
+ */
+static void framing_test_message_fill(u8 * message, size_t num_bytes, unsigned int seed) {
+    static const u8 special[] = { 0x00, SLIP_END, SLIP_ESC, SLIP_ESC_END, SLIP_ESC_ESC };
+
+    for(size_t i = 0; i < num_bytes; ++i) {
+        const unsigned int value = (i + 1) * 2654435761U + seed;
+
+        message[i] = value % 13 == 0 ? special[(value >> 8) % ARRAY_SIZE(special)] : value >> 16;
+    }
+}
+
+/**
+ * @brief Checks, that the word-at-a-time encoder produces the same frame as the scalar one and that
+ * the frame is decoded back into the message by both of the decoders.
+ */
+static void framing_test_round_trip(struct kunit * test, enum framing_type type, const u8 * message,
+    size_t num_bytes
+) {
+    const size_t frame_size_max = framing_encoded_size_max(type, num_bytes);
+    u8 * scalar_frame = kunit_kmalloc(test, frame_size_max, GFP_KERNEL);
+    u8 * frame = kunit_kmalloc(test, frame_size_max, GFP_KERNEL);
+    struct framing_test_messages * messages = kunit_kzalloc(test, sizeof(*messages), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_NULL(test, scalar_frame);
+    KUNIT_ASSERT_NOT_NULL(test, frame);
+    KUNIT_ASSERT_NOT_NULL(test, messages);
+
+    const size_t scalar_frame_size = type == FRAMING_COBS ? cobs_encode_scalar(message, num_bytes, scalar_frame) :
+        slip_encode_scalar(message, num_bytes, scalar_frame);
+    const size_t frame_size = framing_encode(type, message, num_bytes, frame);
+
+    KUNIT_ASSERT_LE(test, frame_size, frame_size_max);
+    KUNIT_ASSERT_EQ(test, frame_size, scalar_frame_size);
+    KUNIT_EXPECT_MEMEQ(test, frame, scalar_frame, frame_size);
+
+    // Delimiter doesn't occur within the frame.
+    const u8 delimiter = type == FRAMING_COBS ? 0 : SLIP_END;
+
+    KUNIT_EXPECT_EQ(test, frame[frame_size - 1], delimiter);
+    KUNIT_EXPECT_PTR_EQ(test, memchr(frame + 1, delimiter, frame_size - 2), NULL);
+
+    struct framing_decoder * decoder = framing_test_decoder(test, type);
+
+    KUNIT_EXPECT_EQ(test, framing_decode(decoder, frame, frame_size, framing_test_on_message, messages), 0);
+    KUNIT_EXPECT_EQ(test, framing_decode_scalar(decoder, frame, frame_size, framing_test_on_message, messages), 0);
+    KUNIT_ASSERT_EQ(test, messages->m_count, 2);
+
+    for(int i = 0; i < 2; ++i) {
+        KUNIT_ASSERT_EQ(test, messages->m_sizes[i], num_bytes);
+        KUNIT_EXPECT_MEMEQ(test, messages->m_data[i], message, num_bytes);
+    }
+}
+
+/**
+ * @brief Messages of the sizes around the COBS block boundary, of zeroes only and of special bytes only.
+ */
+static void framing_round_trip_test(struct kunit * test) {
+    static const size_t sizes[] = { 1, 2, 7, 8, 9, 253, 254, 255, 256, 508, 509, FRAMING_TEST_MESSAGE_SIZE_MAX };
+    u8 * message = kunit_kmalloc(test, FRAMING_TEST_MESSAGE_SIZE_MAX, GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_NULL(test, message);
+
+    for(enum framing_type type = FRAMING_COBS; type <= FRAMING_SLIP; ++type) {
+        for(size_t i = 0; i < ARRAY_SIZE(sizes); ++i) {
+            framing_test_message_fill(message, sizes[i], i);
+            framing_test_round_trip(test, type, message, sizes[i]);
+
+            // Runs without special bytes, which the word-at-a-time codecs take at once.
+            memset(message, 'a', sizes[i]);
+            framing_test_round_trip(test, type, message, sizes[i]);
+
+            memset(message, 0, sizes[i]);
+            framing_test_round_trip(test, type, message, sizes[i]);
+
+            memset(message, SLIP_END, sizes[i]);
+            framing_test_round_trip(test, type, message, sizes[i]);
+        }
+    }
+}
+
+/**
+ * @brief Frames, which are split between the calls of the decoder at any byte, are decoded the same.
+ */
+static void framing_split_test(struct kunit * test) {
+    const size_t sizes[] = { 300, 1, 40 };
+    u8 * message = kunit_kmalloc(test, FRAMING_TEST_MESSAGE_SIZE_MAX, GFP_KERNEL);
+    u8 * stream = kunit_kmalloc(test, 4 * FRAMING_TEST_MESSAGE_SIZE_MAX, GFP_KERNEL);
+    struct framing_test_messages * messages = kunit_kmalloc(test, sizeof(*messages), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_NULL(test, message);
+    KUNIT_ASSERT_NOT_NULL(test, stream);
+    KUNIT_ASSERT_NOT_NULL(test, messages);
+
+    for(enum framing_type type = FRAMING_COBS; type <= FRAMING_SLIP; ++type) {
+        size_t stream_size = 0;
+
+        for(size_t i = 0; i < ARRAY_SIZE(sizes); ++i) {
+            framing_test_message_fill(message, sizes[i], i);
+            stream_size += framing_encode(type, message, sizes[i], stream + stream_size);
+        }
+
+        for(size_t step = 1; step <= 9; ++step) {
+            struct framing_decoder * decoder = framing_test_decoder(test, type);
+
+            memset(messages, 0, sizeof(*messages));
+
+            for(size_t offset = 0; offset < stream_size; offset += step) {
+                KUNIT_EXPECT_EQ(test, framing_decode(decoder, stream + offset,
+                    min(step, stream_size - offset), framing_test_on_message, messages), 0
+                );
+            }
+
+            KUNIT_ASSERT_EQ(test, messages->m_count, ARRAY_SIZE(sizes));
+
+            for(size_t i = 0; i < ARRAY_SIZE(sizes); ++i) {
+                framing_test_message_fill(message, sizes[i], i);
+                KUNIT_ASSERT_EQ(test, messages->m_sizes[i], sizes[i]);
+                KUNIT_EXPECT_MEMEQ(test, messages->m_data[i], message, sizes[i]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Malformed and too long frames are dropped at their delimiters, the next frame is decoded.
+ */
+static void framing_bad_frame_test(struct kunit * test) {
+    static const u8 message[] = { 'O', 'K' };
+    // COBS block, which is truncated by the delimiter, and SLIP escape of an ordinary byte.
+    static const u8 cobs_bad[] = { 0x05, 'a', 'b', 0x00 };
+    static const u8 slip_bad[] = { SLIP_END, 'a', SLIP_ESC, 'b', SLIP_END };
+    u8 * frame = kunit_kmalloc(test, framing_encoded_size_max(FRAMING_SLIP, FRAMING_TEST_MESSAGE_SIZE_MAX + 1),
+        GFP_KERNEL
+    );
+    u8 * long_message = kunit_kmalloc(test, FRAMING_TEST_MESSAGE_SIZE_MAX + 1, GFP_KERNEL);
+    struct framing_test_messages * messages = kunit_kzalloc(test, sizeof(*messages), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_NULL(test, frame);
+    KUNIT_ASSERT_NOT_NULL(test, long_message);
+    KUNIT_ASSERT_NOT_NULL(test, messages);
+    memset(long_message, 'x', FRAMING_TEST_MESSAGE_SIZE_MAX + 1);
+
+    for(enum framing_type type = FRAMING_COBS; type <= FRAMING_SLIP; ++type) {
+        struct framing_decoder * decoder = framing_test_decoder(test, type);
+        const u8 * bad = type == FRAMING_COBS ? cobs_bad : slip_bad;
+        const size_t bad_size = type == FRAMING_COBS ? sizeof(cobs_bad) : sizeof(slip_bad);
+
+        memset(messages, 0, sizeof(*messages));
+
+        KUNIT_EXPECT_EQ(test, framing_decode(decoder, bad, bad_size, framing_test_on_message, messages), 1);
+
+        size_t frame_size = framing_encode(type, long_message, FRAMING_TEST_MESSAGE_SIZE_MAX + 1, frame);
+        KUNIT_EXPECT_EQ(test, framing_decode(decoder, frame, frame_size, framing_test_on_message, messages), 1);
+
+        frame_size = framing_encode(type, message, sizeof(message), frame);
+        KUNIT_EXPECT_EQ(test, framing_decode(decoder, frame, frame_size, framing_test_on_message, messages), 0);
+
+        KUNIT_ASSERT_EQ(test, messages->m_count, 1);
+        KUNIT_ASSERT_EQ(test, messages->m_sizes[0], sizeof(message));
+        KUNIT_EXPECT_MEMEQ(test, messages->m_data[0], message, sizeof(message));
+    }
+}
+
+/**
+ * @brief Word-at-a-time decoders agree with the scalar ones on random bytes, i.e. on garbage,
+ * which is mostly bad frames.
+ */
+static void framing_garbage_test(struct kunit * test) {
+    const size_t size = 16 * 1024;
+    u8 * data = kunit_kmalloc(test, size, GFP_KERNEL);
+    struct framing_test_messages * messages = kunit_kzalloc(test, sizeof(*messages), GFP_KERNEL);
+    struct framing_test_messages * scalar_messages = kunit_kzalloc(test, sizeof(*messages), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_NULL(test, data);
+    KUNIT_ASSERT_NOT_NULL(test, messages);
+    KUNIT_ASSERT_NOT_NULL(test, scalar_messages);
+
+    for(enum framing_type type = FRAMING_COBS; type <= FRAMING_SLIP; ++type) {
+        struct framing_decoder * decoder = framing_test_decoder(test, type);
+        struct framing_decoder * scalar_decoder = framing_test_decoder(test, type);
+
+        get_random_bytes(data, size);
+        memset(messages, 0, sizeof(*messages));
+        memset(scalar_messages, 0, sizeof(*scalar_messages));
+
+        const unsigned int bad_frames = framing_decode(decoder, data, size, framing_test_on_message, messages);
+        const unsigned int scalar_bad_frames = framing_decode_scalar(scalar_decoder, data, size,
+            framing_test_on_message, scalar_messages
+        );
+
+        KUNIT_EXPECT_EQ(test, bad_frames, scalar_bad_frames);
+        KUNIT_ASSERT_EQ(test, messages->m_count, scalar_messages->m_count);
+
+        for(unsigned int i = 0; i < min_t(unsigned int, messages->m_count, FRAMING_TEST_MESSAGE_COUNT); ++i) {
+            KUNIT_ASSERT_EQ(test, messages->m_sizes[i], scalar_messages->m_sizes[i]);
+            KUNIT_EXPECT_MEMEQ(test, messages->m_data[i], scalar_messages->m_data[i], messages->m_sizes[i]);
+        }
+    }
+}
+
+/**
+ * @brief CRCs match the check values of their catalogues and are appended in little endian.
+ */
+static void framing_crc_test(struct kunit * test) {
+    static const u8 crc32c_check[] = { 0x83, 0x92, 0x06, 0xE3 };
+    static const u8 crc16_check[] = { 0xDB, 0xD0 };
+    u8 message[9 + FRAMING_CRC_SIZE_MAX];
+
+    memcpy(message, "123456789", 9);
+    KUNIT_ASSERT_EQ(test, framing_crc_append(FRAMING_CRC_CRC32C, message, 9), 13);
+    KUNIT_EXPECT_MEMEQ(test, message + 9, crc32c_check, sizeof(crc32c_check));
+    KUNIT_EXPECT_EQ(test, framing_crc_verify(FRAMING_CRC_CRC32C, message, 13), 9);
+
+    message[4] ^= 0x10;
+    KUNIT_EXPECT_EQ(test, framing_crc_verify(FRAMING_CRC_CRC32C, message, 13), -EBADMSG);
+    message[4] ^= 0x10;
+
+    KUNIT_ASSERT_EQ(test, framing_crc_append(FRAMING_CRC_CRC16, message, 9), 11);
+    KUNIT_EXPECT_MEMEQ(test, message + 9, crc16_check, sizeof(crc16_check));
+    KUNIT_EXPECT_EQ(test, framing_crc_verify(FRAMING_CRC_CRC16, message, 11), 9);
+
+    // Message, which is shorter than its CRC, is bad, while the CRC of nothing is a valid empty message.
+    KUNIT_EXPECT_EQ(test, framing_crc_verify(FRAMING_CRC_CRC32C, message, 3), -EBADMSG);
+    KUNIT_ASSERT_EQ(test, framing_crc_append(FRAMING_CRC_CRC32C, message, 0), 4);
+    KUNIT_EXPECT_EQ(test, framing_crc_verify(FRAMING_CRC_CRC32C, message, 4), 0);
+
+    KUNIT_EXPECT_EQ(test, framing_crc_append(FRAMING_CRC_NONE, message, 9), 9);
+    KUNIT_EXPECT_EQ(test, framing_crc_verify(FRAMING_CRC_NONE, message, 9), 9);
+}
+
+static struct kunit_case g_framing_test_cases[] = {
+    KUNIT_CASE(framing_round_trip_test),
+    KUNIT_CASE(framing_split_test),
+    KUNIT_CASE(framing_bad_frame_test),
+    KUNIT_CASE(framing_garbage_test),
+    KUNIT_CASE(framing_crc_test),
+    {}
+};
+
+static struct kunit_suite g_framing_test_suite = {
+    .name = "ftdi_framing",
+    .test_cases = g_framing_test_cases,
+};
+
+kunit_test_suite(g_framing_test_suite);
@@ -0,0 +1,1149 @@
+/**
+ * @brief File contains the KUnit suite of the data path, i.e. of `read()`, `write()` and the URB
+ * completion handlers, which is built into the module by `make kunit` and runs, once the module
+ * is loaded. File takes the place of `usb_core.c` in that build, i.e. it's the mock of the USB core,
+ * which the devices of the suite talk to instead of a host controller: bulk OUT URBs are completed
+ * by a work, as if the device has taken all their data, while bulk IN URBs wait for the test to
+ * complete them with the packets of its choice. Thus the hot path runs without any device and its
+ * per-call cost and allocations are measured under concurrency. Adapters, which are plugged in,
+ * aren't driven by the KUnit build of the module.
+ */
+
+#include "../src/device_data.h"
+#include "../src/device_file_operations.h"
+#include "../src/device_ioctl.h"
+#include "../src/ftdi_protocol.h"
+#include "../src/ftdi_usb_driver.h"
+#include "../src/usb_core.h"
+
+#include <kunit/test.h>
+#include <linux/delay.h>
+#include <linux/fs.h>
+#include <linux/kthread.h>
+#include <linux/module.h>
+#include <linux/scatterlist.h>
+#include <linux/uio.h>
+#include <linux/usb/hcd.h>
+#include <linux/workqueue.h>
+#include <linux/xarray.h>
+#include <trace/events/kmem.h>
+
+/**
+ * Max packet size of the bulk endpoints of the mock device, the same as of FT232R.
+ */
+#define MOCK_MAX_PACKET_SIZE 64
+
+/**
+ * Number of bytes of the bulk OUT URBs, which the mock keeps for the test to look at.
+ */
+#define MOCK_TX_CAPTURE_SIZE (64 * 1024)
+
+/**
+ * Maximum time to wait for the driver to do what the test expects from it.
+ */
+#define MOCK_WAIT_TIMEOUT (5 * HZ)
+
+/**
+ * Size of the read, which is large enough to be filled directly, the same as `RX_DIRECT_READ_MIN`
+ * of `device_file_operations.c`, and the size of the read, that always goes through the RX ring.
+ */
+#define MOCK_DIRECT_READ_SIZE 4096
+#define MOCK_RING_READ_SIZE 1000
+
+/**
+ * Mock of the USB core along with the device, which has been allocated for it.
+ */
+struct usb_core_mock {
+    struct device_data * m_device_data;
+
+    /** Host controller, which neither uses DMA nor has constraints on the scatter-gather lists. */
+    struct usb_hcd * m_hcd;
+    struct hc_driver m_hc_driver;
+
+    /** USB device and its interface, which the device data holds references to. */
+    struct usb_device m_usb_device;
+    struct usb_interface m_interface;
+    struct usb_endpoint_descriptor m_bulk_in;
+    struct usb_endpoint_descriptor m_bulk_out;
+
+    /** Protects the submitted URBs. */
+    spinlock_t m_lock;
+
+    /**
+     * Bulk IN URBs, which wait for the test to complete them, the oldest one first. FIFO fits
+     * all the bulk IN URBs of the device.
+     */
+    struct urb ** m_rx_urbs;
+    unsigned int m_rx_urb_capacity;
+    unsigned int m_rx_urb_first;
+    unsigned int m_rx_urb_count;
+
+    /** Number of times the halt of the bulk IN endpoint has been cleared. */
+    atomic_t m_rx_halts_cleared;
+
+    /** Bulk OUT URB, which waits for `m_tx_work` to complete it. */
+    struct urb * m_tx_urb;
+    struct work_struct m_tx_work;
+
+    /**
+     * Data of the completed bulk OUT URBs (the first `MOCK_TX_CAPTURE_SIZE` bytes of it),
+     * its total size and the number of URBs. Test waits for it on `m_tx_wait`.
+     */
+    u8 * m_tx_data;
+    size_t m_tx_length;
+    unsigned int m_tx_urbs;
+    wait_queue_head_t m_tx_wait;
+
+    /**
+     * Number of bulk OUT URBs, which haven't ended on the packet boundary, though they have been
+     * followed by another URB, i.e. the device has got a short packet in the middle of the data.
+     */
+    unsigned int m_tx_unaligned_urbs;
+    bool m_tx_is_unaligned;
+
+    /** Whether the data is checked against `mock_pattern()`, and the number of wrong bytes. */
+    bool m_tx_is_pattern;
+    size_t m_tx_pattern_mismatches;
+
+    /** Runtime PM references, which the device holds. */
+    atomic_t m_pm_usage;
+};
+
+/**
+ * @brief Returns the byte of the test data at the given offset of the stream.
+ */
+static u8 mock_pattern(size_t offset) {
+    return (offset * 7) ^ (offset >> 8);
+}
+
+/**
+ * @brief Fills the buffer with the test data, which starts at the given offset of the stream.
+ */
+static void mock_pattern_fill(u8 * buffer, size_t offset, size_t num_bytes) {
+    for(size_t i = 0; i < num_bytes; ++i) {
+        buffer[i] = mock_pattern(offset + i);
+    }
+}
+
+/**
+ * @brief Returns the number of bytes of the buffer, which differ from the test data at the given
+ * offset of the stream.
+ */
+static size_t mock_pattern_mismatches(const u8 * buffer, size_t offset, size_t num_bytes) {
+    size_t mismatches = 0;
+
+    for(size_t i = 0; i < num_bytes; ++i) {
+        mismatches += buffer[i] != mock_pattern(offset + i);
+    }
+
+    return mismatches;
+}
+
+// ----------------------
+// Mock of the USB core.
+// ----------------------
+
+/**
+ * Mocks of the devices of the suite indexed by the minor numbers of the devices.
+ */
+static DEFINE_XARRAY(g_usb_core_mocks);
+
+/**
+ * @brief Returns the mock, which the device talks to, `NULL` if the device isn't one of the suite.
+ */
+static struct usb_core_mock * usb_core_mock_find(struct device_data * device_data) {
+    struct usb_core_mock * mock = xa_load(&g_usb_core_mocks, device_data->m_minor);
+
+    return mock && mock->m_device_data == device_data ? mock : NULL;
+}
+
+/**
+ * @brief Completes the URB the way the host controller driver does, i.e. in the interrupt context.
+ */
+static void usb_core_mock_complete(struct urb * urb, int status, unsigned int actual_length) {
+    unsigned long flags;
+
+    usb_unanchor_urb(urb);
+    urb->status = status;
+    urb->actual_length = actual_length;
+
+    local_irq_save(flags);
+    urb->complete(urb);
+    local_irq_restore(flags);
+}
+
+/**
+ * @brief Takes the oldest bulk IN URB, which has been submitted.
+ *
+ * @return URB, `NULL` if no bulk IN URB is submitted.
+ */
+static struct urb * usb_core_mock_rx_take(struct usb_core_mock * mock) {
+    struct urb * urb = NULL;
+    unsigned long flags;
+
+    spin_lock_irqsave(&(mock->m_lock), flags);
+
+    if(mock->m_rx_urb_count) {
+        urb = mock->m_rx_urbs[mock->m_rx_urb_first];
+        mock->m_rx_urb_first = (mock->m_rx_urb_first + 1) % mock->m_rx_urb_capacity;
+        --(mock->m_rx_urb_count);
+    }
+
+    spin_unlock_irqrestore(&(mock->m_lock), flags);
+
+    return urb;
+}
+
+/**
+ * @brief Completes the oldest bulk IN URB with the received data, which is split into the packets
+ * of the device, each of them starts with the status header. Data, which doesn't fit into the URB,
+ * is left for the next one. URB of no data carries the status header alone.
+ *
+ * @return Number of bytes of the data, which the URB has taken, `-ENOENT` if no bulk IN URB is submitted.
+ */
+static long usb_core_mock_rx(struct usb_core_mock * mock, const u8 * data, size_t num_bytes) {
+    const unsigned int payload_max = MOCK_MAX_PACKET_SIZE - FTDI_STATUS_HEADER_SIZE;
+    struct urb * urb = usb_core_mock_rx_take(mock);
+    unsigned int length = 0;
+    size_t taken = 0;
+
+    if(!urb) {
+        return -ENOENT;
+    }
+
+    u8 * buffer = urb->transfer_buffer;
+
+    do {
+        const size_t payload = min_t(size_t, num_bytes - taken, payload_max);
+
+        buffer[length] = 0x01;
+        buffer[length + 1] = FTDI_LINE_STATUS_THRE | FTDI_LINE_STATUS_TEMT;
+        memcpy(buffer + length + FTDI_STATUS_HEADER_SIZE, data + taken, payload);
+
+        length += FTDI_STATUS_HEADER_SIZE + payload;
+        taken += payload;
+    } while(taken < num_bytes && length + MOCK_MAX_PACKET_SIZE <= urb->transfer_buffer_length);
+
+    usb_core_mock_complete(urb, 0, length);
+    return taken;
+}
+
+/**
+ * @brief Completes the oldest bulk IN URB with the error.
+ *
+ * @return 0 on success, `-ENOENT` if no bulk IN URB is submitted.
+ */
+static int usb_core_mock_rx_fail(struct usb_core_mock * mock, int status) {
+    struct urb * urb = usb_core_mock_rx_take(mock);
+
+    if(!urb) {
+        return -ENOENT;
+    }
+
+    usb_core_mock_complete(urb, status, 0);
+    return 0;
+}
+
+/**
+ * @brief Completes as many bulk IN URBs as the data takes.
+ *
+ * @return Number of bytes of the data, which has been received.
+ */
+static size_t usb_core_mock_rx_all(struct usb_core_mock * mock, const u8 * data, size_t num_bytes) {
+    size_t taken = 0;
+
+    while(taken < num_bytes) {
+        const long status = usb_core_mock_rx(mock, data + taken, num_bytes - taken);
+
+        if(status < 0) {
+            break;
+        }
+
+        taken += status;
+    }
+
+    return taken;
+}
+
+/**
+ * @brief Appends the data of the bulk OUT URB to the captured data.
+ */
+static void usb_core_mock_tx_append(struct usb_core_mock * mock, const u8 * data, unsigned int num_bytes) {
+    const size_t length = mock->m_tx_length;
+
+    if(length < MOCK_TX_CAPTURE_SIZE) {
+        memcpy(mock->m_tx_data + length, data, min_t(size_t, num_bytes, MOCK_TX_CAPTURE_SIZE - length));
+    }
+
+    if(mock->m_tx_is_pattern) {
+        mock->m_tx_pattern_mismatches += mock_pattern_mismatches(data, length, num_bytes);
+    }
+
+    WRITE_ONCE(mock->m_tx_length, length + num_bytes);
+}
+
+/**
+ * @brief Takes the data of the bulk OUT URB, which is sent either from its buffer or from its
+ * scatter-gather list, and completes the URB.
+ */
+static void usb_core_mock_tx_work(struct work_struct * work) {
+    struct usb_core_mock * mock = container_of(work, struct usb_core_mock, m_tx_work);
+    unsigned long flags;
+
+    spin_lock_irqsave(&(mock->m_lock), flags);
+    struct urb * urb = mock->m_tx_urb;
+    mock->m_tx_urb = NULL;
+    spin_unlock_irqrestore(&(mock->m_lock), flags);
+
+    if(!urb) {
+        return;
+    }
+
+    const unsigned int length = urb->transfer_buffer_length;
+
+    if(urb->num_sgs) {
+        struct scatterlist * sg = NULL;
+        unsigned int copied = 0;
+        int i;
+
+        for_each_sg(urb->sg, sg, urb->num_sgs, i) {
+            const unsigned int part = min(sg->length, length - copied);
+
+            usb_core_mock_tx_append(mock, sg_virt(sg), part);
+            copied += part;
+        }
+    } else {
+        usb_core_mock_tx_append(mock, urb->transfer_buffer, length);
+    }
+
+    mock->m_tx_unaligned_urbs += mock->m_tx_is_unaligned;
+    mock->m_tx_is_unaligned = length % MOCK_MAX_PACKET_SIZE != 0;
+    WRITE_ONCE(mock->m_tx_urbs, mock->m_tx_urbs + 1);
+
+    usb_core_mock_complete(urb, 0, length);
+    wake_up(&(mock->m_tx_wait));
+}
+
+int usb_core_submit_urb(struct device_data * device_data, struct urb * urb, gfp_t mem_flags) {
+    struct usb_core_mock * mock = usb_core_mock_find(device_data);
+    unsigned long flags;
+    int status = 0;
+
+    if(!mock) {
+        return -ENODEV;
+    }
+
+    spin_lock_irqsave(&(mock->m_lock), flags);
+
+    if(usb_pipein(urb->pipe)) {
+        if(mock->m_rx_urb_count == mock->m_rx_urb_capacity) {
+            status = -EBUSY;
+        } else {
+            mock->m_rx_urbs[(mock->m_rx_urb_first + mock->m_rx_urb_count) % mock->m_rx_urb_capacity] = urb;
+            ++(mock->m_rx_urb_count);
+        }
+    } else if(mock->m_tx_urb) {
+        // Driver has a single bulk OUT URB, thus it's never submitted twice.
+        status = -EBUSY;
+    } else {
+        mock->m_tx_urb = urb;
+        queue_work(system_wq, &(mock->m_tx_work));
+    }
+
+    spin_unlock_irqrestore(&(mock->m_lock), flags);
+
+    return status;
+}
+
+void usb_core_kill_urbs(struct device_data * device_data, struct usb_anchor * anchor) {
+    struct usb_core_mock * mock = usb_core_mock_find(device_data);
+    struct urb * urb = NULL;
+    unsigned long flags;
+
+    if(!mock) {
+        usb_kill_anchored_urbs(anchor);
+        return;
+    }
+
+    if(anchor == &(device_data->m_rx_anchor)) {
+        while((urb = usb_core_mock_rx_take(mock))) {
+            usb_core_mock_complete(urb, -ENOENT, 0);
+        }
+
+        return;
+    }
+
+    // Bulk OUT URB, which the work hasn't taken yet, is killed before the device gets its data.
+    cancel_work_sync(&(mock->m_tx_work));
+
+    spin_lock_irqsave(&(mock->m_lock), flags);
+    urb = mock->m_tx_urb;
+    mock->m_tx_urb = NULL;
+    spin_unlock_irqrestore(&(mock->m_lock), flags);
+
+    if(urb) {
+        usb_core_mock_complete(urb, -ENOENT, 0);
+    }
+}
+
+int usb_core_clear_halt(struct device_data * device_data, unsigned int pipe) {
+    struct usb_core_mock * mock = usb_core_mock_find(device_data);
+
+    if(!mock) {
+        return -ENODEV;
+    }
+
+    atomic_inc(&(mock->m_rx_halts_cleared));
+    return 0;
+}
+
+int usb_core_autopm_get(struct device_data * device_data) {
+    struct usb_core_mock * mock = usb_core_mock_find(device_data);
+
+    if(!mock) {
+        return -ENODEV;
+    }
+
+    atomic_inc(&(mock->m_pm_usage));
+    return 0;
+}
+
+void usb_core_autopm_put(struct device_data * device_data) {
+    struct usb_core_mock * mock = usb_core_mock_find(device_data);
+
+    if(mock) {
+        atomic_dec(&(mock->m_pm_usage));
+    }
+}
+
+/**
+ * @brief Called, once the last reference to the mock USB device or interface is dropped.
+ * Their memory belongs to the test.
+ */
+static void usb_core_mock_device_release(struct device * device) {
+}
+
+/**
+ * @brief Fills the descriptor of the bulk endpoint of the mock device.
+ */
+static void usb_core_mock_endpoint_init(struct usb_endpoint_descriptor * endpoint, u8 address) {
+    *endpoint = (struct usb_endpoint_descriptor) {
+        .bLength = USB_DT_ENDPOINT_SIZE,
+        .bDescriptorType = USB_DT_ENDPOINT,
+        .bEndpointAddress = address,
+        .bmAttributes = USB_ENDPOINT_XFER_BULK,
+        .wMaxPacketSize = cpu_to_le16(MOCK_MAX_PACKET_SIZE)
+    };
+}
+
+/**
+ * @brief Removes the device, once all its files have been closed.
+ */
+static void usb_core_mock_destroy(void * data) {
+    struct usb_core_mock * mock = data;
+
+    xa_erase(&g_devices, mock->m_device_data->m_minor);
+    xa_erase(&g_usb_core_mocks, mock->m_device_data->m_minor);
+    cancel_work_sync(&(mock->m_tx_work));
+    device_data_put(mock->m_device_data);
+    put_device(&(mock->m_interface.dev));
+    put_device(&(mock->m_usb_device.dev));
+}
+
+/**
+ * @brief Creates the device, which talks to the mock, and registers it under a free minor number,
+ * so that its file could be opened. Device is removed at the end of the test.
+ */
+static struct usb_core_mock * usb_core_mock_create(struct kunit * test, enum framing_type framing,
+    enum framing_crc crc
+) {
+    struct usb_core_mock * mock = kunit_kzalloc(test, sizeof(struct usb_core_mock), GFP_KERNEL);
+    KUNIT_ASSERT_NOT_NULL(test, mock);
+
+    mock->m_hcd = kunit_kzalloc(test, sizeof(struct usb_hcd), GFP_KERNEL);
+    mock->m_tx_data = kunit_kzalloc(test, MOCK_TX_CAPTURE_SIZE, GFP_KERNEL);
+    KUNIT_ASSERT_NOT_NULL(test, mock->m_hcd);
+    KUNIT_ASSERT_NOT_NULL(test, mock->m_tx_data);
+
+    spin_lock_init(&(mock->m_lock));
+    INIT_WORK(&(mock->m_tx_work), usb_core_mock_tx_work);
+    init_waitqueue_head(&(mock->m_tx_wait));
+    atomic_set(&(mock->m_pm_usage), 0);
+    atomic_set(&(mock->m_rx_halts_cleared), 0);
+
+    mock->m_hcd->driver = &(mock->m_hc_driver);
+    mock->m_hcd->self.sg_tablesize = ARRAY_SIZE(((struct device_data *) NULL)->m_tx_sg);
+    mock->m_hcd->self.no_sg_constraint = 1;
+
+    struct usb_device * usb_device = &(mock->m_usb_device);
+    device_initialize(&(usb_device->dev));
+    usb_device->dev.release = usb_core_mock_device_release;
+    usb_device->bus = &(mock->m_hcd->self);
+    usb_device->devnum = 1;
+
+    struct usb_interface * interface = &(mock->m_interface);
+    device_initialize(&(interface->dev));
+    interface->dev.release = usb_core_mock_device_release;
+    interface->dev.parent = &(usb_device->dev);
+
+    usb_core_mock_endpoint_init(&(mock->m_bulk_in), USB_DIR_IN | 1);
+    usb_core_mock_endpoint_init(&(mock->m_bulk_out), USB_DIR_OUT | 2);
+
+    struct device_data * device_data = device_data_allocate(interface, &(mock->m_bulk_in), &(mock->m_bulk_out));
+    u32 minor = 0;
+
+    if(device_data) {
+        device_data->m_chip_type = FTDI_CHIP_FT232R;
+        device_data->m_channel = 1;
+        device_data->m_framing = framing;
+        device_data->m_framing_crc = crc;
+
+        if(xa_alloc(&g_devices, &minor, device_data, XA_LIMIT(0, DEVICE_MINOR_COUNT - 1), GFP_KERNEL)) {
+            device_data_put(device_data);
+            device_data = NULL;
+        }
+    }
+
+    if(!device_data) {
+        put_device(&(interface->dev));
+        put_device(&(usb_device->dev));
+    }
+
+    KUNIT_ASSERT_NOT_NULL(test, device_data);
+
+    device_data->m_minor = minor;
+    mock->m_device_data = device_data;
+    mock->m_rx_urb_capacity = device_data->m_rx_urb_count;
+    mock->m_rx_urbs = kunit_kcalloc(test, mock->m_rx_urb_capacity, sizeof(struct urb *), GFP_KERNEL);
+
+    // Device talks to the mock, once it's found under the minor number of the device.
+    const int status = mock->m_rx_urbs ? xa_err(xa_store(&g_usb_core_mocks, minor, mock, GFP_KERNEL)) : -ENOMEM;
+
+    if(status) {
+        xa_erase(&g_devices, minor);
+        device_data_put(device_data);
+        put_device(&(interface->dev));
+        put_device(&(usb_device->dev));
+    }
+
+    KUNIT_ASSERT_EQ(test, status, 0);
+    KUNIT_ASSERT_EQ(test, kunit_add_action_or_reset(test, usb_core_mock_destroy, mock), 0);
+    return mock;
+}
+
+// ----------------------------------------
+// Files of the devices, that talk to mocks.
+// ----------------------------------------
+
+static void mock_file_release(void * data) {
+    struct file * file = data;
+
+    get_file_operations()->release(file_inode(file), file);
+}
+
+/**
+ * @brief Opens the file of the device, the file is closed at the end of the test.
+ */
+static struct file * mock_file_open(struct kunit * test, struct usb_core_mock * mock, unsigned int flags) {
+    struct inode * inode = kunit_kzalloc(test, sizeof(struct inode), GFP_KERNEL);
+    struct file * file = kunit_kzalloc(test, sizeof(struct file), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_NULL(test, inode);
+    KUNIT_ASSERT_NOT_NULL(test, file);
+
+    inode->i_rdev = MKDEV(MAJOR(g_device_number_base), mock->m_device_data->m_minor);
+    file->f_inode = inode;
+    file->f_flags = flags;
+
+    KUNIT_ASSERT_EQ(test, get_file_operations()->open(inode, file), 0);
+    KUNIT_ASSERT_EQ(test, kunit_add_action_or_reset(test, mock_file_release, file), 0);
+    return file;
+}
+
+/**
+ * @brief Reads from the file into the kernel buffer, the same way as `kernel_read()` does.
+ */
+static ssize_t mock_file_read(struct file * file, void * buffer, size_t num_bytes) {
+    struct kvec kvec = { .iov_base = buffer, .iov_len = num_bytes };
+    struct iov_iter iter;
+    struct kiocb kiocb;
+
+    init_sync_kiocb(&kiocb, file);
+    iov_iter_kvec(&iter, ITER_DEST, &kvec, 1, num_bytes);
+    return get_file_operations()->read_iter(&kiocb, &iter);
+}
+
+/**
+ * @brief Writes the kernel buffer into the file, the same way as `kernel_write()` does.
+ */
+static ssize_t mock_file_write(struct file * file, const void * buffer, size_t num_bytes) {
+    struct kvec kvec = { .iov_base = (void *) buffer, .iov_len = num_bytes };
+    struct iov_iter iter;
+    struct kiocb kiocb;
+
+    init_sync_kiocb(&kiocb, file);
+    iov_iter_kvec(&iter, ITER_SOURCE, &kvec, 1, num_bytes);
+    return get_file_operations()->write_iter(&kiocb, &iter);
+}
+
+// -------------------------------------
+// Allocations, that the module makes.
+// -------------------------------------
+
+/**
+ * Number of allocations, which have been made by the code of this module, and whether they are
+ * counted at all, i.e. whether the probes of the tracepoints of the allocator have been registered.
+ */
+static atomic_long_t g_mock_allocations = ATOMIC_LONG_INIT(0);
+static bool g_mock_allocations_are_counted = false;
+
+static void mock_count_kmalloc(void * data, unsigned long call_site, const void * ptr, size_t bytes_req,
+    size_t bytes_alloc, gfp_t gfp_flags, int node
+) {
+    if(within_module(call_site, THIS_MODULE)) {
+        atomic_long_inc(&g_mock_allocations);
+    }
+}
+
+static void mock_count_kmem_cache_alloc(void * data, unsigned long call_site, const void * ptr,
+    struct kmem_cache * cache, gfp_t gfp_flags, int node
+) {
+    if(within_module(call_site, THIS_MODULE)) {
+        atomic_long_inc(&g_mock_allocations);
+    }
+}
+
+static int ftdi_usb_driver_test_suite_init(struct kunit_suite * suite) {
+    if(register_trace_kmalloc(mock_count_kmalloc, NULL)) {
+        return 0;
+    }
+
+    if(register_trace_kmem_cache_alloc(mock_count_kmem_cache_alloc, NULL)) {
+        unregister_trace_kmalloc(mock_count_kmalloc, NULL);
+        tracepoint_synchronize_unregister();
+        return 0;
+    }
+
+    g_mock_allocations_are_counted = true;
+    return 0;
+}
+
+static void ftdi_usb_driver_test_suite_exit(struct kunit_suite * suite) {
+    if(g_mock_allocations_are_counted) {
+        unregister_trace_kmem_cache_alloc(mock_count_kmem_cache_alloc, NULL);
+        unregister_trace_kmalloc(mock_count_kmalloc, NULL);
+        tracepoint_synchronize_unregister();
+        g_mock_allocations_are_counted = false;
+    }
+}
+
+// -----------
+// Test cases.
+// -----------
+
+/**
+ * @brief Received packets are stripped of their status headers, the status alone wakes up nobody.
+ */
+static void rx_read_test(struct kunit * test) {
+    struct usb_core_mock * mock = usb_core_mock_create(test, FRAMING_NONE, FRAMING_CRC_NONE);
+    struct file * file = mock_file_open(test, mock, O_NONBLOCK);
+    const size_t size = 1000;
+    u8 * data = kunit_kmalloc(test, size, GFP_KERNEL);
+    u8 * buffer = kunit_kzalloc(test, size, GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_NULL(test, data);
+    KUNIT_ASSERT_NOT_NULL(test, buffer);
+    mock_pattern_fill(data, 0, size);
+
+    // Opened device is kept resumed.
+    KUNIT_EXPECT_EQ(test, atomic_read(&(mock->m_pm_usage)), 1);
+
+    KUNIT_EXPECT_EQ(test, mock_file_read(file, buffer, size), -EAGAIN);
+    KUNIT_EXPECT_EQ(test, usb_core_mock_rx(mock, NULL, 0), 0);
+    KUNIT_EXPECT_EQ(test, mock_file_read(file, buffer, size), -EAGAIN);
+    KUNIT_EXPECT_EQ(test, READ_ONCE(mock->m_device_data->m_line_status),
+        FTDI_LINE_STATUS_THRE | FTDI_LINE_STATUS_TEMT
+    );
+
+    KUNIT_ASSERT_EQ(test, usb_core_mock_rx_all(mock, data, size), size);
+
+    // Reads, which are shorter than a packet, take the data in order.
+    for(size_t total = 0; total < size;) {
+        const ssize_t status = mock_file_read(file, buffer + total, min_t(size_t, size - total, 100));
+
+        KUNIT_ASSERT_GT(test, status, 0);
+        total += status;
+    }
+
+    KUNIT_EXPECT_MEMEQ(test, buffer, data, size);
+    KUNIT_EXPECT_EQ(test, mock_file_read(file, buffer, size), -EAGAIN);
+}
+
+/**
+ * @brief Bulk IN URBs, which fail with a transient error of the bus or with the stall, are resubmitted,
+ * the ones of the disconnected device aren't.
+ */
+static void rx_error_test(struct kunit * test) {
+    struct usb_core_mock * mock = usb_core_mock_create(test, FRAMING_NONE, FRAMING_CRC_NONE);
+    struct file * file = mock_file_open(test, mock, O_NONBLOCK);
+    const unsigned int urb_count = mock->m_device_data->m_rx_urb_count;
+    u8 data[100];
+    u8 buffer[100];
+
+    mock_pattern_fill(data, 0, sizeof(data));
+
+    KUNIT_EXPECT_EQ(test, usb_core_mock_rx_fail(mock, -EPROTO), 0);
+    KUNIT_EXPECT_EQ(test, usb_core_mock_rx_fail(mock, -EOVERFLOW), 0);
+    KUNIT_EXPECT_EQ(test, READ_ONCE(mock->m_rx_urb_count), urb_count);
+
+    // Stalled URB is resubmitted, once the work has cleared the halt.
+    KUNIT_EXPECT_EQ(test, usb_core_mock_rx_fail(mock, -EPIPE), 0);
+    flush_work(&(mock->m_device_data->m_rx_halt_work));
+    KUNIT_EXPECT_EQ(test, atomic_read(&(mock->m_rx_halts_cleared)), 1);
+    KUNIT_EXPECT_EQ(test, READ_ONCE(mock->m_rx_urb_count), urb_count);
+
+    KUNIT_ASSERT_EQ(test, usb_core_mock_rx_all(mock, data, sizeof(data)), sizeof(data));
+    KUNIT_EXPECT_EQ(test, mock_file_read(file, buffer, sizeof(buffer)), (ssize_t) sizeof(buffer));
+    KUNIT_EXPECT_MEMEQ(test, buffer, data, sizeof(data));
+
+    KUNIT_EXPECT_EQ(test, usb_core_mock_rx_fail(mock, -ENODEV), 0);
+    KUNIT_EXPECT_EQ(test, READ_ONCE(mock->m_rx_urb_count), urb_count - 1);
+}
+
+/**
+ * Reader of the file, which runs in its own thread.
+ */
+struct mock_reader {
+    struct file * m_file;
+    u8 * m_buffer;
+    size_t m_size;
+    ssize_t m_status;
+    struct completion m_done;
+};
+
+static int mock_reader_fn(void * data) {
+    struct mock_reader * reader = data;
+
+    reader->m_status = mock_file_read(reader->m_file, reader->m_buffer, reader->m_size);
+    complete(&(reader->m_done));
+    return 0;
+}
+
+/**
+ * @brief Large blocking read into kernel pages is filled by the bulk IN URB completion handler directly.
+ */
+static void rx_direct_read_test(struct kunit * test) {
+    struct usb_core_mock * mock = usb_core_mock_create(test, FRAMING_NONE, FRAMING_CRC_NONE);
+    struct device_data * device_data = mock->m_device_data;
+    const size_t size = 2 * MOCK_DIRECT_READ_SIZE;
+    u8 * data = kunit_kmalloc(test, size, GFP_KERNEL);
+    struct mock_reader reader = {
+        .m_file = mock_file_open(test, mock, 0),
+        .m_buffer = kunit_kzalloc(test, size, GFP_KERNEL),
+        .m_size = size
+    };
+
+    KUNIT_ASSERT_NOT_NULL(test, data);
+    KUNIT_ASSERT_NOT_NULL(test, reader.m_buffer);
+    mock_pattern_fill(data, 0, size);
+    init_completion(&(reader.m_done));
+
+    struct task_struct * task = kthread_run(mock_reader_fn, &reader, "ftdi_kunit_reader");
+    KUNIT_ASSERT_FALSE(test, IS_ERR(task));
+
+    // Reader has to wait for the data, before it arrives.
+    for(int i = 0; i < 1000 && !READ_ONCE(device_data->m_rx_direct_iter); ++i) {
+        usleep_range(1000, 2000);
+    }
+
+    const bool is_waiting = READ_ONCE(device_data->m_rx_direct_iter) != NULL;
+    const size_t received = usb_core_mock_rx_all(mock, data, size);
+
+    if(!wait_for_completion_timeout(&(reader.m_done), MOCK_WAIT_TIMEOUT)) {
+        // Reader mustn't outlive the file, thus it's woken up as if the device has gone.
+        WRITE_ONCE(device_data->m_is_disconnected, true);
+        wake_up_interruptible(&(device_data->m_rx_wait));
+        wait_for_completion(&(reader.m_done));
+        WRITE_ONCE(device_data->m_is_disconnected, false);
+    }
+
+    KUNIT_EXPECT_TRUE(test, is_waiting);
+    KUNIT_EXPECT_EQ(test, received, size);
+    KUNIT_ASSERT_GT(test, reader.m_status, 0);
+
+    struct hot_path_counters sum;
+    device_stats_sum(&(device_data->m_stats), &sum);
+    KUNIT_EXPECT_EQ(test, sum.m_rx_direct_bytes, (u64) reader.m_status);
+
+    // What hasn't fit into the buffer of the reader is in the RX ring.
+    for(size_t total = reader.m_status; total < size;) {
+        const ssize_t status = mock_file_read(reader.m_file, reader.m_buffer + total,
+            min_t(size_t, size - total, MOCK_RING_READ_SIZE)
+        );
+
+        KUNIT_ASSERT_GT(test, status, 0);
+        total += status;
+    }
+
+    KUNIT_EXPECT_MEMEQ(test, reader.m_buffer, data, size);
+}
+
+/**
+ * @brief Written data is sent by the bulk OUT URBs of full packets, only the last one is short.
+ */
+static void tx_write_test(struct kunit * test) {
+    struct usb_core_mock * mock = usb_core_mock_create(test, FRAMING_NONE, FRAMING_CRC_NONE);
+    struct file * file = mock_file_open(test, mock, 0);
+    const size_t size = 10000;
+    u8 * data = kunit_kmalloc(test, size, GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_NULL(test, data);
+    mock_pattern_fill(data, 0, size);
+
+    KUNIT_EXPECT_EQ(test, mock_file_write(file, data, size), size);
+    KUNIT_ASSERT_GT(test, wait_event_timeout(mock->m_tx_wait, READ_ONCE(mock->m_tx_length) >= size,
+        MOCK_WAIT_TIMEOUT), 0
+    );
+
+    KUNIT_EXPECT_EQ(test, mock->m_tx_length, size);
+    KUNIT_EXPECT_MEMEQ(test, mock->m_tx_data, data, size);
+    KUNIT_EXPECT_EQ(test, mock->m_tx_unaligned_urbs, 0);
+    KUNIT_EXPECT_GE(test, mock->m_tx_urbs, DIV_ROUND_UP(size, mock->m_device_data->m_tx_urb_size));
+}
+
+/**
+ * @brief Data, which wraps around the end of the TX ring, reaches the device in order.
+ */
+static void tx_wrap_test(struct kunit * test) {
+    struct usb_core_mock * mock = usb_core_mock_create(test, FRAMING_NONE, FRAMING_CRC_NONE);
+    struct file * file = mock_file_open(test, mock, 0);
+    const size_t chunk_size = 3000;
+    const size_t size = 3 * mock->m_device_data->m_tx_ring.m_size;
+    u8 * chunk = kunit_kmalloc(test, chunk_size, GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_NULL(test, chunk);
+    mock->m_tx_is_pattern = true;
+
+    for(size_t offset = 0; offset < size; offset += chunk_size) {
+        mock_pattern_fill(chunk, offset, chunk_size);
+        KUNIT_ASSERT_EQ(test, mock_file_write(file, chunk, chunk_size), chunk_size);
+    }
+
+    const size_t written = roundup(size, chunk_size);
+
+    KUNIT_ASSERT_GT(test, wait_event_timeout(mock->m_tx_wait, READ_ONCE(mock->m_tx_length) >= written,
+        MOCK_WAIT_TIMEOUT), 0
+    );
+
+    KUNIT_EXPECT_EQ(test, mock->m_tx_length, written);
+    KUNIT_EXPECT_EQ(test, mock->m_tx_pattern_mismatches, 0);
+}
+
+static int mock_count_wakeup(struct wait_queue_entry * entry, unsigned int mode, int sync, void * key) {
+    atomic_inc((atomic_t *) entry->private);
+    return 0;
+}
+
+/**
+ * @brief Message of the framed device comes back along with its CRC, which is verified and
+ * stripped on receive. Message of the wrong CRC and the empty one are dropped without waking up
+ * the readers.
+ */
+static void framed_crc_test(struct kunit * test) {
+    struct usb_core_mock * mock = usb_core_mock_create(test, FRAMING_COBS, FRAMING_CRC_CRC32C);
+    struct device_data * device_data = mock->m_device_data;
+    struct file * file = mock_file_open(test, mock, O_NONBLOCK);
+    static const u8 message[] = { 'A', 'T', 0x00, 0x01, 0xFF, 0x00, 'O', 'K' };
+    const size_t frame_size_max = framing_encoded_size_max(FRAMING_COBS, sizeof(message) + FRAMING_CRC_SIZE_MAX);
+    u8 crc_message[sizeof(message) + FRAMING_CRC_SIZE_MAX];
+    u8 * frame = kunit_kmalloc(test, frame_size_max, GFP_KERNEL);
+    u8 buffer[64];
+
+    KUNIT_ASSERT_NOT_NULL(test, frame);
+
+    memcpy(crc_message, message, sizeof(message));
+    const size_t crc_message_size = framing_crc_append(FRAMING_CRC_CRC32C, crc_message, sizeof(message));
+    const size_t frame_size = framing_encode(FRAMING_COBS, crc_message, crc_message_size, frame);
+
+    KUNIT_EXPECT_EQ(test, mock_file_write(file, message, sizeof(message)), sizeof(message));
+    KUNIT_ASSERT_GT(test, wait_event_timeout(mock->m_tx_wait, READ_ONCE(mock->m_tx_length) >= frame_size,
+        MOCK_WAIT_TIMEOUT), 0
+    );
+    KUNIT_EXPECT_EQ(test, mock->m_tx_length, frame_size);
+    KUNIT_EXPECT_MEMEQ(test, mock->m_tx_data, frame, frame_size);
+
+    // Frame, which comes back, is a single message, even if it's split between the URBs.
+    KUNIT_ASSERT_EQ(test, usb_core_mock_rx(mock, frame, 3), 3);
+    KUNIT_EXPECT_EQ(test, mock_file_read(file, buffer, sizeof(buffer)), -EAGAIN);
+    KUNIT_ASSERT_EQ(test, usb_core_mock_rx_all(mock, frame + 3, frame_size - 3), frame_size - 3);
+    KUNIT_EXPECT_EQ(test, mock_file_read(file, buffer, sizeof(buffer)), sizeof(message));
+    KUNIT_EXPECT_MEMEQ(test, buffer, message, sizeof(message));
+
+    // Corrupted message is dropped without waking up the readers.
+    struct wait_queue_entry entry;
+    atomic_t wakeups = ATOMIC_INIT(0);
+
+    init_waitqueue_func_entry(&entry, mock_count_wakeup);
+    entry.private = &wakeups;
+    add_wait_queue(&(device_data->m_rx_wait), &entry);
+
+    crc_message[0] ^= 0x01;
+    const size_t bad_frame_size = framing_encode(FRAMING_COBS, crc_message, crc_message_size, frame);
+    const size_t received = usb_core_mock_rx_all(mock, frame, bad_frame_size);
+
+    remove_wait_queue(&(device_data->m_rx_wait), &entry);
+
+    KUNIT_EXPECT_EQ(test, received, bad_frame_size);
+    KUNIT_EXPECT_EQ(test, atomic_read(&wakeups), 0);
+    KUNIT_EXPECT_EQ(test, mock_file_read(file, buffer, sizeof(buffer)), -EAGAIN);
+
+    // Frame, which holds only the valid CRC of the empty message, is a bad one.
+    const size_t empty_crc_size = framing_crc_append(FRAMING_CRC_CRC32C, crc_message, 0);
+    const size_t empty_frame_size = framing_encode(FRAMING_COBS, crc_message, empty_crc_size, frame);
+
+    KUNIT_EXPECT_EQ(test, usb_core_mock_rx_all(mock, frame, empty_frame_size), empty_frame_size);
+    KUNIT_EXPECT_EQ(test, mock_file_read(file, buffer, sizeof(buffer)), -EAGAIN);
+
+    struct hot_path_counters sum;
+    device_stats_sum(&(device_data->m_stats), &sum);
+    KUNIT_EXPECT_EQ(test, sum.m_rx_bad_crc_frames, 1);
+    KUNIT_EXPECT_EQ(test, sum.m_rx_bad_frames, 1);
+}
+
+/**
+ * @brief Size of the message, which has been corrupted in the RX ring, makes the read fail
+ * and drops all the data of the ring instead of reading past the message.
+ */
+static void framed_corrupted_size_test(struct kunit * test) {
+    struct usb_core_mock * mock = usb_core_mock_create(test, FRAMING_COBS, FRAMING_CRC_NONE);
+    struct ring_buffer * ring = &(mock->m_device_data->m_rx_ring);
+    struct file * file = mock_file_open(test, mock, O_NONBLOCK);
+    const u16 sizes[] = { DEVICE_FRAMING_MESSAGE_SIZE_MAX + 1, 11 };
+    const u8 payload[10] = { 0 };
+    u8 buffer[64];
+
+    for(size_t i = 0; i < ARRAY_SIZE(sizes); ++i) {
+        KUNIT_ASSERT_TRUE(test, ring_buffer_write_record(ring, &(sizes[i]), sizeof(sizes[i]),
+            payload, sizeof(payload))
+        );
+        KUNIT_EXPECT_EQ(test, mock_file_read(file, buffer, sizeof(buffer)), -EIO);
+        KUNIT_EXPECT_EQ(test, ring_buffer_used(ring), 0);
+    }
+}
+
+/**
+ * Number of bytes, which are received and sent by the benchmark, and the size of each call.
+ */
+#define MOCK_BENCH_BYTES (1024 * 1024)
+#define MOCK_BENCH_CHUNK_SIZE 512
+
+/**
+ * State of the benchmark, which is shared by its threads.
+ */
+struct mock_bench {
+    struct usb_core_mock * m_mock;
+    struct file * m_file;
+
+    /** Buffers of the producer of the received data and of the writer. */
+    u8 * m_rx_chunk;
+    u8 * m_tx_chunk;
+
+    /** Number of calls, which haven't done what they should have. */
+    atomic_t m_failures;
+
+    /** Set by the test, once the producer and the writer have to give up. */
+    bool m_is_stopped;
+
+    struct completion m_producer_done;
+    struct completion m_writer_done;
+};
+
+/**
+ * @brief Receives the data as fast as the reader keeps up with it, i.e. as long as it fits into the RX ring.
+ */
+static int mock_bench_producer_fn(void * data) {
+    struct mock_bench * bench = data;
+    struct device_data * device_data = bench->m_mock->m_device_data;
+
+    for(size_t offset = 0; offset < MOCK_BENCH_BYTES && !READ_ONCE(bench->m_is_stopped);) {
+        if(ring_buffer_available(&(device_data->m_rx_ring)) < MOCK_BENCH_CHUNK_SIZE) {
+            cond_resched();
+            continue;
+        }
+
+        mock_pattern_fill(bench->m_rx_chunk, offset, MOCK_BENCH_CHUNK_SIZE);
+
+        if(usb_core_mock_rx_all(bench->m_mock, bench->m_rx_chunk, MOCK_BENCH_CHUNK_SIZE) != MOCK_BENCH_CHUNK_SIZE) {
+            atomic_inc(&(bench->m_failures));
+            break;
+        }
+
+        offset += MOCK_BENCH_CHUNK_SIZE;
+    }
+
+    complete(&(bench->m_producer_done));
+    return 0;
+}
+
+static int mock_bench_writer_fn(void * data) {
+    struct mock_bench * bench = data;
+
+    for(size_t offset = 0; offset < MOCK_BENCH_BYTES && !READ_ONCE(bench->m_is_stopped);
+        offset += MOCK_BENCH_CHUNK_SIZE
+    ) {
+        mock_pattern_fill(bench->m_tx_chunk, offset, MOCK_BENCH_CHUNK_SIZE);
+
+        if(mock_file_write(bench->m_file, bench->m_tx_chunk, MOCK_BENCH_CHUNK_SIZE) != MOCK_BENCH_CHUNK_SIZE) {
+            atomic_inc(&(bench->m_failures));
+            break;
+        }
+    }
+
+    complete(&(bench->m_writer_done));
+    return 0;
+}
+
+/**
+ * @brief Runs `read()` (in the test thread), `write()` (in the writer thread) and the bulk IN URB
+ * completions (in the producer thread) of the same device concurrently, along with the bulk OUT
+ * URB completions and the poller, and reports the cost of each call and the allocations per call.
+ * Hot path mustn't allocate anything.
+ */
+static void hot_path_bench_test(struct kunit * test) {
+    struct usb_core_mock * mock = usb_core_mock_create(test, FRAMING_NONE, FRAMING_CRC_NONE);
+    struct device_data * device_data = mock->m_device_data;
+    u8 * buffer = kunit_kmalloc(test, MOCK_BENCH_CHUNK_SIZE, GFP_KERNEL);
+    struct mock_bench bench = {
+        .m_mock = mock,
+        .m_file = mock_file_open(test, mock, 0),
+        .m_rx_chunk = kunit_kmalloc(test, MOCK_BENCH_CHUNK_SIZE, GFP_KERNEL),
+        .m_tx_chunk = kunit_kmalloc(test, MOCK_BENCH_CHUNK_SIZE, GFP_KERNEL),
+        .m_failures = ATOMIC_INIT(0)
+    };
+
+    KUNIT_ASSERT_NOT_NULL(test, buffer);
+    KUNIT_ASSERT_NOT_NULL(test, bench.m_rx_chunk);
+    KUNIT_ASSERT_NOT_NULL(test, bench.m_tx_chunk);
+
+    init_completion(&(bench.m_producer_done));
+    init_completion(&(bench.m_writer_done));
+    mock->m_tx_is_pattern = true;
+
+    const long allocations_start = atomic_long_read(&g_mock_allocations);
+    const u64 start_ns = ktime_get_ns();
+
+    struct task_struct * producer = kthread_run(mock_bench_producer_fn, &bench, "ftdi_kunit_producer");
+    KUNIT_ASSERT_FALSE(test, IS_ERR(producer));
+
+    struct task_struct * writer = kthread_run(mock_bench_writer_fn, &bench, "ftdi_kunit_writer");
+
+    if(IS_ERR(writer)) {
+        WRITE_ONCE(bench.m_is_stopped, true);
+        wait_for_completion(&(bench.m_producer_done));
+    }
+
+    KUNIT_ASSERT_FALSE(test, IS_ERR(writer));
+
+    size_t received = 0;
+    size_t rx_mismatches = 0;
+
+    // Reader gives up, once the producer is done and there is nothing to read, as the rest has been dropped.
+    while(received < MOCK_BENCH_BYTES) {
+        if(completion_done(&(bench.m_producer_done)) && ring_buffer_used(&(device_data->m_rx_ring)) == 0) {
+            break;
+        }
+
+        struct kvec kvec = { .iov_base = buffer, .iov_len = MOCK_BENCH_CHUNK_SIZE };
+        struct iov_iter iter;
+        struct kiocb kiocb;
+
+        init_sync_kiocb(&kiocb, bench.m_file);
+        kiocb.ki_flags |= IOCB_NOWAIT;
+        iov_iter_kvec(&iter, ITER_DEST, &kvec, 1, MOCK_BENCH_CHUNK_SIZE);
+
+        const ssize_t status = get_file_operations()->read_iter(&kiocb, &iter);
+
+        if(status == -EAGAIN) {
+            cond_resched();
+            continue;
+        }
+
+        if(status <= 0) {
+            atomic_inc(&(bench.m_failures));
+            break;
+        }
+
+        rx_mismatches += mock_pattern_mismatches(buffer, received, status);
+        received += status;
+    }
+
+    WRITE_ONCE(bench.m_is_stopped, true);
+    wait_for_completion(&(bench.m_producer_done));
+    wait_for_completion(&(bench.m_writer_done));
+
+    const bool is_sent = wait_event_timeout(mock->m_tx_wait,
+        READ_ONCE(mock->m_tx_length) >= MOCK_BENCH_BYTES, MOCK_WAIT_TIMEOUT
+    ) > 0;
+
+    const u64 elapsed_ns = ktime_get_ns() - start_ns;
+    const long allocations = atomic_long_read(&g_mock_allocations) - allocations_start;
+
+    struct hot_path_counters sum;
+    device_stats_sum(&(device_data->m_stats), &sum);
+    u64 calls = 0;
+
+    for(int op = 0; op < HOT_PATH_OP_COUNT; ++op) {
+        const struct hot_path_op_counters * counters = &(sum.m_ops[op]);
+
+        calls += counters->m_calls;
+        kunit_info(test, "%s: %llu calls, %llu ns/op, %llu bytes/op\n", g_hot_path_op_names[op],
+            counters->m_calls, div64_u64(counters->m_ns, max_t(u64, counters->m_calls, 1)),
+            div64_u64(counters->m_bytes, max_t(u64, counters->m_calls, 1))
+        );
+    }
+
+    kunit_info(test, "mutex_contended: %llu, elapsed: %llu us\n", sum.m_mutex_contended,
+        div_u64(elapsed_ns, NSEC_PER_USEC)
+    );
+
+    if(g_mock_allocations_are_counted) {
+        const u64 allocations_per_kilo_op = div64_u64((u64) allocations * 1000, max_t(u64, calls, 1));
+
+        kunit_info(test, "allocations: %ld, allocations/op: %llu.%03llu\n", allocations,
+            allocations_per_kilo_op / 1000, allocations_per_kilo_op % 1000
+        );
+
+        KUNIT_EXPECT_EQ(test, allocations, 0);
+    } else {
+        kunit_info(test, "allocations aren't counted, kmem tracepoints are unavailable\n");
+    }
+
+    KUNIT_EXPECT_EQ(test, atomic_read(&(bench.m_failures)), 0);
+    KUNIT_EXPECT_EQ(test, received, (size_t) MOCK_BENCH_BYTES);
+    KUNIT_EXPECT_EQ(test, rx_mismatches, 0);
+    KUNIT_EXPECT_EQ(test, sum.m_rx_dropped_bytes, 0);
+    KUNIT_EXPECT_TRUE(test, is_sent);
+    KUNIT_EXPECT_EQ(test, mock->m_tx_length, (size_t) MOCK_BENCH_BYTES);
+    KUNIT_EXPECT_EQ(test, mock->m_tx_pattern_mismatches, 0);
+}
+
+static struct kunit_case g_ftdi_usb_driver_test_cases[] = {
+    KUNIT_CASE(rx_read_test),
+    KUNIT_CASE(rx_error_test),
+    KUNIT_CASE(rx_direct_read_test),
+    KUNIT_CASE(tx_write_test),
+    KUNIT_CASE(tx_wrap_test),
+    KUNIT_CASE(framed_crc_test),
+    KUNIT_CASE(framed_corrupted_size_test),
+    KUNIT_CASE_SLOW(hot_path_bench_test),
+    {}
+};
+
+static struct kunit_suite g_ftdi_usb_driver_test_suite = {
+    .name = "ftdi_usb_driver",
+    .suite_init = ftdi_usb_driver_test_suite_init,
+    .suite_exit = ftdi_usb_driver_test_suite_exit,
+    .test_cases = g_ftdi_usb_driver_test_cases,
+};
+
+kunit_test_suite(g_ftdi_usb_driver_test_suite);
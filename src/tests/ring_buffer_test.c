@@ -0,0 +1,153 @@
+/**
+ * @brief File contains the KUnit suite of the ring buffer, which is built into the module by
+ * `make kunit`.
+ */
+
+#include "../src/ring_buffer.h"
+
+#include <kunit/test.h>
+#include <linux/uio.h>
+
+static void ring_buffer_test_free(void * data) {
+    ring_buffer_free(data);
+}
+
+/**
+ * @brief Allocates the ring of a single page, which is freed at the end of the test.
+ */
+static struct ring_buffer * ring_buffer_test_allocate(struct kunit * test) {
+    struct ring_buffer * ring = kunit_kzalloc(test, sizeof(struct ring_buffer), GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_NULL(test, ring);
+    KUNIT_ASSERT_EQ(test, ring_buffer_allocate(ring, PAGE_SIZE), 0);
+    KUNIT_ASSERT_EQ(test, kunit_add_action_or_reset(test, ring_buffer_test_free, ring), 0);
+    KUNIT_ASSERT_EQ(test, ring->m_size, PAGE_SIZE);
+
+    return ring;
+}
+
+/**
+ * @brief Reads the data of the ring into the kernel buffer.
+ */
+static long ring_buffer_test_read(struct ring_buffer * ring, void * buffer, size_t num_bytes) {
+    struct kvec kvec = { .iov_base = buffer, .iov_len = num_bytes };
+    struct iov_iter iter;
+
+    iov_iter_kvec(&iter, ITER_DEST, &kvec, 1, num_bytes);
+    return ring_buffer_copy_to_iter(ring, &iter, num_bytes);
+}
+
+/**
+ * @brief Data, which wraps around the end of the ring, is peeked in two parts and read in order.
+ */
+static void ring_buffer_wrap_test(struct kunit * test) {
+    struct ring_buffer * ring = ring_buffer_test_allocate(test);
+    const unsigned int size = 3 * PAGE_SIZE / 4;
+    u8 * data = kunit_kmalloc(test, size, GFP_KERNEL);
+    u8 * buffer = kunit_kzalloc(test, size, GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_NULL(test, data);
+    KUNIT_ASSERT_NOT_NULL(test, buffer);
+
+    for(unsigned int i = 0; i < size; ++i) {
+        data[i] = i * 7;
+    }
+
+    KUNIT_ASSERT_EQ(test, ring_buffer_write(ring, data, size), size);
+    KUNIT_ASSERT_EQ(test, ring_buffer_test_read(ring, buffer, size), size);
+    KUNIT_ASSERT_EQ(test, ring_buffer_write(ring, data, size), size);
+    KUNIT_EXPECT_EQ(test, ring_buffer_used(ring), size);
+    KUNIT_EXPECT_EQ(test, ring_buffer_available(ring), PAGE_SIZE - size);
+
+    char * first_part = NULL;
+    unsigned int second_part_size = 0;
+    const unsigned int first_part_size = ring_buffer_peek(ring, &first_part, &second_part_size);
+
+    KUNIT_EXPECT_EQ(test, first_part_size, PAGE_SIZE - size);
+    KUNIT_EXPECT_EQ(test, second_part_size, size - (PAGE_SIZE - size));
+    KUNIT_EXPECT_PTR_EQ(test, first_part, ring->m_data + size);
+    KUNIT_EXPECT_MEMEQ(test, first_part, data, first_part_size);
+    KUNIT_EXPECT_MEMEQ(test, ring->m_data, data + first_part_size, second_part_size);
+
+    memset(buffer, 0, size);
+    KUNIT_ASSERT_EQ(test, ring_buffer_test_read(ring, buffer, size), size);
+    KUNIT_EXPECT_MEMEQ(test, buffer, data, size);
+    KUNIT_EXPECT_EQ(test, ring_buffer_used(ring), 0);
+}
+
+/**
+ * @brief Plain write takes what fits, record is written either as a whole or not at all.
+ */
+static void ring_buffer_full_test(struct kunit * test) {
+    struct ring_buffer * ring = ring_buffer_test_allocate(test);
+    u8 * data = kunit_kzalloc(test, 2 * PAGE_SIZE, GFP_KERNEL);
+    const u16 header = 0x1234;
+
+    KUNIT_ASSERT_NOT_NULL(test, data);
+
+    KUNIT_EXPECT_EQ(test, ring_buffer_write(ring, data, 2 * PAGE_SIZE), PAGE_SIZE);
+    KUNIT_EXPECT_EQ(test, ring_buffer_available(ring), 0);
+    KUNIT_EXPECT_EQ(test, ring_buffer_write(ring, data, 1), 0);
+
+    ring_buffer_consume(ring, 10);
+
+    const u32 head = READ_ONCE(ring->m_indices->m_head);
+
+    KUNIT_EXPECT_FALSE(test, ring_buffer_write_record(ring, &header, sizeof(header), data, 9));
+    KUNIT_EXPECT_EQ(test, READ_ONCE(ring->m_indices->m_head), head);
+    KUNIT_EXPECT_TRUE(test, ring_buffer_write_record(ring, &header, sizeof(header), data, 8));
+    KUNIT_EXPECT_EQ(test, READ_ONCE(ring->m_indices->m_head), head + 10);
+
+    // Record takes the space, which the consumer has given back at the start of the data.
+    KUNIT_EXPECT_EQ(test, *(u16 *) (ring->m_data + (head & (PAGE_SIZE - 1))), header);
+
+    ring_buffer_reset(ring);
+    KUNIT_EXPECT_EQ(test, ring_buffer_used(ring), 0);
+    KUNIT_EXPECT_EQ(test, ring_buffer_available(ring), PAGE_SIZE);
+}
+
+/**
+ * @brief Indices, which have been corrupted via the mapping of the ring, never make the ring copy
+ * more than its size or outside of its data.
+ */
+static void ring_buffer_corrupted_indices_test(struct kunit * test) {
+    struct ring_buffer * ring = ring_buffer_test_allocate(test);
+    u8 * buffer = kunit_kzalloc(test, 2 * PAGE_SIZE, GFP_KERNEL);
+
+    KUNIT_ASSERT_NOT_NULL(test, buffer);
+
+    // Consumer is ahead of the producer.
+    WRITE_ONCE(ring->m_indices->m_head, 100);
+    WRITE_ONCE(ring->m_indices->m_tail, 12345);
+    KUNIT_EXPECT_LE(test, ring_buffer_used(ring), PAGE_SIZE);
+    KUNIT_EXPECT_LE(test, ring_buffer_available(ring), PAGE_SIZE);
+    KUNIT_EXPECT_LE(test, ring_buffer_test_read(ring, buffer, 2 * PAGE_SIZE), (long) PAGE_SIZE);
+
+    // Producer is more than the size of the ring ahead of the consumer.
+    WRITE_ONCE(ring->m_indices->m_head, 3 * PAGE_SIZE + 5);
+    WRITE_ONCE(ring->m_indices->m_tail, 0);
+    KUNIT_EXPECT_LE(test, ring_buffer_used(ring), PAGE_SIZE);
+    KUNIT_EXPECT_EQ(test, ring_buffer_available(ring), 0);
+    KUNIT_EXPECT_LE(test, ring_buffer_test_read(ring, buffer, 2 * PAGE_SIZE), (long) PAGE_SIZE);
+
+    char * first_part = NULL;
+    unsigned int second_part_size = 0;
+    const unsigned int first_part_size = ring_buffer_peek(ring, &first_part, &second_part_size);
+
+    KUNIT_EXPECT_LE(test, first_part_size + second_part_size, PAGE_SIZE);
+    KUNIT_EXPECT_LE(test, first_part - ring->m_data + first_part_size, PAGE_SIZE);
+}
+
+static struct kunit_case g_ring_buffer_test_cases[] = {
+    KUNIT_CASE(ring_buffer_wrap_test),
+    KUNIT_CASE(ring_buffer_full_test),
+    KUNIT_CASE(ring_buffer_corrupted_indices_test),
+    {}
+};
+
+static struct kunit_suite g_ring_buffer_test_suite = {
+    .name = "ftdi_ring_buffer",
+    .test_cases = g_ring_buffer_test_cases,
+};
+
+kunit_test_suite(g_ring_buffer_test_suite);
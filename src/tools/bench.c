@@ -0,0 +1,641 @@
+/**
+ * @brief End-to-end throughput and latency benchmark of the driver's character device.
+ *
+ * Benchmark runs one or more workloads against the device file (the real adapter or the
+ * `ft232r_emulator`) and prints the results as JSON, so that the results of different
+ * driver versions could be compared by scripts. Supported workloads:
+ *  * `tx`: unidirectional streaming from the host, i.e. only `write()` calls.
+ *  * `rx`: unidirectional streaming to the host, i.e. only `read()` calls
+ *      (e.g. with the emulator in `generate` mode).
+ *  * `duplex`: full-duplex streaming, writer and reader threads run at the same time
+ *      (e.g. with the emulator in `loopback` mode).
+ *  * `pingpong`: request/response, every message is written and then read back in full
+ *      before the next one is sent, latency is the round-trip time (requires loopback).
+ *  * `small`: many small writes (`--small-size` bytes each).
+ *  * `large`: large writes (`--large-size` bytes each).
+ *
+ * For every workload the following is reported: number of bytes and messages (system
+ * calls or round trips), MB/s, messages per second and latency percentiles in microseconds.
+ * Optionally (`--driver-stats`), the driver's hot path counters from debugfs are reset
+ * before each workload and reported after it, which gives per-call costs inside the driver.
+ * Reads could be made with busy polling (`--busy-poll`), to compare the latencies with it.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "../src/device_ioctl.h"
+
+#define DEFAULT_DEVICE_PATH "/dev/emil_hc_06_dev0"
+#define DEFAULT_DURATION_S 5
+#define DEFAULT_MESSAGE_SIZE 32
+#define DEFAULT_SMALL_SIZE 8
+#define DEFAULT_LARGE_SIZE 65536
+
+/** Maximum number of latency samples that are kept per workload (older ones are overwritten). */
+#define MAX_LATENCY_SAMPLES (1 << 20)
+
+/** Maximum size of the driver statistics file. */
+#define MAX_DRIVER_STATS_SIZE 8192
+
+/**
+ * Options of the benchmark, that are shared by all workloads.
+ */
+struct bench_options {
+    const char * m_device_path;
+    double m_duration_s;
+    size_t m_message_size;
+    size_t m_small_size;
+    size_t m_large_size;
+    const char * m_driver_stats_path;
+    unsigned int m_busy_poll_usecs;
+};
+
+/**
+ * Latency samples (in nanoseconds) of a single workload or a single thread of it.
+ */
+struct latency_samples {
+    uint64_t * m_samples;
+    size_t m_count;
+    uint64_t m_total_count;
+};
+
+/**
+ * Result of a single workload.
+ */
+struct bench_result {
+    const char * m_name;
+    uint64_t m_bytes;
+    uint64_t m_messages;
+    uint64_t m_errors;
+    double m_duration_s;
+    struct latency_samples m_latency;
+    char * m_driver_stats;
+};
+
+static struct bench_options g_options = {
+    .m_device_path = DEFAULT_DEVICE_PATH,
+    .m_duration_s = DEFAULT_DURATION_S,
+    .m_message_size = DEFAULT_MESSAGE_SIZE,
+    .m_small_size = DEFAULT_SMALL_SIZE,
+    .m_large_size = DEFAULT_LARGE_SIZE,
+};
+
+// -----------------
+// Helper functions.
+// -----------------
+
+static uint64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static int latency_samples_init(struct latency_samples * latency) {
+    latency->m_samples = malloc(MAX_LATENCY_SAMPLES * sizeof(uint64_t));
+    latency->m_count = 0;
+    latency->m_total_count = 0;
+
+    return latency->m_samples ? 0 : -ENOMEM;
+}
+
+static void latency_samples_add(struct latency_samples * latency, uint64_t sample_ns) {
+    latency->m_samples[latency->m_total_count % MAX_LATENCY_SAMPLES] = sample_ns;
+    ++latency->m_total_count;
+
+    if(latency->m_count < MAX_LATENCY_SAMPLES) {
+        ++latency->m_count;
+    }
+}
+
+static void latency_samples_merge(struct latency_samples * destination, const struct latency_samples * source) {
+    for(size_t i = 0; i < source->m_count; ++i) {
+        latency_samples_add(destination, source->m_samples[i]);
+    }
+}
+
+static int compare_u64(const void * first, const void * second) {
+    const uint64_t a = *(const uint64_t *) first;
+    const uint64_t b = *(const uint64_t *) second;
+
+    return (a > b) - (a < b);
+}
+
+/**
+ * @brief Returns the given percentile (in microseconds) of sorted latency samples.
+ */
+static double latency_percentile_us(const struct latency_samples * latency, double percentile) {
+    if(latency->m_count == 0) {
+        return 0.0;
+    }
+
+    size_t index = (size_t) (percentile / 100.0 * (latency->m_count - 1) + 0.5);
+    return latency->m_samples[index] / 1000.0;
+}
+
+static void fill_pattern(unsigned char * buffer, size_t size) {
+    for(size_t i = 0; i < size; ++i) {
+        buffer[i] = (unsigned char) ('0' + i % 64);
+    }
+}
+
+static int open_device(int flags) {
+    const int fd = open(g_options.m_device_path, flags);
+
+    if(fd < 0) {
+        fprintf(stderr, "bench: failed to open %s: %s\n", g_options.m_device_path, strerror(errno));
+        return fd;
+    }
+
+    uint32_t busy_poll_usecs = g_options.m_busy_poll_usecs;
+
+    if(busy_poll_usecs && ioctl(fd, DEVICE_IOCTL_SET_BUSY_POLL, &busy_poll_usecs)) {
+        fprintf(stderr, "bench: failed to enable busy polling: %s\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * @brief Resets the driver's hot path counters by writing to their debugfs file.
+ */
+static int driver_stats_reset(void) {
+    FILE * file = fopen(g_options.m_driver_stats_path, "w");
+
+    if(!file) {
+        fprintf(stderr, "bench: failed to open %s: %s\n", g_options.m_driver_stats_path, strerror(errno));
+        return -1;
+    }
+
+    fputs("0\n", file);
+    fclose(file);
+
+    return 0;
+}
+
+/**
+ * @brief Reads the driver's hot path counters, i.e. `<name> <value>` lines.
+ */
+static char * driver_stats_read(void) {
+    FILE * file = fopen(g_options.m_driver_stats_path, "r");
+    char * stats = calloc(1, MAX_DRIVER_STATS_SIZE);
+
+    if(!file || !stats) {
+        if(file) {
+            fclose(file);
+        }
+
+        free(stats);
+        return NULL;
+    }
+
+    const size_t length = fread(stats, 1, MAX_DRIVER_STATS_SIZE - 1, file);
+    stats[length] = '\0';
+    fclose(file);
+
+    return stats;
+}
+
+// ----------
+// Workloads.
+// ----------
+
+/**
+ * Arguments of a streaming thread, which either writes or reads the device
+ * in a loop until the deadline.
+ */
+struct stream_thread {
+    int m_fd;
+    int m_is_writer;
+    size_t m_chunk_size;
+    uint64_t m_deadline_ns;
+    uint64_t m_bytes;
+    uint64_t m_messages;
+    uint64_t m_errors;
+    struct latency_samples m_latency;
+};
+
+static void * stream_thread_run(void * argument) {
+    struct stream_thread * thread = argument;
+    unsigned char * buffer = malloc(thread->m_chunk_size);
+
+    if(!buffer) {
+        ++thread->m_errors;
+        return NULL;
+    }
+
+    fill_pattern(buffer, thread->m_chunk_size);
+
+    while(now_ns() < thread->m_deadline_ns) {
+        const uint64_t start = now_ns();
+        const ssize_t result = thread->m_is_writer ?
+            write(thread->m_fd, buffer, thread->m_chunk_size) :
+            read(thread->m_fd, buffer, thread->m_chunk_size);
+        const uint64_t end = now_ns();
+
+        if(result < 0) {
+            if(errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+
+            ++thread->m_errors;
+            break;
+        }
+
+        thread->m_bytes += result;
+        ++thread->m_messages;
+        latency_samples_add(&thread->m_latency, end - start);
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+/**
+ * @brief Runs writer and/or reader threads for the benchmark duration and collects
+ * their results into `result`.
+ */
+static int run_stream(struct bench_result * result, int with_writer, int with_reader, size_t chunk_size) {
+    const int fd = open_device(O_RDWR);
+
+    if(fd < 0) {
+        return -1;
+    }
+
+    struct stream_thread threads[2];
+    pthread_t handles[2];
+    int num_threads = 0;
+    const uint64_t start = now_ns();
+    const uint64_t deadline = start + (uint64_t) (g_options.m_duration_s * 1e9);
+
+    for(int i = 0; i < 2; ++i) {
+        if((i == 0 && !with_writer) || (i == 1 && !with_reader)) {
+            continue;
+        }
+
+        struct stream_thread * thread = &threads[num_threads];
+        memset(thread, 0, sizeof(*thread));
+        thread->m_fd = fd;
+        thread->m_is_writer = i == 0;
+        thread->m_chunk_size = chunk_size;
+        thread->m_deadline_ns = deadline;
+
+        if(latency_samples_init(&thread->m_latency)) {
+            close(fd);
+            return -1;
+        }
+
+        pthread_create(&handles[num_threads], NULL, stream_thread_run, thread);
+        ++num_threads;
+    }
+
+    for(int i = 0; i < num_threads; ++i) {
+        pthread_join(handles[i], NULL);
+        result->m_bytes += threads[i].m_bytes;
+        result->m_messages += threads[i].m_messages;
+        result->m_errors += threads[i].m_errors;
+        latency_samples_merge(&result->m_latency, &threads[i].m_latency);
+        free(threads[i].m_latency.m_samples);
+    }
+
+    result->m_duration_s = (now_ns() - start) / 1e9;
+    close(fd);
+
+    return 0;
+}
+
+/**
+ * @brief Writes a message and reads until the whole message comes back,
+ * latency is the round-trip time of each message.
+ */
+static int run_pingpong(struct bench_result * result) {
+    const int fd = open_device(O_RDWR);
+
+    if(fd < 0) {
+        return -1;
+    }
+
+    const size_t size = g_options.m_message_size;
+    unsigned char * message = malloc(size);
+    unsigned char * response = malloc(size);
+
+    if(!message || !response) {
+        free(message);
+        free(response);
+        close(fd);
+        return -1;
+    }
+
+    fill_pattern(message, size);
+
+    const uint64_t start = now_ns();
+    const uint64_t deadline = start + (uint64_t) (g_options.m_duration_s * 1e9);
+
+    while(now_ns() < deadline) {
+        const uint64_t round_trip_start = now_ns();
+        size_t written = 0;
+        size_t received = 0;
+
+        while(written < size && now_ns() < deadline) {
+            const ssize_t result_bytes = write(fd, message + written, size - written);
+
+            if(result_bytes < 0 && errno != EINTR && errno != EAGAIN) {
+                goto error;
+            }
+
+            written += result_bytes > 0 ? result_bytes : 0;
+        }
+
+        while(received < size && now_ns() < deadline) {
+            const ssize_t result_bytes = read(fd, response + received, size - received);
+
+            if(result_bytes < 0 && errno != EINTR && errno != EAGAIN) {
+                goto error;
+            }
+
+            received += result_bytes > 0 ? result_bytes : 0;
+        }
+
+        if(received < size) {
+            // Deadline has been reached in the middle of the round trip.
+            break;
+        }
+
+        if(memcmp(message, response, size)) {
+            ++result->m_errors;
+        }
+
+        result->m_bytes += size;
+        ++result->m_messages;
+        latency_samples_add(&result->m_latency, now_ns() - round_trip_start);
+    }
+
+    result->m_duration_s = (now_ns() - start) / 1e9;
+    free(message);
+    free(response);
+    close(fd);
+
+    return 0;
+
+error:
+    ++result->m_errors;
+    result->m_duration_s = (now_ns() - start) / 1e9;
+    free(message);
+    free(response);
+    close(fd);
+
+    return 0;
+}
+
+static int run_workload_without_stats(struct bench_result * result) {
+    if(strcmp(result->m_name, "tx") == 0) {
+        return run_stream(result, 1, 0, g_options.m_message_size);
+    } else if(strcmp(result->m_name, "rx") == 0) {
+        return run_stream(result, 0, 1, g_options.m_message_size);
+    } else if(strcmp(result->m_name, "duplex") == 0) {
+        return run_stream(result, 1, 1, g_options.m_message_size);
+    } else if(strcmp(result->m_name, "pingpong") == 0) {
+        return run_pingpong(result);
+    } else if(strcmp(result->m_name, "small") == 0) {
+        return run_stream(result, 1, 0, g_options.m_small_size);
+    } else if(strcmp(result->m_name, "large") == 0) {
+        return run_stream(result, 1, 0, g_options.m_large_size);
+    }
+
+    fprintf(stderr, "bench: unknown workload '%s'\n", result->m_name);
+    return -1;
+}
+
+static int run_workload(struct bench_result * result) {
+    if(latency_samples_init(&result->m_latency)) {
+        return -1;
+    }
+
+    if(g_options.m_driver_stats_path && driver_stats_reset()) {
+        return -1;
+    }
+
+    if(run_workload_without_stats(result)) {
+        return -1;
+    }
+
+    if(g_options.m_driver_stats_path) {
+        result->m_driver_stats = driver_stats_read();
+    }
+
+    return 0;
+}
+
+// ------------
+// JSON output.
+// ------------
+
+static void print_result(FILE * output, struct bench_result * result, int is_last) {
+    qsort(result->m_latency.m_samples, result->m_latency.m_count, sizeof(uint64_t), compare_u64);
+
+    const double duration = result->m_duration_s > 0 ? result->m_duration_s : 1e-9;
+
+    fprintf(output,
+        "    {\n"
+        "      \"name\": \"%s\",\n"
+        "      \"duration_s\": %.6f,\n"
+        "      \"bytes\": %llu,\n"
+        "      \"messages\": %llu,\n"
+        "      \"errors\": %llu,\n"
+        "      \"mb_per_s\": %.6f,\n"
+        "      \"messages_per_s\": %.3f,\n"
+        "      \"latency_us\": {\n"
+        "        \"samples\": %llu,\n"
+        "        \"p50\": %.3f,\n"
+        "        \"p90\": %.3f,\n"
+        "        \"p99\": %.3f,\n"
+        "        \"p999\": %.3f,\n"
+        "        \"max\": %.3f\n"
+        "      }",
+        result->m_name, result->m_duration_s,
+        (unsigned long long) result->m_bytes, (unsigned long long) result->m_messages,
+        (unsigned long long) result->m_errors,
+        result->m_bytes / duration / 1e6, result->m_messages / duration,
+        (unsigned long long) result->m_latency.m_total_count,
+        latency_percentile_us(&result->m_latency, 50.0),
+        latency_percentile_us(&result->m_latency, 90.0),
+        latency_percentile_us(&result->m_latency, 99.0),
+        latency_percentile_us(&result->m_latency, 99.9),
+        latency_percentile_us(&result->m_latency, 100.0)
+    );
+
+    if(result->m_driver_stats) {
+        fprintf(output, ",\n      \"driver_stats\": {");
+
+        // Every line of the statistics file is a `<name> <numeric value>` pair.
+        int is_first = 1;
+
+        for(char * saveptr = NULL, * line = strtok_r(result->m_driver_stats, "\n", &saveptr);
+            line; line = strtok_r(NULL, "\n", &saveptr)
+        ) {
+            char * value = strchr(line, ' ');
+
+            if(!value) {
+                continue;
+            }
+
+            *value++ = '\0';
+            fprintf(output, "%s\n        \"%s\": %s", is_first ? "" : ",", line, value);
+            is_first = 0;
+        }
+
+        fprintf(output, "\n      }");
+    }
+
+    fprintf(output, "\n    }%s\n", is_last ? "" : ",");
+}
+
+// -----
+// Main.
+// -----
+
+static void print_usage(const char * program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -d, --device <path>        Device file (default: %s)\n"
+        "  -w, --workloads <list>     Comma separated list of tx,rx,duplex,pingpong,small,large\n"
+        "                             (default: tx,duplex,pingpong,small,large)\n"
+        "  -t, --duration <seconds>   Duration of each workload (default: %d)\n"
+        "  -s, --message-size <bytes> Size of a message in tx/rx/duplex/pingpong (default: %d)\n"
+        "      --small-size <bytes>   Size of a write in the small workload (default: %d)\n"
+        "      --large-size <bytes>   Size of a write in the large workload (default: %d)\n"
+        "  -o, --output <file>        Write JSON to the file instead of stdout\n"
+        "      --driver-stats <file>  Driver's debugfs hot_path_stats file to reset and report\n"
+        "      --busy-poll <usecs>    Busy poll budget of reads (default: 0, i.e. disabled)\n",
+        program, DEFAULT_DEVICE_PATH, DEFAULT_DURATION_S, DEFAULT_MESSAGE_SIZE,
+        DEFAULT_SMALL_SIZE, DEFAULT_LARGE_SIZE
+    );
+}
+
+int main(int argc, char ** argv) {
+    enum { OPTION_SMALL_SIZE = 256, OPTION_LARGE_SIZE, OPTION_DRIVER_STATS, OPTION_BUSY_POLL };
+
+    static const struct option options[] = {
+        { "device", required_argument, NULL, 'd' },
+        { "workloads", required_argument, NULL, 'w' },
+        { "duration", required_argument, NULL, 't' },
+        { "message-size", required_argument, NULL, 's' },
+        { "small-size", required_argument, NULL, OPTION_SMALL_SIZE },
+        { "large-size", required_argument, NULL, OPTION_LARGE_SIZE },
+        { "output", required_argument, NULL, 'o' },
+        { "driver-stats", required_argument, NULL, OPTION_DRIVER_STATS },
+        { "busy-poll", required_argument, NULL, OPTION_BUSY_POLL },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    char workloads[256] = "tx,duplex,pingpong,small,large";
+    const char * output_path = NULL;
+    int option;
+
+    while((option = getopt_long(argc, argv, "d:w:t:s:o:h", options, NULL)) != -1) {
+        switch(option) {
+        case 'd':
+            g_options.m_device_path = optarg;
+            break;
+
+        case 'w':
+            snprintf(workloads, sizeof(workloads), "%s", optarg);
+            break;
+
+        case 't':
+            g_options.m_duration_s = atof(optarg);
+            break;
+
+        case 's':
+            g_options.m_message_size = strtoul(optarg, NULL, 0);
+            break;
+
+        case OPTION_SMALL_SIZE:
+            g_options.m_small_size = strtoul(optarg, NULL, 0);
+            break;
+
+        case OPTION_LARGE_SIZE:
+            g_options.m_large_size = strtoul(optarg, NULL, 0);
+            break;
+
+        case 'o':
+            output_path = optarg;
+            break;
+
+        case OPTION_DRIVER_STATS:
+            g_options.m_driver_stats_path = optarg;
+            break;
+
+        case OPTION_BUSY_POLL:
+            g_options.m_busy_poll_usecs = strtoul(optarg, NULL, 0);
+            break;
+
+        default:
+            print_usage(argv[0]);
+            return option == 'h' ? 0 : 1;
+        }
+    }
+
+    if(g_options.m_duration_s <= 0 || !g_options.m_message_size ||
+        !g_options.m_small_size || !g_options.m_large_size
+    ) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    struct bench_result results[16];
+    int num_results = 0;
+
+    for(char * saveptr = NULL, * name = strtok_r(workloads, ",", &saveptr);
+        name && num_results < 16; name = strtok_r(NULL, ",", &saveptr)
+    ) {
+        struct bench_result * result = &results[num_results];
+        memset(result, 0, sizeof(*result));
+        result->m_name = name;
+
+        fprintf(stderr, "bench: running '%s' for %.1f s\n", name, g_options.m_duration_s);
+
+        if(run_workload(result)) {
+            return 1;
+        }
+
+        ++num_results;
+    }
+
+    FILE * output = output_path ? fopen(output_path, "w") : stdout;
+
+    if(!output) {
+        fprintf(stderr, "bench: failed to open %s: %s\n", output_path, strerror(errno));
+        return 1;
+    }
+
+    fprintf(output, "{\n  \"device\": \"%s\",\n  \"workloads\": [\n", g_options.m_device_path);
+
+    for(int i = 0; i < num_results; ++i) {
+        print_result(output, &results[i], i == num_results - 1);
+        free(results[i].m_latency.m_samples);
+        free(results[i].m_driver_stats);
+    }
+
+    fprintf(output, "  ]\n}\n");
+
+    if(output != stdout) {
+        fclose(output);
+    }
+
+    return 0;
+}
@@ -0,0 +1,1001 @@
+/**
+ * @brief Userspace FT232R + HC-06 emulator, which is built on top of FunctionFS.
+ *
+ * Together with `ft232r_emulator.sh` (which creates a configfs USB gadget with the
+ * vendor/product ids 0403:6001 and binds it to `dummy_hcd`) this program makes the
+ * host see the same device as in `ftdi_lsusb_output.txt`: one vendor specific interface
+ * with a bulk IN endpoint 0x81 and a bulk OUT endpoint 0x02, both with 64-byte packets.
+ * That allows running the driver and the benchmarks on any Linux machine, without the
+ * physical adapter.
+ *
+ * The emulator models the following parts of the real hardware:
+ *  * FT232R: vendor control requests (reset, baud rate, latency timer, modem status, etc.),
+ *      2-byte modem/line status header in front of every bulk IN packet, and the latency
+ *      timer, i.e. a (possibly empty) bulk IN packet is sent either once 62 bytes of payload
+ *      are collected or once the latency timer expires.
+ *  * UART: bytes travel between the FT232R and the HC-06 at the configured UART rate
+ *      (10 bits per byte for 8N1), in both directions.
+ *  * HC-06: either AT command mode (as the unpaired module behaves), loopback of
+ *      everything the host writes (paired with a remote echo peer), or generation of
+ *      traffic at the UART rate (paired with a remote streaming peer).
+ */
+
+#define _GNU_SOURCE
+
+#include <linux/usb/functionfs.h>
+#include <linux/usb/ch9.h>
+
+#include <endian.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// ------------------------------
+// FT232R and HC-06 constants.
+// ------------------------------
+
+/** FTDI vendor requests, which are sent on the control endpoint. */
+#define FTDI_SIO_RESET 0x00
+#define FTDI_SIO_SET_MODEM_CTRL 0x01
+#define FTDI_SIO_SET_FLOW_CTRL 0x02
+#define FTDI_SIO_SET_BAUD_RATE 0x03
+#define FTDI_SIO_SET_DATA 0x04
+#define FTDI_SIO_GET_MODEM_STATUS 0x05
+#define FTDI_SIO_SET_EVENT_CHAR 0x06
+#define FTDI_SIO_SET_ERROR_CHAR 0x07
+#define FTDI_SIO_SET_LATENCY_TIMER 0x09
+#define FTDI_SIO_GET_LATENCY_TIMER 0x0a
+
+/** Values of `wValue` of `FTDI_SIO_RESET` request. */
+#define FTDI_SIO_RESET_SIO 0
+#define FTDI_SIO_RESET_PURGE_RX 1
+#define FTDI_SIO_RESET_PURGE_TX 2
+
+/** First byte of the status header: modem status (lower nibble is always 0x1). */
+#define FTDI_MODEM_STATUS_RESERVED 0x01
+#define FTDI_MODEM_STATUS_CTS 0x10
+#define FTDI_MODEM_STATUS_DSR 0x20
+
+/** Second byte of the status header: line status. */
+#define FTDI_LINE_STATUS_OVERRUN_ERROR 0x02
+#define FTDI_LINE_STATUS_FRAMING_ERROR 0x08
+#define FTDI_LINE_STATUS_TX_HOLDING_EMPTY 0x20
+#define FTDI_LINE_STATUS_TX_EMPTY 0x40
+
+/** Size of the status header, which FT232R puts in front of each bulk IN packet. */
+#define FTDI_STATUS_HEADER_SIZE 2
+
+/** Default value of the FT232R latency timer (in milliseconds). */
+#define FTDI_DEFAULT_LATENCY_TIMER_MS 16
+
+/** Size of FT232R receive buffer (UART -> USB direction). */
+#define FTDI_DEFAULT_RX_FIFO_SIZE 256
+
+/** Bulk endpoint packet sizes for full-speed (FT232R) and high-speed (H-series) parts. */
+#define FULL_SPEED_MAX_PACKET_SIZE 64
+#define HIGH_SPEED_MAX_PACKET_SIZE 512
+
+/** Number of bits that are sent on UART per byte with 8N1 setting (start + 8 data + stop). */
+#define UART_BITS_PER_BYTE 10
+
+/** HC-06 default UART baud rate. */
+#define HC_06_DEFAULT_BAUD_RATE 9600
+
+/** Maximum length of the HC-06 AT command. */
+#define HC_06_AT_COMMAND_MAX_LENGTH 64
+
+/** Product string, that is reported for the interface. */
+#define FT232R_PRODUCT_STRING "FT232R USB UART"
+
+// ----------------------------
+// Emulator state and options.
+// ----------------------------
+
+/**
+ * Behavior of the HC-06 module on the other side of the UART.
+ */
+enum hc_06_mode {
+    HC_06_MODE_AT,
+    HC_06_MODE_LOOPBACK,
+    HC_06_MODE_GENERATE
+};
+
+/**
+ * Simple byte FIFO, which models the FT232R receive buffer, i.e. bytes that came
+ * from the UART and wait to be sent to the host.
+ */
+struct byte_fifo {
+    unsigned char * m_buffer;
+    size_t m_capacity;
+    size_t m_head;
+    size_t m_length;
+};
+
+/**
+ * Whole state of the emulated device. All the fields below `m_mutex` are protected by it.
+ */
+struct emulator {
+    // Options that don't change after start up.
+    const char * m_ffs_directory;
+    enum hc_06_mode m_mode;
+    int m_hc_06_baud_rate;
+    int m_at_timeout_ms;
+    int m_is_high_speed;
+    int m_verbose;
+
+    // Endpoint files of the FunctionFS instance.
+    int m_ep0_fd;
+    int m_ep_in_fd;
+    int m_ep_out_fd;
+
+    pthread_mutex_t m_mutex;
+
+    /** Signalled once data is added to the receive FIFO or latency timer changes. */
+    pthread_cond_t m_rx_condition;
+
+    struct byte_fifo m_rx_fifo;
+    int m_host_baud_rate;
+    int m_latency_timer_ms;
+    unsigned char m_line_status_errors;
+    int m_tx_in_progress;
+    int m_is_enabled;
+
+    // HC-06 AT command parser.
+    char m_at_command[HC_06_AT_COMMAND_MAX_LENGTH + 1];
+    size_t m_at_command_length;
+    struct timespec m_at_last_byte_time;
+    char m_hc_06_name[32];
+
+    // Statistics, that are printed on exit.
+    unsigned long long m_bytes_from_host;
+    unsigned long long m_bytes_to_host;
+    unsigned long long m_packets_to_host;
+    unsigned long long m_rx_overruns;
+};
+
+static struct emulator g_emulator;
+static volatile sig_atomic_t g_stop = 0;
+
+// -----------------
+// Helper functions.
+// -----------------
+
+static void log_message(const char * fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "ft232r_emulator: ");
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+}
+
+#define LOG_VERBOSE(fmt, args...) do { if(g_emulator.m_verbose) log_message(fmt, ## args); } while(0)
+
+static long long timespec_to_ns(const struct timespec * time) {
+    return (long long) time->tv_sec * 1000000000LL + time->tv_nsec;
+}
+
+static long long now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return timespec_to_ns(&now);
+}
+
+static struct timespec ns_to_timespec(long long ns) {
+    struct timespec time = { .tv_sec = ns / 1000000000LL, .tv_nsec = ns % 1000000000LL };
+    return time;
+}
+
+/**
+ * @brief Sleeps until the given absolute `CLOCK_MONOTONIC` time.
+ */
+static void sleep_until_ns(long long deadline_ns) {
+    struct timespec deadline = ns_to_timespec(deadline_ns);
+
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR && !g_stop) {
+    }
+}
+
+/**
+ * @brief Returns the time (in nanoseconds) needed to send `num_bytes` over UART.
+ */
+static long long uart_time_ns(size_t num_bytes) {
+    return (long long) num_bytes * UART_BITS_PER_BYTE * 1000000000LL / g_emulator.m_hc_06_baud_rate;
+}
+
+static size_t byte_fifo_push(struct byte_fifo * fifo, const unsigned char * data, size_t length) {
+    size_t pushed = 0;
+
+    while(pushed < length && fifo->m_length < fifo->m_capacity) {
+        fifo->m_buffer[(fifo->m_head + fifo->m_length) % fifo->m_capacity] = data[pushed++];
+        ++fifo->m_length;
+    }
+
+    return pushed;
+}
+
+static size_t byte_fifo_pop(struct byte_fifo * fifo, unsigned char * data, size_t length) {
+    size_t popped = 0;
+
+    while(popped < length && fifo->m_length > 0) {
+        data[popped++] = fifo->m_buffer[fifo->m_head];
+        fifo->m_head = (fifo->m_head + 1) % fifo->m_capacity;
+        --fifo->m_length;
+    }
+
+    return popped;
+}
+
+/**
+ * @brief Pushes bytes that came out of the HC-06 UART TX line into the FT232R receive
+ * buffer. Bytes, that don't fit, are dropped and the overrun error is reported to the host.
+ * Should be called with `m_mutex` locked.
+ */
+static void uart_deliver_to_ft232r(const unsigned char * data, size_t length) {
+    const size_t pushed = byte_fifo_push(&g_emulator.m_rx_fifo, data, length);
+
+    if(pushed < length) {
+        g_emulator.m_line_status_errors |= FTDI_LINE_STATUS_OVERRUN_ERROR;
+        g_emulator.m_rx_overruns += length - pushed;
+    }
+
+    if(pushed) {
+        pthread_cond_signal(&g_emulator.m_rx_condition);
+    }
+}
+
+/**
+ * @brief Decodes the FTDI baud rate divisor from the `SIO_SET_BAUD_RATE` request into
+ * the baud rate value. Divisor consists of 14 bits of integer part, 3 bits of fractional
+ * part (in a non-linear encoding) and a high-speed bit (12 MHz base clock of H-series parts).
+ */
+static int ftdi_decode_baud_rate(uint16_t value, uint16_t index) {
+    static const int fraction_eighths[8] = { 0, 4, 2, 1, 3, 5, 6, 7 };
+    const uint32_t divisor = value | ((uint32_t) (index & 0xff00 ? index >> 8 : index) << 16);
+    const int base_clock = (divisor & 0x20000) ? 12000000 : 3000000;
+    const uint32_t integer_part = divisor & 0x3fff;
+    const int fraction = fraction_eighths[(divisor >> 14) & 0x7];
+
+    if(!(divisor & 0x20000)) {
+        // Divisors 0 and 1 are special cases for 3 Mbaud and 2 Mbaud respectively.
+        if(integer_part == 0 && fraction == 0) {
+            return 3000000;
+        }
+
+        if(integer_part == 1 && fraction == 0) {
+            return 2000000;
+        }
+    }
+
+    return (int) ((8LL * base_clock) / (8LL * integer_part + fraction));
+}
+
+// ------------
+// HC-06 model.
+// ------------
+
+/**
+ * @brief Produces the response of HC-06 to the AT command, as the linvor firmware does.
+ *
+ * @return 1 if the response was produced, 0 if the command is not known.
+ */
+static int hc_06_at_response(const char * command, char * response, size_t response_size) {
+    static const int baud_rates[] = {
+        1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600, 1382400
+    };
+
+    if(strcmp(command, "AT") == 0) {
+        snprintf(response, response_size, "OK");
+    } else if(strcmp(command, "AT+VERSION") == 0) {
+        snprintf(response, response_size, "OKlinvorV1.8");
+    } else if(strncmp(command, "AT+NAME", 7) == 0) {
+        snprintf(g_emulator.m_hc_06_name, sizeof(g_emulator.m_hc_06_name), "%.31s", command + 7);
+        snprintf(response, response_size, "OKsetname");
+    } else if(strncmp(command, "AT+PIN", 6) == 0 && strlen(command) == 10) {
+        snprintf(response, response_size, "OKsetPIN");
+    } else if(strncmp(command, "AT+BAUD", 7) == 0 && strlen(command) == 8) {
+        const char selector = command[7];
+        int index = -1;
+
+        if(selector >= '1' && selector <= '9') {
+            index = selector - '1';
+        } else if(selector >= 'A' && selector <= 'C') {
+            index = 9 + selector - 'A';
+        }
+
+        if(index < 0) {
+            return 0;
+        }
+
+        // Response is still sent with the old baud rate, but the model doesn't garble
+        // bytes on the fly, so the new baud rate can be applied right away.
+        snprintf(response, response_size, "OK%d", baud_rates[index]);
+        g_emulator.m_hc_06_baud_rate = baud_rates[index];
+    } else {
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Executes the collected AT command, if HC-06 didn't receive any new byte during
+ * the AT command timeout. HC-06 doesn't use line endings, the command is terminated by silence.
+ * Should be called with `m_mutex` locked.
+ */
+static void hc_06_flush_at_command(long long now) {
+    if(g_emulator.m_at_command_length == 0 ||
+        now - timespec_to_ns(&g_emulator.m_at_last_byte_time) < g_emulator.m_at_timeout_ms * 1000000LL
+    ) {
+        return;
+    }
+
+    char response[HC_06_AT_COMMAND_MAX_LENGTH + 16];
+    g_emulator.m_at_command[g_emulator.m_at_command_length] = '\0';
+
+    if(hc_06_at_response(g_emulator.m_at_command, response, sizeof(response))) {
+        LOG_VERBOSE("AT command '%s' -> '%s'", g_emulator.m_at_command, response);
+        uart_deliver_to_ft232r((const unsigned char *) response, strlen(response));
+    } else {
+        LOG_VERBOSE("unknown AT command '%s' was ignored", g_emulator.m_at_command);
+    }
+
+    g_emulator.m_at_command_length = 0;
+}
+
+/**
+ * @brief Passes bytes, that arrived at HC-06 over UART, to the HC-06 model.
+ * Should be called with `m_mutex` locked.
+ */
+static void hc_06_receive(const unsigned char * data, size_t length) {
+    switch(g_emulator.m_mode) {
+    case HC_06_MODE_LOOPBACK:
+        uart_deliver_to_ft232r(data, length);
+        break;
+
+    case HC_06_MODE_AT:
+        for(size_t i = 0; i < length; ++i) {
+            if(g_emulator.m_at_command_length < HC_06_AT_COMMAND_MAX_LENGTH) {
+                g_emulator.m_at_command[g_emulator.m_at_command_length++] = (char) data[i];
+            }
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &g_emulator.m_at_last_byte_time);
+        break;
+
+    case HC_06_MODE_GENERATE:
+        // Remote peer only streams data towards us, everything that is sent to it is discarded.
+        break;
+    }
+}
+
+// ---------------------------------------
+// FunctionFS descriptors and control endpoint.
+// ---------------------------------------
+
+/**
+ * @brief Appends interface and two bulk endpoint descriptors with the given packet size.
+ */
+static size_t append_interface_descriptors(unsigned char * buffer, int max_packet_size) {
+    struct usb_interface_descriptor interface = {
+        .bLength = USB_DT_INTERFACE_SIZE,
+        .bDescriptorType = USB_DT_INTERFACE,
+        .bInterfaceNumber = 0,
+        .bAlternateSetting = 0,
+        .bNumEndpoints = 2,
+        .bInterfaceClass = USB_CLASS_VENDOR_SPEC,
+        .bInterfaceSubClass = USB_SUBCLASS_VENDOR_SPEC,
+        .bInterfaceProtocol = 0xff,
+        .iInterface = 1,
+    };
+
+    // Bulk IN endpoint goes first, so that FunctionFS creates it as `ep1` and
+    // the UDC auto-configuration picks `ep1in`, i.e. address 0x81.
+    struct usb_endpoint_descriptor_no_audio bulk_in = {
+        .bLength = USB_DT_ENDPOINT_SIZE,
+        .bDescriptorType = USB_DT_ENDPOINT,
+        .bEndpointAddress = 1 | USB_DIR_IN,
+        .bmAttributes = USB_ENDPOINT_XFER_BULK,
+        .wMaxPacketSize = htole16(max_packet_size),
+    };
+
+    struct usb_endpoint_descriptor_no_audio bulk_out = {
+        .bLength = USB_DT_ENDPOINT_SIZE,
+        .bDescriptorType = USB_DT_ENDPOINT,
+        .bEndpointAddress = 2 | USB_DIR_OUT,
+        .bmAttributes = USB_ENDPOINT_XFER_BULK,
+        .wMaxPacketSize = htole16(max_packet_size),
+    };
+
+    size_t offset = 0;
+    memcpy(buffer + offset, &interface, sizeof(interface));
+    offset += sizeof(interface);
+    memcpy(buffer + offset, &bulk_in, sizeof(bulk_in));
+    offset += sizeof(bulk_in);
+    memcpy(buffer + offset, &bulk_out, sizeof(bulk_out));
+    offset += sizeof(bulk_out);
+
+    return offset;
+}
+
+/**
+ * @brief Writes descriptors and strings to `ep0` of the FunctionFS instance, after which
+ * FunctionFS creates endpoint files `ep1` (bulk IN) and `ep2` (bulk OUT).
+ */
+static int write_descriptors(int ep0_fd) {
+    unsigned char descriptors[256];
+    struct usb_functionfs_descs_head_v2 header = {
+        .magic = htole32(FUNCTIONFS_DESCRIPTORS_MAGIC_V2),
+        .flags = htole32(FUNCTIONFS_HAS_FS_DESC | FUNCTIONFS_ALL_CTRL_RECIP |
+            (g_emulator.m_is_high_speed ? FUNCTIONFS_HAS_HS_DESC : 0)
+        ),
+    };
+
+    // Counts of descriptors follow the header, one per each speed flag that is set.
+    const uint32_t descriptors_count = htole32(3);
+    size_t offset = sizeof(header);
+    memcpy(descriptors + offset, &descriptors_count, sizeof(descriptors_count));
+    offset += sizeof(descriptors_count);
+
+    if(g_emulator.m_is_high_speed) {
+        memcpy(descriptors + offset, &descriptors_count, sizeof(descriptors_count));
+        offset += sizeof(descriptors_count);
+    }
+
+    offset += append_interface_descriptors(descriptors + offset, FULL_SPEED_MAX_PACKET_SIZE);
+
+    if(g_emulator.m_is_high_speed) {
+        offset += append_interface_descriptors(descriptors + offset, HIGH_SPEED_MAX_PACKET_SIZE);
+    }
+
+    header.length = htole32(offset);
+    memcpy(descriptors, &header, sizeof(header));
+
+    if(write(ep0_fd, descriptors, offset) != (ssize_t) offset) {
+        log_message("failed to write descriptors: %s", strerror(errno));
+        return -1;
+    }
+
+    struct {
+        struct usb_functionfs_strings_head m_header;
+        struct {
+            __le16 m_code;
+            char m_product[sizeof(FT232R_PRODUCT_STRING)];
+        } __attribute__((packed)) m_language;
+    } __attribute__((packed)) strings = {
+        .m_header = {
+            .magic = htole32(FUNCTIONFS_STRINGS_MAGIC),
+            .length = htole32(sizeof(strings)),
+            .str_count = htole32(1),
+            .lang_count = htole32(1),
+        },
+        .m_language = { htole16(0x0409), FT232R_PRODUCT_STRING },
+    };
+
+    if(write(ep0_fd, &strings, sizeof(strings)) != (ssize_t) sizeof(strings)) {
+        log_message("failed to write strings: %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Builds the 2-byte modem/line status header. Error bits are reported once
+ * and cleared, as the real chip does. Should be called with `m_mutex` locked.
+ */
+static void build_status_header(unsigned char * header) {
+    header[0] = FTDI_MODEM_STATUS_RESERVED | FTDI_MODEM_STATUS_CTS | FTDI_MODEM_STATUS_DSR;
+    header[1] = g_emulator.m_line_status_errors;
+
+    if(!g_emulator.m_tx_in_progress) {
+        header[1] |= FTDI_LINE_STATUS_TX_HOLDING_EMPTY | FTDI_LINE_STATUS_TX_EMPTY;
+    }
+
+    if(g_emulator.m_host_baud_rate != g_emulator.m_hc_06_baud_rate) {
+        // Baud rates of both sides of the UART don't match, thus every byte is garbled.
+        header[1] |= FTDI_LINE_STATUS_FRAMING_ERROR;
+    }
+
+    g_emulator.m_line_status_errors = 0;
+}
+
+/**
+ * @brief Handles vendor specific control request of FTDI chips.
+ */
+static void handle_setup(int ep0_fd, const struct usb_ctrlrequest * setup) {
+    const uint16_t value = le16toh(setup->wValue);
+    const uint16_t index = le16toh(setup->wIndex);
+    const uint16_t length = le16toh(setup->wLength);
+    unsigned char response[2];
+    int response_length = -1;
+
+    if((setup->bRequestType & USB_TYPE_MASK) != USB_TYPE_VENDOR) {
+        goto stall;
+    }
+
+    pthread_mutex_lock(&g_emulator.m_mutex);
+
+    switch(setup->bRequest) {
+    case FTDI_SIO_RESET:
+        if(value == FTDI_SIO_RESET_SIO || value == FTDI_SIO_RESET_PURGE_RX) {
+            g_emulator.m_rx_fifo.m_length = 0;
+        }
+
+        LOG_VERBOSE("reset (%u)", value);
+        break;
+
+    case FTDI_SIO_SET_BAUD_RATE:
+        g_emulator.m_host_baud_rate = ftdi_decode_baud_rate(value, index);
+        LOG_VERBOSE("host set baud rate to %d (HC-06 uses %d)",
+            g_emulator.m_host_baud_rate, g_emulator.m_hc_06_baud_rate
+        );
+        break;
+
+    case FTDI_SIO_SET_LATENCY_TIMER:
+        g_emulator.m_latency_timer_ms = (value & 0xff) ? (value & 0xff) : 1;
+        pthread_cond_signal(&g_emulator.m_rx_condition);
+        LOG_VERBOSE("latency timer set to %d ms", g_emulator.m_latency_timer_ms);
+        break;
+
+    case FTDI_SIO_GET_LATENCY_TIMER:
+        response[0] = (unsigned char) g_emulator.m_latency_timer_ms;
+        response_length = 1;
+        break;
+
+    case FTDI_SIO_GET_MODEM_STATUS:
+        build_status_header(response);
+        response_length = 2;
+        break;
+
+    case FTDI_SIO_SET_MODEM_CTRL:
+    case FTDI_SIO_SET_FLOW_CTRL:
+    case FTDI_SIO_SET_DATA:
+    case FTDI_SIO_SET_EVENT_CHAR:
+    case FTDI_SIO_SET_ERROR_CHAR:
+        // Accepted, but don't change the behavior of the model.
+        break;
+
+    default:
+        pthread_mutex_unlock(&g_emulator.m_mutex);
+        LOG_VERBOSE("unsupported vendor request 0x%02x", setup->bRequest);
+        goto stall;
+    }
+
+    pthread_mutex_unlock(&g_emulator.m_mutex);
+
+    if(setup->bRequestType & USB_DIR_IN) {
+        if(response_length < 0) {
+            goto stall;
+        }
+
+        if(write(ep0_fd, response, response_length < length ? response_length : length) < 0) {
+            log_message("failed to answer control request: %s", strerror(errno));
+        }
+    } else {
+        // Zero-length read acknowledges the status stage of an OUT request.
+        if(read(ep0_fd, NULL, 0) < 0) {
+            log_message("failed to acknowledge control request: %s", strerror(errno));
+        }
+    }
+
+    return;
+
+stall:
+    // I/O in the direction opposite to the data stage stalls the control endpoint.
+    if(setup->bRequestType & USB_DIR_IN) {
+        if(read(ep0_fd, NULL, 0) < 0 && errno != EL2HLT) {
+            log_message("failed to stall control request: %s", strerror(errno));
+        }
+    } else {
+        if(write(ep0_fd, NULL, 0) < 0 && errno != EL2HLT) {
+            log_message("failed to stall control request: %s", strerror(errno));
+        }
+    }
+}
+
+/**
+ * @brief Thread that reads events from the control endpoint.
+ */
+static void * ep0_thread(void * argument) {
+    struct usb_functionfs_event events[4];
+
+    while(!g_stop) {
+        const ssize_t read_bytes = read(g_emulator.m_ep0_fd, events, sizeof(events));
+
+        if(read_bytes < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+
+            log_message("failed to read ep0 events: %s", strerror(errno));
+            break;
+        }
+
+        for(size_t i = 0; i < read_bytes / sizeof(events[0]); ++i) {
+            switch(events[i].type) {
+            case FUNCTIONFS_ENABLE:
+                LOG_VERBOSE("enabled by the host");
+                pthread_mutex_lock(&g_emulator.m_mutex);
+                g_emulator.m_is_enabled = 1;
+                pthread_cond_signal(&g_emulator.m_rx_condition);
+                pthread_mutex_unlock(&g_emulator.m_mutex);
+                break;
+
+            case FUNCTIONFS_DISABLE:
+            case FUNCTIONFS_UNBIND:
+                LOG_VERBOSE("disabled by the host");
+                pthread_mutex_lock(&g_emulator.m_mutex);
+                g_emulator.m_is_enabled = 0;
+                pthread_mutex_unlock(&g_emulator.m_mutex);
+                break;
+
+            case FUNCTIONFS_SETUP:
+                handle_setup(g_emulator.m_ep0_fd, &events[i].u.setup);
+                break;
+
+            default:
+                break;
+            }
+        }
+    }
+
+    g_stop = 1;
+    return NULL;
+}
+
+// --------------------------
+// Bulk endpoints and UART.
+// --------------------------
+
+/**
+ * @brief Thread that models host -> FT232R -> UART -> HC-06 direction. Data is read from
+ * the bulk OUT endpoint no faster than the UART drains it, which models the NAK-ing of
+ * the bulk OUT endpoint by FT232R, once its 128-byte transmit buffer is full.
+ */
+static void * bulk_out_thread(void * argument) {
+    unsigned char buffer[2 * HIGH_SPEED_MAX_PACKET_SIZE];
+    long long uart_free_at = now_ns();
+
+    while(!g_stop) {
+        const ssize_t read_bytes = read(g_emulator.m_ep_out_fd, buffer, sizeof(buffer));
+
+        if(read_bytes < 0) {
+            if(errno == EINTR || errno == ESHUTDOWN || errno == EAGAIN) {
+                // Endpoint is disabled, e.g. host is resetting the device.
+                usleep(10000);
+                continue;
+            }
+
+            log_message("failed to read bulk OUT endpoint: %s", strerror(errno));
+            break;
+        }
+
+        pthread_mutex_lock(&g_emulator.m_mutex);
+        g_emulator.m_bytes_from_host += read_bytes;
+        g_emulator.m_tx_in_progress = 1;
+        pthread_mutex_unlock(&g_emulator.m_mutex);
+
+        // Send bytes over the UART in chunks of 16 bytes, so that the loopback
+        // and AT command models see the bytes with a realistic timing.
+        for(ssize_t offset = 0; offset < read_bytes && !g_stop; offset += 16) {
+            const size_t chunk = read_bytes - offset < 16 ? read_bytes - offset : 16;
+            const long long now = now_ns();
+
+            uart_free_at = (uart_free_at > now ? uart_free_at : now) + uart_time_ns(chunk);
+            sleep_until_ns(uart_free_at);
+
+            pthread_mutex_lock(&g_emulator.m_mutex);
+            hc_06_receive(buffer + offset, chunk);
+            pthread_mutex_unlock(&g_emulator.m_mutex);
+        }
+
+        pthread_mutex_lock(&g_emulator.m_mutex);
+        g_emulator.m_tx_in_progress = 0;
+        pthread_mutex_unlock(&g_emulator.m_mutex);
+    }
+
+    g_stop = 1;
+    return NULL;
+}
+
+/**
+ * @brief Thread that models traffic, which HC-06 receives from the remote peer and
+ * sends over UART to FT232R at the UART rate.
+ */
+static void * generator_thread(void * argument) {
+    unsigned char pattern[16];
+    unsigned char counter = 0;
+    long long next_chunk_at = now_ns();
+
+    while(!g_stop) {
+        for(size_t i = 0; i < sizeof(pattern); ++i) {
+            pattern[i] = (unsigned char) ('0' + (counter++ % 64));
+        }
+
+        next_chunk_at += uart_time_ns(sizeof(pattern));
+        sleep_until_ns(next_chunk_at);
+
+        pthread_mutex_lock(&g_emulator.m_mutex);
+
+        if(g_emulator.m_is_enabled) {
+            uart_deliver_to_ft232r(pattern, sizeof(pattern));
+        }
+
+        pthread_mutex_unlock(&g_emulator.m_mutex);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Thread that models FT232R -> host direction. Every bulk IN packet starts with
+ * the 2-byte status header. Packets are sent once the receive buffer has a full packet of
+ * payload, otherwise once the latency timer expires, with whatever payload (possibly none)
+ * has been collected so far.
+ */
+static void * bulk_in_thread(void * argument) {
+    const int max_packet_size = g_emulator.m_is_high_speed ?
+        HIGH_SPEED_MAX_PACKET_SIZE : FULL_SPEED_MAX_PACKET_SIZE;
+    const int payload_per_packet = max_packet_size - FTDI_STATUS_HEADER_SIZE;
+
+    // One write to the endpoint file may carry several packets, the UDC splits it into
+    // max packet sized transactions and a trailing short packet ends the transfer.
+    const int max_packets_per_write = 8;
+    unsigned char buffer[8 * HIGH_SPEED_MAX_PACKET_SIZE];
+    long long latency_deadline = now_ns() + FTDI_DEFAULT_LATENCY_TIMER_MS * 1000000LL;
+
+    while(!g_stop) {
+        size_t length = 0;
+
+        pthread_mutex_lock(&g_emulator.m_mutex);
+
+        // Wait until either a full packet of payload is collected or the latency timer expires.
+        while(!g_stop) {
+            hc_06_flush_at_command(now_ns());
+
+            if(g_emulator.m_is_enabled &&
+                (g_emulator.m_rx_fifo.m_length >= (size_t) payload_per_packet || now_ns() >= latency_deadline)
+            ) {
+                break;
+            }
+
+            long long wakeup = latency_deadline;
+
+            if(g_emulator.m_mode == HC_06_MODE_AT && g_emulator.m_at_command_length) {
+                const long long at_deadline = timespec_to_ns(&g_emulator.m_at_last_byte_time) +
+                    g_emulator.m_at_timeout_ms * 1000000LL;
+                wakeup = at_deadline < wakeup ? at_deadline : wakeup;
+            }
+
+            if(!g_emulator.m_is_enabled) {
+                wakeup = now_ns() + 100000000LL;
+            }
+
+            struct timespec wakeup_time = ns_to_timespec(wakeup);
+            pthread_cond_timedwait(&g_emulator.m_rx_condition, &g_emulator.m_mutex, &wakeup_time);
+        }
+
+        for(int packet = 0; packet < max_packets_per_write; ++packet) {
+            build_status_header(buffer + length);
+            const size_t payload = byte_fifo_pop(&g_emulator.m_rx_fifo,
+                buffer + length + FTDI_STATUS_HEADER_SIZE, payload_per_packet
+            );
+
+            length += FTDI_STATUS_HEADER_SIZE + payload;
+            g_emulator.m_bytes_to_host += payload;
+            ++g_emulator.m_packets_to_host;
+
+            if(payload < (size_t) payload_per_packet ||
+                g_emulator.m_rx_fifo.m_length < (size_t) payload_per_packet
+            ) {
+                // Short packet ends the transfer, remaining partial payload
+                // waits for the next latency timer expiration.
+                break;
+            }
+        }
+
+        latency_deadline = now_ns() + g_emulator.m_latency_timer_ms * 1000000LL;
+        pthread_mutex_unlock(&g_emulator.m_mutex);
+
+        if(write(g_emulator.m_ep_in_fd, buffer, length) < 0) {
+            if(errno == EINTR || errno == ESHUTDOWN || errno == EAGAIN) {
+                usleep(10000);
+                continue;
+            }
+
+            log_message("failed to write bulk IN endpoint: %s", strerror(errno));
+            break;
+        }
+    }
+
+    g_stop = 1;
+    return NULL;
+}
+
+// -----
+// Main.
+// -----
+
+static void signal_handler(int signal_number) {
+    g_stop = 1;
+}
+
+static void print_usage(const char * program) {
+    fprintf(stderr,
+        "Usage: %s [options] <functionfs-mount-directory>\n"
+        "  -m, --mode <at|loopback|generate>  HC-06 behavior (default: loopback)\n"
+        "  -b, --uart-baud <rate>             HC-06 UART baud rate (default: %d)\n"
+        "  -f, --rx-fifo <bytes>              FT232R receive buffer size (default: %d)\n"
+        "  -a, --at-timeout-ms <ms>           Silence that terminates an AT command (default: 1000)\n"
+        "  -H, --high-speed                   Also provide 512-byte high-speed descriptors\n"
+        "  -v, --verbose                      Log control requests and AT commands\n",
+        program, HC_06_DEFAULT_BAUD_RATE, FTDI_DEFAULT_RX_FIFO_SIZE
+    );
+}
+
+static int open_endpoint(const char * directory, const char * name, int flags) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", directory, name);
+
+    const int fd = open(path, flags);
+
+    if(fd < 0) {
+        log_message("failed to open %s: %s", path, strerror(errno));
+    }
+
+    return fd;
+}
+
+int main(int argc, char ** argv) {
+    static const struct option options[] = {
+        { "mode", required_argument, NULL, 'm' },
+        { "uart-baud", required_argument, NULL, 'b' },
+        { "rx-fifo", required_argument, NULL, 'f' },
+        { "at-timeout-ms", required_argument, NULL, 'a' },
+        { "high-speed", no_argument, NULL, 'H' },
+        { "verbose", no_argument, NULL, 'v' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    size_t rx_fifo_size = FTDI_DEFAULT_RX_FIFO_SIZE;
+    g_emulator.m_mode = HC_06_MODE_LOOPBACK;
+    g_emulator.m_hc_06_baud_rate = HC_06_DEFAULT_BAUD_RATE;
+    g_emulator.m_at_timeout_ms = 1000;
+    int option;
+
+    while((option = getopt_long(argc, argv, "m:b:f:a:Hvh", options, NULL)) != -1) {
+        switch(option) {
+        case 'm':
+            if(strcmp(optarg, "at") == 0) {
+                g_emulator.m_mode = HC_06_MODE_AT;
+            } else if(strcmp(optarg, "loopback") == 0) {
+                g_emulator.m_mode = HC_06_MODE_LOOPBACK;
+            } else if(strcmp(optarg, "generate") == 0) {
+                g_emulator.m_mode = HC_06_MODE_GENERATE;
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+
+        case 'b':
+            g_emulator.m_hc_06_baud_rate = atoi(optarg);
+            break;
+
+        case 'f':
+            rx_fifo_size = strtoul(optarg, NULL, 0);
+            break;
+
+        case 'a':
+            g_emulator.m_at_timeout_ms = atoi(optarg);
+            break;
+
+        case 'H':
+            g_emulator.m_is_high_speed = 1;
+            break;
+
+        case 'v':
+            g_emulator.m_verbose = 1;
+            break;
+
+        default:
+            print_usage(argv[0]);
+            return option == 'h' ? 0 : 1;
+        }
+    }
+
+    if(optind != argc - 1 || g_emulator.m_hc_06_baud_rate <= 0 || rx_fifo_size == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    g_emulator.m_ffs_directory = argv[optind];
+    g_emulator.m_host_baud_rate = g_emulator.m_hc_06_baud_rate;
+    g_emulator.m_latency_timer_ms = FTDI_DEFAULT_LATENCY_TIMER_MS;
+    g_emulator.m_rx_fifo.m_capacity = rx_fifo_size;
+    g_emulator.m_rx_fifo.m_buffer = malloc(rx_fifo_size);
+
+    if(!g_emulator.m_rx_fifo.m_buffer) {
+        log_message("failed to allocate receive buffer");
+        return 1;
+    }
+
+    pthread_mutex_init(&g_emulator.m_mutex, NULL);
+    pthread_cond_init(&g_emulator.m_rx_condition, NULL);
+
+    // Signal handlers are installed without `SA_RESTART`, so that blocking
+    // endpoint I/O is interrupted and the threads notice `g_stop`.
+    struct sigaction action = { .sa_handler = signal_handler };
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    g_emulator.m_ep0_fd = open_endpoint(g_emulator.m_ffs_directory, "ep0", O_RDWR);
+
+    if(g_emulator.m_ep0_fd < 0 || write_descriptors(g_emulator.m_ep0_fd)) {
+        return 1;
+    }
+
+    g_emulator.m_ep_in_fd = open_endpoint(g_emulator.m_ffs_directory, "ep1", O_RDWR);
+    g_emulator.m_ep_out_fd = open_endpoint(g_emulator.m_ffs_directory, "ep2", O_RDWR);
+
+    if(g_emulator.m_ep_in_fd < 0 || g_emulator.m_ep_out_fd < 0) {
+        return 1;
+    }
+
+    log_message("ready: mode %s, UART %d baud, %s speed descriptors",
+        g_emulator.m_mode == HC_06_MODE_AT ? "at" :
+            (g_emulator.m_mode == HC_06_MODE_LOOPBACK ? "loopback" : "generate"),
+        g_emulator.m_hc_06_baud_rate, g_emulator.m_is_high_speed ? "full and high" : "full"
+    );
+
+    pthread_t threads[4];
+    int num_threads = 0;
+    pthread_create(&threads[num_threads++], NULL, ep0_thread, NULL);
+    pthread_create(&threads[num_threads++], NULL, bulk_out_thread, NULL);
+    pthread_create(&threads[num_threads++], NULL, bulk_in_thread, NULL);
+
+    if(g_emulator.m_mode == HC_06_MODE_GENERATE) {
+        pthread_create(&threads[num_threads++], NULL, generator_thread, NULL);
+    }
+
+    // Signal may be delivered to any of the threads, thus the flag is polled.
+    while(!g_stop) {
+        usleep(100000);
+    }
+
+    // Interrupt blocking endpoint I/O of the worker threads.
+    for(int i = 0; i < num_threads; ++i) {
+        pthread_kill(threads[i], SIGTERM);
+    }
+
+    pthread_mutex_lock(&g_emulator.m_mutex);
+    pthread_cond_broadcast(&g_emulator.m_rx_condition);
+    pthread_mutex_unlock(&g_emulator.m_mutex);
+
+    for(int i = 0; i < num_threads; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    log_message("bytes from host: %llu, bytes to host: %llu, IN packets: %llu, RX overruns: %llu",
+        g_emulator.m_bytes_from_host, g_emulator.m_bytes_to_host,
+        g_emulator.m_packets_to_host, g_emulator.m_rx_overruns
+    );
+
+    close(g_emulator.m_ep_out_fd);
+    close(g_emulator.m_ep_in_fd);
+    close(g_emulator.m_ep0_fd);
+    free(g_emulator.m_rx_fifo.m_buffer);
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+#!/bin/sh
+#
+# Creates (`start`) or removes (`stop`) an emulated FT232R + HC-06 device on the `dummy_hcd`
+# virtual USB controller. The device is a configfs USB gadget with a single FunctionFS
+# function, whose descriptors and endpoints are served by the `ft232r_emulator` program.
+#
+# Usage: ft232r_emulator.sh start <path-to-ft232r_emulator> [emulator options...]
+#        ft232r_emulator.sh stop
+#
+# Environment variables:
+#   HIGH_SPEED=1  connect the gadget at high speed (requires `--high-speed` emulator option).
+#   UDC=<name>    USB device controller to bind to (defaults to the first one, i.e. `dummy_udc.0`).
+
+set -e
+
+GADGET_NAME=ft232r_emulator
+GADGET_DIR=/sys/kernel/config/usb_gadget/${GADGET_NAME}
+FUNCTION_NAME=ffs.ft232r
+FFS_DIR=/dev/ffs-ft232r
+PID_FILE=/run/${GADGET_NAME}.pid
+
+# Values are taken from `ftdi_lsusb_output.txt`.
+VENDOR_ID=0x0403
+PRODUCT_ID=0x6001
+DEVICE_BCD=0x0600
+SERIAL_NUMBER=A50285BI
+
+start() {
+    emulator_binary=$1
+    shift
+
+    if [ "${HIGH_SPEED}" = "1" ]; then
+        modprobe dummy_hcd
+        max_speed=high-speed
+    else
+        modprobe dummy_hcd is_high_speed=0
+        max_speed=full-speed
+    fi
+
+    modprobe libcomposite
+    modprobe usb_f_fs
+    mountpoint -q /sys/kernel/config || mount -t configfs none /sys/kernel/config
+
+    mkdir ${GADGET_DIR}
+    echo ${VENDOR_ID} > ${GADGET_DIR}/idVendor
+    echo ${PRODUCT_ID} > ${GADGET_DIR}/idProduct
+    echo ${DEVICE_BCD} > ${GADGET_DIR}/bcdDevice
+    echo 0x0200 > ${GADGET_DIR}/bcdUSB
+    echo ${max_speed} > ${GADGET_DIR}/max_speed
+
+    mkdir ${GADGET_DIR}/strings/0x409
+    echo "FTDI" > ${GADGET_DIR}/strings/0x409/manufacturer
+    echo "FT232R USB UART" > ${GADGET_DIR}/strings/0x409/product
+    echo ${SERIAL_NUMBER} > ${GADGET_DIR}/strings/0x409/serialnumber
+
+    # Bus powered with remote wakeup and 90 mA, as the real adapter.
+    mkdir ${GADGET_DIR}/configs/c.1
+    echo 0xa0 > ${GADGET_DIR}/configs/c.1/bmAttributes
+    echo 90 > ${GADGET_DIR}/configs/c.1/MaxPower
+
+    mkdir ${GADGET_DIR}/functions/${FUNCTION_NAME}
+    ln -s ${GADGET_DIR}/functions/${FUNCTION_NAME} ${GADGET_DIR}/configs/c.1/
+
+    mkdir -p ${FFS_DIR}
+    mount -t functionfs ft232r ${FFS_DIR}
+
+    "${emulator_binary}" "$@" ${FFS_DIR} &
+    echo $! > ${PID_FILE}
+
+    # Gadget can only be bound once the emulator has written its descriptors,
+    # i.e. once FunctionFS has created the endpoint files.
+    for attempt in $(seq 50); do
+        [ -e ${FFS_DIR}/ep2 ] && break
+        sleep 0.1
+    done
+
+    echo "${UDC:-$(ls /sys/class/udc | head -n 1)}" > ${GADGET_DIR}/UDC
+}
+
+stop() {
+    [ -e ${GADGET_DIR}/UDC ] && echo "" > ${GADGET_DIR}/UDC || true
+
+    if [ -e ${PID_FILE} ]; then
+        kill "$(cat ${PID_FILE})" 2>/dev/null || true
+        rm -f ${PID_FILE}
+        sleep 0.2
+    fi
+
+    mountpoint -q ${FFS_DIR} && umount ${FFS_DIR} || true
+    rm -f ${GADGET_DIR}/configs/c.1/${FUNCTION_NAME}
+    [ -d ${GADGET_DIR}/configs/c.1 ] && rmdir ${GADGET_DIR}/configs/c.1 || true
+    [ -d ${GADGET_DIR}/functions/${FUNCTION_NAME} ] && rmdir ${GADGET_DIR}/functions/${FUNCTION_NAME} || true
+    [ -d ${GADGET_DIR}/strings/0x409 ] && rmdir ${GADGET_DIR}/strings/0x409 || true
+    [ -d ${GADGET_DIR} ] && rmdir ${GADGET_DIR} || true
+}
+
+case "$1" in
+    start)
+        shift
+        start "$@"
+        ;;
+    stop)
+        stop
+        ;;
+    *)
+        echo "Usage: $0 start <path-to-ft232r_emulator> [emulator options...] | stop" >&2
+        exit 1
+        ;;
+esac